@@ -0,0 +1,134 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+using System.Diagnostics;
+
+namespace PhotoApp.Core
+{
+    /// <summary>
+    /// Maps device time (extended micros()) to host time, NTP style. The
+    /// host sends "SYNC" at hostSend and reads "SYNC t=&lt;micros&gt;" at hostRecv.
+    /// The device stamp is then taken to be the midpoint of the round trip.
+    /// Only the fastest exchanges are trusted: a slow one waited in a
+    /// buffer on one leg, and that skews the midpoint. The offset comes
+    /// from the fastest recent exchange. Drift is the slope between the
+    /// fastest exchange in the older and in the newer half of the window.
+    /// Thread-safe.
+    /// </summary>
+    public sealed class ClockSync
+    {
+        private const int Window = 32;
+        private const long MaxRttUs = 500000;          // ignore exchanges slower than this
+        private const long MinDriftSpanUs = 10000000;  // need 10 s between halves to trust a slope
+
+        private struct Exchange
+        {
+            public long HostMidUs;
+            public long OffsetUs;   // device - host at HostMidUs
+            public long RttUs;
+        }
+
+        private readonly object _lock = new object();
+        private readonly Exchange[] _ring = new Exchange[Window];
+        private int _count, _next;
+
+        // Current fit: device = host + offset + drift * (host - anchor)
+        private long _anchorHostUs;
+        private long _anchorOffsetUs;
+        private double _drift;
+        private long _bestRttUs;
+
+        /// <summary>Host time in microseconds from a Stopwatch timestamp.</summary>
+        public static long HostMicros(long stopwatchTicks)
+        {
+            return (long)(stopwatchTicks * (1e6 / Stopwatch.Frequency));
+        }
+
+        public static long HostMicrosNow()
+        {
+            return HostMicros(Stopwatch.GetTimestamp());
+        }
+
+        public bool IsSynced { get { lock (_lock) return _count > 0; } }
+
+        public int Exchanges { get { lock (_lock) return _count; } }
+
+        /// <summary>Device clock rate error in parts per million (positive = device fast).</summary>
+        public double DriftPpm { get { lock (_lock) return _drift * 1e6; } }
+
+        /// <summary>Worst-case error of the mapping: half the best round trip in use.</summary>
+        public long UncertaintyUs { get { lock (_lock) return _bestRttUs / 2; } }
+
+        public void Reset()
+        {
+            lock (_lock)
+            {
+                _count = _next = 0;
+                _drift = 0;
+                _bestRttUs = 0;
+            }
+        }
+
+        /// <summary>Adds one ping; returns false if it was too slow to use.</summary>
+        public bool Add(long hostSendUs, long deviceUs, long hostRecvUs)
+        {
+            long rtt = hostRecvUs - hostSendUs;
+            if (rtt < 0 || rtt > MaxRttUs) return false;
+
+            long mid = hostSendUs + rtt / 2;
+            lock (_lock)
+            {
+                _ring[_next] = new Exchange { HostMidUs = mid, OffsetUs = deviceUs - mid, RttUs = rtt };
+                _next = (_next + 1) % Window;
+                if (_count < Window) _count++;
+                Refit();
+            }
+            return true;
+        }
+
+        public long ToHostUs(long deviceUs)
+        {
+            lock (_lock)
+            {
+                // device = host + off + drift*(host - anchor)  =>  solve for host
+                double host = (deviceUs - _anchorOffsetUs + _drift * _anchorHostUs) / (1.0 + _drift);
+                return (long)host;
+            }
+        }
+
+        public long ToDeviceUs(long hostUs)
+        {
+            lock (_lock)
+            {
+                return hostUs + _anchorOffsetUs + (long)(_drift * (hostUs - _anchorHostUs));
+            }
+        }
+
+        private void Refit()
+        {
+            // Oldest first
+            int start = (_next - _count + Window) % Window;
+            int half = _count / 2;
+            int bestOld = -1, bestNew = -1, best = -1;
+            for (int k = 0; k < _count; k++)
+            {
+                int i = (start + k) % Window;
+                if (best < 0 || _ring[i].RttUs <= _ring[best].RttUs) best = i;
+                if (k < half) { if (bestOld < 0 || _ring[i].RttUs < _ring[bestOld].RttUs) bestOld = i; }
+                else if (bestNew < 0 || _ring[i].RttUs <= _ring[bestNew].RttUs) bestNew = i;
+            }
+
+            _anchorHostUs = _ring[best].HostMidUs;
+            _anchorOffsetUs = _ring[best].OffsetUs;
+            _bestRttUs = _ring[best].RttUs;
+
+            if (bestOld >= 0 && bestNew >= 0)
+            {
+                long span = _ring[bestNew].HostMidUs - _ring[bestOld].HostMidUs;
+                if (span >= MinDriftSpanUs)
+                    _drift = (double)(_ring[bestNew].OffsetUs - _ring[bestOld].OffsetUs) / span;
+            }
+        }
+    }
+}
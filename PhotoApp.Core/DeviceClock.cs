@@ -0,0 +1,63 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+namespace PhotoApp.Core
+{
+    /// <summary>
+    /// Extends the firmware's 32-bit micros(), which wraps every ~71.6
+    /// minutes, to a 64-bit count that never goes backwards. Stamps must
+    /// be fed in arrival order. A jump far ahead (a corrupted digit looks
+    /// exactly like that) is only believed once the next stamp agrees.
+    /// Not thread-safe.
+    /// </summary>
+    public sealed class DeviceClock
+    {
+        private const long Wrap = 1L << 32;
+        private const long MaxStepUs = 10000000;   // lines come at least every 2 s
+
+        private long _epoch;    // added to raw stamps
+        private long _last = -1;
+        private long _candidate = -1;   // unconfirmed jump ahead
+
+        /// <summary>Last extended time, -1 before the first stamp.</summary>
+        public long LastMicros { get { return _last; } }
+
+        public long Extend(uint micros)
+        {
+            long t = _epoch + micros;
+            bool wrapped = false;
+            if (_last >= 0)
+            {
+                // A step back of more than half the range is a wrap; a small
+                // one is a reordered stamp and is held at the last value
+                if (t < _last - Wrap / 2) { t += Wrap; wrapped = true; }
+                else if (t < _last) return _last;
+
+                if (t - _last > MaxStepUs)
+                {
+                    bool confirmed = _candidate >= 0 && t >= _candidate && t - _candidate <= MaxStepUs;
+                    if (!confirmed)
+                    {
+                        _candidate = t;
+                        return _last;
+                    }
+                }
+            }
+            if (wrapped) _epoch += Wrap;
+            _candidate = -1;
+            _last = t;
+            return t;
+        }
+
+        /// <summary>
+        /// The device rebooted and micros() restarted at 0. Later stamps
+        /// continue from the last one so time stays monotonic.
+        /// </summary>
+        public void Restart()
+        {
+            if (_last >= 0) _epoch = _last + 1;
+            _candidate = -1;
+        }
+    }
+}
@@ -0,0 +1,306 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.IO;
+using System.Threading;
+using System.Threading.Tasks;
+
+namespace PhotoApp.Core
+{
+    /// <summary>A port that answered as an EchoMe. Its stream is still open and now belongs to the caller.</summary>
+    public sealed class DiscoveredDevice
+    {
+        public string Port;
+        public Stream Stream;
+        public string Firmware;   // from the READY banner; null for pre-1.3 firmware seen streaming
+        public long ProbeMs;      // open to answer
+    }
+
+    /// <summary>
+    /// Finds EchoMe boards without anyone picking a port. Every port that
+    /// is not already in use is opened and probed at the same time: the
+    /// probe waits for the READY banner that the board's auto-reset on open
+    /// produces, and sends ID? every half second for boards that were not
+    /// reset. The stream of a port that answers is handed over as it is;
+    /// closing and reopening it would reset the Nano a second time.
+    /// <see cref="Start"/> keeps watching: ports that appear are probed,
+    /// and once a session ends <see cref="Release"/> makes its port a
+    /// candidate again, so an unplugged board is picked up when it is
+    /// plugged back in. A port that did not answer is only retried after
+    /// it has disappeared from the list, so other devices are not poked
+    /// every poll.
+    /// </summary>
+    public sealed class DeviceDiscovery : IDisposable
+    {
+        /// <summary>
+        /// A Nano with the old bootloader takes about 2 s from the reset on
+        /// open to the banner; the rest is slack for a loaded host.
+        /// </summary>
+        public static readonly TimeSpan DefaultProbeTimeout = TimeSpan.FromSeconds(4);
+
+        private const int IdentifyIntervalMs = 500;
+
+        private readonly Func<string[]> _listPorts;
+        private readonly Func<string, Stream> _open;
+        private readonly object _gate = new object();
+        private readonly HashSet<string> _claimed = new HashSet<string>(StringComparer.OrdinalIgnoreCase);
+        private readonly HashSet<string> _rejected = new HashSet<string>(StringComparer.OrdinalIgnoreCase);
+        private readonly HashSet<string> _probing = new HashSet<string>(StringComparer.OrdinalIgnoreCase);
+        private readonly CancellationTokenSource _cancel = new CancellationTokenSource();
+        private Task _watch;
+
+        /// <param name="listPorts">Candidate port names, e.g. SerialPort.GetPortNames.</param>
+        /// <param name="open">Opens a port at 9600 8N1; may throw (busy, gone, not a serial port).</param>
+        public DeviceDiscovery(Func<string[]> listPorts, Func<string, Stream> open)
+        {
+            if (listPorts == null) throw new ArgumentNullException(nameof(listPorts));
+            if (open == null) throw new ArgumentNullException(nameof(open));
+            _listPorts = listPorts;
+            _open = open;
+            ProbeTimeout = DefaultProbeTimeout;
+            PollInterval = TimeSpan.FromSeconds(2);
+        }
+
+        public TimeSpan ProbeTimeout { get; set; }
+        public TimeSpan PollInterval { get; set; }
+
+        /// <summary>
+        /// Raised on a pool thread for each board found; the handler owns
+        /// the stream and calls <see cref="Release"/> once it is done with it.
+        /// </summary>
+        public event Action<DiscoveredDevice> Found;
+
+        /// <summary>Raised on a pool thread for a port that did not answer as an EchoMe.</summary>
+        public event Action<string> Rejected;
+
+        /// <summary>Scans now, then every <see cref="PollInterval"/>.</summary>
+        public void Start()
+        {
+            if (_watch == null) _watch = Task.Run(WatchLoopAsync);
+        }
+
+        /// <summary>
+        /// Marks a port as in use, e.g. one connected by hand, so the watch
+        /// leaves it alone until <see cref="Release"/>.
+        /// </summary>
+        public void Claim(string port)
+        {
+            lock (_gate)
+            {
+                _claimed.Add(port);
+                _rejected.Remove(port);
+            }
+        }
+
+        /// <summary>The port's session has ended; probe it again when it is listed.</summary>
+        public void Release(string port)
+        {
+            lock (_gate) _claimed.Remove(port);
+        }
+
+        public void Dispose()
+        {
+            _cancel.Cancel();
+            var watch = _watch;
+            if (watch != null) watch.Wait(ProbeTimeout + TimeSpan.FromSeconds(1));
+        }
+
+        /// <summary>
+        /// Opens <paramref name="port"/> and waits up to <paramref name="timeout"/>
+        /// for it to identify as an EchoMe. Null (and the port closed) if it does not.
+        /// </summary>
+        public static async Task<DiscoveredDevice> ProbeAsync(string port, Func<string, Stream> open, TimeSpan timeout, CancellationToken cancel)
+        {
+            var sw = Stopwatch.StartNew();
+            Stream stream;
+            try
+            {
+                stream = await Task.Run(() => open(port)).ConfigureAwait(false);
+            }
+            catch (Exception)
+            {
+                return null;
+            }
+
+            var framer = new LineFramer();
+            var buffer = new byte[256];
+            byte[] identify = Protocol.CommandLine(Protocol.Command.Identify);
+            DiscoveredDevice found = null;
+            LineHandler onLine = (b, offset, count) =>
+            {
+                if (found != null) return;
+                switch (Protocol.Classify(b, offset, count))
+                {
+                    case Protocol.MessageKind.Ready:
+                        Protocol.Ready ready;
+                        if (Protocol.TryDecode(b, offset, count, out ready))
+                            found = new DiscoveredDevice { Port = port, Firmware = ready.HasFw ? Protocol.Text(ready.Fw) : null };
+                        break;
+                    case Protocol.MessageKind.Distance:
+                        // Firmware before ID? that was already running: its telemetry is just as telling
+                        Protocol.Distance distance;
+                        if (Protocol.TryDecode(b, offset, count, out distance))
+                            found = new DiscoveredDevice { Port = port };
+                        break;
+                }
+            };
+
+            Task<int> read = null;
+            Task write = null;
+            long nextIdentifyMs = 0;
+            try
+            {
+                while (found == null && !cancel.IsCancellationRequested)
+                {
+                    long elapsedMs = sw.ElapsedMilliseconds;
+                    long leftMs = (long)timeout.TotalMilliseconds - elapsedMs;
+                    if (leftMs <= 0) break;
+
+                    // Lands in the bootloader if the open just reset the board,
+                    // which only sends it on to the sketch sooner
+                    if (write == null && elapsedMs >= nextIdentifyMs)
+                    {
+                        // On the pool, not here: a port whose writes block (an SPP
+                        // port with no peer, a stalled adapter) must not hold the
+                        // probe past its timeout. Not WriteAsync: Stream's default
+                        // one waits for the pending read to finish first.
+                        write = Task.Run(() => stream.Write(identify, 0, identify.Length));
+                        nextIdentifyMs = elapsedMs + IdentifyIntervalMs;
+                    }
+                    if (write != null && write.IsCompleted)
+                    {
+                        await write.ConfigureAwait(false);   // throws if the port failed
+                        write = null;
+                    }
+
+                    // Serial reads do not all honour cancellation, so race them
+                    // against the clock and keep one pending across turns
+                    if (read == null) read = stream.ReadAsync(buffer, 0, buffer.Length, cancel);
+                    long waitMs = Math.Min(leftMs, nextIdentifyMs - elapsedMs);
+                    if (await Task.WhenAny(read, Task.Delay((int)Math.Max(1, waitMs), cancel)).ConfigureAwait(false) != read) continue;
+
+                    int n = await read.ConfigureAwait(false);
+                    read = null;
+                    if (n <= 0) break;
+                    framer.Feed(buffer, 0, n, onLine);
+                }
+            }
+            catch (Exception)
+            {
+                found = null;   // port failed or went away mid-probe
+            }
+
+            if (write != null)
+            {
+                // An answer can beat our own ID? out; give that the time left
+                long leftMs = Math.Max(1, (long)timeout.TotalMilliseconds - sw.ElapsedMilliseconds);
+                if (found != null && await Task.WhenAny(write, Task.Delay((int)leftMs)).ConfigureAwait(false) == write)
+                {
+                    try
+                    {
+                        await write.ConfigureAwait(false);
+                        write = null;
+                    }
+                    catch (Exception)
+                    {
+                        found = null;
+                    }
+                }
+                // Still blocked: it ends with the port, or never; don't wait for it
+                if (write != null) write.ContinueWith(t => t.Exception, TaskContinuationOptions.OnlyOnFaulted);
+            }
+            if (found == null || read != null || write != null)
+            {
+                stream.Dispose();   // also completes a pending read
+                if (read != null)
+                {
+                    try { await read.ConfigureAwait(false); }
+                    catch (Exception) { }
+                }
+                return null;
+            }
+            found.Stream = stream;
+            found.ProbeMs = sw.ElapsedMilliseconds;
+            return found;
+        }
+
+        private async Task WatchLoopAsync()
+        {
+            var probes = new List<Task>();
+            while (!_cancel.IsCancellationRequested)
+            {
+                string[] ports;
+                try
+                {
+                    ports = _listPorts() ?? new string[0];
+                }
+                catch (Exception)
+                {
+                    ports = new string[0];
+                }
+
+                lock (_gate)
+                {
+                    // Gone from the list: unplugged, so worth a look when it is back
+                    _rejected.RemoveWhere(p => Array.FindIndex(ports, q => string.Equals(p, q, StringComparison.OrdinalIgnoreCase)) < 0);
+                    foreach (string port in ports)
+                    {
+                        if (_claimed.Contains(port) || _rejected.Contains(port) || _probing.Contains(port)) continue;
+                        _probing.Add(port);
+                        probes.Add(ProbeAndReportAsync(port));
+                    }
+                }
+                probes.RemoveAll(t => t.IsCompleted);
+
+                try
+                {
+                    await Task.Delay(PollInterval, _cancel.Token).ConfigureAwait(false);
+                }
+                catch (OperationCanceledException)
+                {
+                    break;
+                }
+            }
+            try
+            {
+                await Task.WhenAll(probes).ConfigureAwait(false);
+            }
+            catch (Exception)
+            {
+            }
+        }
+
+        private async Task ProbeAndReportAsync(string port)
+        {
+            DiscoveredDevice device = await ProbeAsync(port, _open, ProbeTimeout, _cancel.Token).ConfigureAwait(false);
+            bool stopping = _cancel.IsCancellationRequested;
+            lock (_gate)
+            {
+                _probing.Remove(port);
+                if (!stopping)
+                {
+                    if (device != null) _claimed.Add(port);
+                    else _rejected.Add(port);
+                }
+            }
+
+            if (device == null)
+            {
+                var rejected = Rejected;
+                if (rejected != null && !stopping) rejected(port);
+                return;
+            }
+            var found = Found;
+            if (found == null || stopping)
+            {
+                device.Stream.Dispose();   // nobody to hand it to
+                return;
+            }
+            found(device);
+        }
+    }
+}
@@ -0,0 +1,130 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+using System;
+using System.Diagnostics;
+using System.IO;
+using System.Threading;
+using System.Threading.Tasks;
+
+namespace PhotoApp.Core
+{
+    /// <summary>
+    /// One EchoMe device on a host that serves several. Like
+    /// <see cref="SerialPipeline"/>, but without threads of its own: a
+    /// ReadAsync loop feeds a <see cref="TelemetryProcessor"/> on whatever
+    /// pool thread completed the read. Idle ports cost a pending read and a
+    /// 512-byte buffer, not two blocked threads, so N devices share a
+    /// handful of pool threads. (SerialPort's BaseStream does overlapped
+    /// I/O on Windows; streams without real async reads fall back to a
+    /// pool thread per pending read.)
+    /// There is no chunk pool to overflow: a slow parse just delays the
+    /// next read and the bytes wait in the driver's buffer.
+    /// </summary>
+    public sealed class DeviceSession : IDisposable
+    {
+        private const int BufferSize = 512;
+
+        private readonly Stream _stream;
+        private readonly TelemetryProcessor _telemetry;
+        private readonly byte[] _buffer = new byte[BufferSize];
+        private readonly CancellationTokenSource _cancel = new CancellationTokenSource();
+        private Task _run;
+        private long _bytesRead;
+
+        public DeviceSession(string name, Stream stream)
+            : this(name, stream, new PresenceDetector())
+        {
+        }
+
+        public DeviceSession(string name, Stream stream, PresenceDetector detector)
+        {
+            if (stream == null) throw new ArgumentNullException(nameof(stream));
+            Name = name;
+            _stream = stream;
+            _telemetry = new TelemetryProcessor(stream, detector);
+        }
+
+        /// <summary>Port name or other label; also the key the host files the device under.</summary>
+        public string Name { get; private set; }
+
+        /// <summary>Framing, detector state and notifications for this device.</summary>
+        public TelemetryProcessor Telemetry { get { return _telemetry; } }
+
+        public long BytesRead { get { return Interlocked.Read(ref _bytesRead); } }
+
+        /// <summary>Raised on a pool thread once the stream has ended, failed or the session was stopped.</summary>
+        public event Action<DeviceSession> Completed;
+
+        /// <summary>Starts reading; the returned task ends with the session.</summary>
+        public Task Start()
+        {
+            if (_run == null)
+            {
+                _run = Task.Run(ReadLoopAsync);   // off the caller's (UI) context
+                _telemetry.StartSync();
+            }
+            return _run;
+        }
+
+        /// <summary>
+        /// Stops pinging and abandons the pending read. Not every stream
+        /// honours cancellation, so close it (or the port) as well; the
+        /// caller owns it.
+        /// </summary>
+        public void Stop()
+        {
+            _telemetry.StopSync();
+            try
+            {
+                _cancel.Cancel();
+            }
+            catch (ObjectDisposedException)
+            {
+            }
+        }
+
+        public void Dispose()
+        {
+            Stop();
+            var run = _run;
+            if (run != null) run.Wait(3000);
+            _cancel.Dispose();
+        }
+
+        private async Task ReadLoopAsync()
+        {
+            try
+            {
+                while (!_cancel.IsCancellationRequested)
+                {
+                    int n;
+                    try
+                    {
+                        n = await _stream.ReadAsync(_buffer, 0, _buffer.Length, _cancel.Token).ConfigureAwait(false);
+                    }
+                    catch (TimeoutException)
+                    {
+                        continue;   // quiet line
+                    }
+                    if (n <= 0) break;   // end of stream
+
+                    long now = Stopwatch.GetTimestamp();
+                    Interlocked.Add(ref _bytesRead, n);
+                    _telemetry.Feed(_buffer, 0, n, now, false);
+                }
+            }
+            catch (Exception)
+            {
+                // port closed, unplugged or cancelled
+            }
+            finally
+            {
+                _telemetry.StopSync();
+                var done = Completed;
+                if (done != null) done(this);
+            }
+        }
+    }
+}
@@ -0,0 +1,126 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+using System;
+using System.IO;
+using System.IO.Pipes;
+using System.Threading;
+
+namespace PhotoApp.Core
+{
+    /// <summary>Called on the client's reader thread; keep it short.</summary>
+    public delegate void HostEventHandler(in HostEvent e);
+
+    /// <summary>
+    /// Subscriber side of the echome-hostd event stream. One reader thread
+    /// blocks on the pipe and hands each frame to <see cref="Received"/> as
+    /// soon as it arrives, so the hop from the daemon costs a pipe wakeup
+    /// and nothing else. After <see cref="Start"/> the daemon first sends a
+    /// DeviceUp for every device it has, then live frames.
+    /// </summary>
+    public sealed class HostEventClient : IDisposable
+    {
+        private readonly NamedPipeClientStream _pipe;
+        private readonly byte[] _buffer = new byte[HostEvents.FrameSize * 64];
+        private Thread _reader;
+        private long _frames, _dropped;
+        private uint _nextSequence;
+        private bool _any;
+
+        private HostEventClient(NamedPipeClientStream pipe)
+        {
+            _pipe = pipe;
+        }
+
+        /// <summary>
+        /// Connects to a running daemon; throws TimeoutException when none
+        /// answers within <paramref name="timeoutMs"/>.
+        /// </summary>
+        public static HostEventClient Connect(string pipeName, int timeoutMs)
+        {
+            var pipe = new NamedPipeClientStream(".", pipeName, PipeDirection.InOut);
+            try
+            {
+                pipe.Connect(timeoutMs);
+            }
+            catch
+            {
+                pipe.Dispose();
+                throw;
+            }
+            return new HostEventClient(pipe);
+        }
+
+        /// <summary>Raised on the reader thread for every frame.</summary>
+        public event HostEventHandler Received;
+
+        /// <summary>Raised on the reader thread once the daemon has gone.</summary>
+        public event Action Closed;
+
+        public long Frames { get { return Interlocked.Read(ref _frames); } }
+
+        /// <summary>Frames the daemon dropped because this subscriber fell behind.</summary>
+        public long Dropped { get { return Interlocked.Read(ref _dropped); } }
+
+        /// <summary>Asks for <paramref name="mask"/> (<see cref="HostEvents.Mask"/> bits) and starts reading.</summary>
+        public void Start(uint mask)
+        {
+            if (_reader != null) return;
+            var subscribe = new HostEvent { Type = HostFrameType.Subscribe, Sequence = mask };
+            var frame = new byte[HostEvents.FrameSize];
+            HostEvents.Write(in subscribe, frame, 0);
+            _pipe.Write(frame, 0, frame.Length);
+            _pipe.Flush();
+
+            _reader = new Thread(ReadLoop) { IsBackground = true, Name = "Host events" };
+            _reader.Start();
+        }
+
+        public void Dispose()
+        {
+            _pipe.Dispose();   // ends the pending read
+            var reader = _reader;
+            if (reader != null && reader != Thread.CurrentThread) reader.Join(1000);
+        }
+
+        private void ReadLoop()
+        {
+            int have = 0;
+            try
+            {
+                while (true)
+                {
+                    int n = _pipe.Read(_buffer, have, _buffer.Length - have);
+                    if (n <= 0) break;
+                    have += n;
+
+                    int used = 0;
+                    for (; have - used >= HostEvents.FrameSize; used += HostEvents.FrameSize)
+                    {
+                        HostEvent e;
+                        HostEvents.Read(_buffer, used, out e);
+                        if (_any && e.Sequence != _nextSequence) Interlocked.Add(ref _dropped, unchecked(e.Sequence - _nextSequence));
+                        _nextSequence = e.Sequence + 1;
+                        _any = true;
+                        Interlocked.Increment(ref _frames);
+
+                        var handler = Received;
+                        if (handler != null) handler(in e);
+                    }
+                    if (used > 0 && used < have) Buffer.BlockCopy(_buffer, used, _buffer, 0, have - used);
+                    have -= used;
+                }
+            }
+            catch (Exception ex) when (ex is IOException || ex is ObjectDisposedException)
+            {
+                // daemon stopped or we were disposed
+            }
+            finally
+            {
+                var closed = Closed;
+                if (closed != null) closed();
+            }
+        }
+    }
+}
@@ -0,0 +1,139 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+using System;
+using System.Text;
+
+namespace PhotoApp.Core
+{
+    public enum HostFrameType : byte
+    {
+        Subscribe = 1,   // subscriber -> daemon, Sequence = mask of the types it wants
+        DeviceUp,        // Name, Code = current PresenceState; sent to each new subscriber too
+        DeviceDown,
+        Presence,        // Code = PresenceState
+        Event,           // Code = LogEvent: READY, STALL, game prompts
+        Sample           // A, B
+    }
+
+    /// <summary>One frame of the echome-hostd event stream, see <see cref="HostEvents"/>.</summary>
+    public struct HostEvent
+    {
+        public HostFrameType Type;
+        public byte Device;            // daemon's id for the port, fixed while it is connected
+        public byte Code;
+        public ushort Arg;             // Event: as LogRecord.Arg
+        public ushort A, B;            // Sample: 1/100 cm, LogRecord.NoEcho for none
+        public uint Sequence;          // per subscriber; a jump means frames were dropped
+        public long SampleHostUs;      // device time of the line (SYNC-mapped) or ReadHostUs
+        public long ReadHostUs;        // daemon read the bytes
+        public long PublishedHostUs;   // daemon queued the frame
+        public long ApproachHostUs;    // Presence/Present: first echo under the threshold, else -1
+        public int SmoothUs, DebounceUs;
+        public string Name;            // DeviceUp only
+
+        public PresenceState State { get { return (PresenceState)Code; } }
+        public LogEvent Event { get { return (LogEvent)Code; } }
+    }
+
+    /// <summary>
+    /// Wire format of the echome-hostd event stream. Every frame is
+    /// <see cref="FrameSize"/> bytes, little-endian:
+    ///    0 type   1 device   2 code   3 0
+    ///    4 arg (u16)   6 a (u16)   8 b (u16)   10 0
+    ///   12 sequence (u32)
+    ///   16 sample, 24 read, 32 published, 40 approach (i64 host µs)
+    ///   48 smooth, 52 debounce (i32 µs)
+    /// DeviceUp carries the port name (ASCII, zero-padded) in 16..55
+    /// instead of the times. Host times are <see cref="ClockSync.HostMicros"/>,
+    /// which is one monotonic clock for every process on the machine, so
+    /// a subscriber can time the trip from serial read to itself.
+    /// The transport is System.IO.Pipes: a named pipe on Windows, a Unix
+    /// domain socket elsewhere (an absolute pipe name is the socket path).
+    /// </summary>
+    public static class HostEvents
+    {
+        public const int FrameSize = 56;
+        public const string DefaultPipeName = "echome-hostd";
+
+        private const int NameOffset = 16;
+        private const int NameLength = FrameSize - NameOffset;
+
+        public static uint Mask(HostFrameType type)
+        {
+            return 1u << (int)type;
+        }
+
+        /// <summary>Frames every subscriber gets whatever it asked for.</summary>
+        public static readonly uint AlwaysSent = Mask(HostFrameType.DeviceUp) | Mask(HostFrameType.DeviceDown);
+
+        public static void Write(in HostEvent e, byte[] b, int o)
+        {
+            b[o] = (byte)e.Type;
+            b[o + 1] = e.Device;
+            b[o + 2] = e.Code;
+            b[o + 3] = 0;
+            TelemetryLog.WriteUInt16(b, o + 4, e.Arg);
+            TelemetryLog.WriteUInt16(b, o + 6, e.A);
+            TelemetryLog.WriteUInt16(b, o + 8, e.B);
+            TelemetryLog.WriteUInt16(b, o + 10, 0);
+            TelemetryLog.WriteInt32(b, o + 12, (int)e.Sequence);
+            if (e.Type == HostFrameType.DeviceUp)
+            {
+                Array.Clear(b, o + NameOffset, NameLength);
+                if (e.Name != null)
+                    Encoding.ASCII.GetBytes(e.Name, 0, Math.Min(e.Name.Length, NameLength), b, o + NameOffset);
+                return;
+            }
+            TelemetryLog.WriteInt64(b, o + 16, e.SampleHostUs);
+            TelemetryLog.WriteInt64(b, o + 24, e.ReadHostUs);
+            TelemetryLog.WriteInt64(b, o + 32, e.PublishedHostUs);
+            TelemetryLog.WriteInt64(b, o + 40, e.ApproachHostUs);
+            TelemetryLog.WriteInt32(b, o + 48, e.SmoothUs);
+            TelemetryLog.WriteInt32(b, o + 52, e.DebounceUs);
+        }
+
+        public static void Read(byte[] b, int o, out HostEvent e)
+        {
+            e = default(HostEvent);
+            e.Type = (HostFrameType)b[o];
+            e.Device = b[o + 1];
+            e.Code = b[o + 2];
+            e.Arg = (ushort)(b[o + 4] | b[o + 5] << 8);
+            e.A = (ushort)(b[o + 6] | b[o + 7] << 8);
+            e.B = (ushort)(b[o + 8] | b[o + 9] << 8);
+            e.Sequence = (uint)TelemetryLog.ReadInt32(b, o + 12);
+            if (e.Type == HostFrameType.DeviceUp)
+            {
+                int n = 0;
+                while (n < NameLength && b[o + NameOffset + n] != 0) n++;
+                e.Name = Encoding.ASCII.GetString(b, o + NameOffset, n);
+                return;
+            }
+            e.SampleHostUs = TelemetryLog.ReadInt64(b, o + 16);
+            e.ReadHostUs = TelemetryLog.ReadInt64(b, o + 24);
+            e.PublishedHostUs = TelemetryLog.ReadInt64(b, o + 32);
+            e.ApproachHostUs = TelemetryLog.ReadInt64(b, o + 40);
+            e.SmoothUs = TelemetryLog.ReadInt32(b, o + 48);
+            e.DebounceUs = TelemetryLog.ReadInt32(b, o + 52);
+        }
+
+        /// <summary>
+        /// Stage timings of an arrival as PhotoApp's latency report wants
+        /// them; the IPC hop counts as dispatch.
+        /// </summary>
+        public static LatencyTrace ToTrace(in HostEvent e)
+        {
+            return new LatencyTrace
+            {
+                SmoothUs = e.SmoothUs,
+                DebounceUs = e.DebounceUs,
+                ApproachHostUs = e.ApproachHostUs,
+                SampleHostUs = e.SampleHostUs,
+                ReadHostUs = e.ReadHostUs,
+                DetectedHostUs = e.PublishedHostUs
+            };
+        }
+    }
+}
@@ -0,0 +1,108 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+using System;
+using System.Globalization;
+using System.Text;
+
+namespace PhotoApp.Core
+{
+    /// <summary>
+    /// Per-stage percentiles over the most recent <see cref="LatencyTrace"/>s.
+    /// Each stage keeps a fixed ring of durations, so memory stays flat
+    /// however long the app runs. Not thread-safe.
+    /// </summary>
+    public sealed class LatencyReport
+    {
+        private readonly long[][] _samples;
+        private readonly int[] _count;
+        private readonly int[] _next;
+        private readonly long[] _sortBuf;
+
+        public LatencyReport(int window = 256)
+        {
+            if (window <= 0) throw new ArgumentOutOfRangeException(nameof(window));
+            _samples = new long[LatencyTrace.StageCount][];
+            for (int i = 0; i < _samples.Length; i++) _samples[i] = new long[window];
+            _count = new int[LatencyTrace.StageCount];
+            _next = new int[LatencyTrace.StageCount];
+            _sortBuf = new long[window];
+        }
+
+        public int Traces { get; private set; }
+
+        public void Add(LatencyTrace trace)
+        {
+            Traces++;
+            for (int s = 0; s < _samples.Length; s++)
+            {
+                long us = trace.Duration((LatencyStage)s);
+                if (us < 0) continue;
+                long[] ring = _samples[s];
+                ring[_next[s]] = us;
+                _next[s] = (_next[s] + 1) % ring.Length;
+                if (_count[s] < ring.Length) _count[s]++;
+            }
+        }
+
+        /// <summary>Nearest-rank percentile in microseconds, -1 with no data.</summary>
+        public long Percentile(LatencyStage stage, int pct)
+        {
+            int s = (int)stage;
+            int n = _count[s];
+            if (n == 0) return -1;
+            Array.Copy(_samples[s], _sortBuf, n);
+            Array.Sort(_sortBuf, 0, n);
+            int rank = (int)Math.Ceiling(pct / 100.0 * n);
+            return _sortBuf[Math.Max(0, Math.Min(n - 1, rank - 1))];
+        }
+
+        /// <summary>
+        /// One line for a status bar: the total p50/p95 and the stage with
+        /// the largest median.
+        /// </summary>
+        public string Summary()
+        {
+            if (Traces == 0) return "cube->photo: no arrivals yet";
+
+            LatencyStage worst = LatencyStage.Smooth;
+            long worstUs = -1;
+            for (int s = 0; s < (int)LatencyStage.Total; s++)
+            {
+                long p50 = Percentile((LatencyStage)s, 50);
+                if (p50 > worstUs) { worstUs = p50; worst = (LatencyStage)s; }
+            }
+
+            long total50 = Percentile(LatencyStage.Total, 50), total95 = Percentile(LatencyStage.Total, 95);
+            return string.Format(CultureInfo.InvariantCulture,
+                "cube->photo p50 {0} ms, p95 {1} ms ({2} arrivals) | largest stage: {3} {4:F0} ms",
+                total50 < 0 ? "-" : (total50 / 1000.0).ToString("F0", CultureInfo.InvariantCulture),
+                total95 < 0 ? "-" : (total95 / 1000.0).ToString("F0", CultureInfo.InvariantCulture),
+                Traces, worst.ToString().ToLowerInvariant(), worstUs / 1000.0);
+        }
+
+        /// <summary>A header, then one line per stage: p50, p95 and max in milliseconds.</summary>
+        public string Format()
+        {
+            var sb = new StringBuilder();
+            sb.AppendFormat(CultureInfo.InvariantCulture, "cube->photo latency, {0} arrivals (ms)", Traces);
+            sb.AppendLine();
+            sb.AppendFormat(CultureInfo.InvariantCulture, "{0,-9} {1,7} {2,7} {3,7}", "stage", "p50", "p95", "max");
+            for (int s = 0; s < _samples.Length; s++)
+            {
+                var stage = (LatencyStage)s;
+                sb.AppendLine();
+                sb.AppendFormat(CultureInfo.InvariantCulture, "{0,-9}", stage.ToString().ToLowerInvariant());
+                if (_count[s] == 0)
+                {
+                    sb.AppendFormat(" {0,7}", "-");
+                    continue;
+                }
+                sb.AppendFormat(CultureInfo.InvariantCulture, " {0,7:F1} {1,7:F1} {2,7:F1}",
+                    Percentile(stage, 50) / 1000.0, Percentile(stage, 95) / 1000.0, Percentile(stage, 100) / 1000.0);
+            }
+            return sb.ToString();
+        }
+    }
+}
@@ -0,0 +1,83 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+namespace PhotoApp.Core
+{
+    public enum LatencyStage
+    {
+        Smooth,     // first echo under the threshold -> moving average under it
+        Debounce,   // average under the threshold -> debounce satisfied
+        Serial,     // that sample on the device -> bytes read on the host
+        Parse,      // bytes read -> detector decision
+        Dispatch,   // decision -> UI thread handling it (BeginInvoke)
+        Show,       // UI handler -> photo assigned to the PictureBox (decode wait)
+        Paint,      // photo assigned -> first paint finished
+        Total       // first echo -> first paint
+    }
+
+    /// <summary>
+    /// Timestamps of one cube arrival on its way to the screen. Host times
+    /// are <see cref="ClockSync.HostMicros"/> microseconds. Device times are
+    /// mapped through the SYNC estimate, and -1 marks anything unknown
+    /// (no device stamps, not synced yet, no photo shown).
+    /// </summary>
+    public sealed class LatencyTrace
+    {
+        public static readonly int StageCount = (int)LatencyStage.Total + 1;
+
+        // Measured on one clock, so exact even without a sync
+        public long SmoothUs = -1;
+        public long DebounceUs = -1;
+
+        public long ApproachHostUs = -1;   // first echo under the threshold
+        public long SampleHostUs = -1;     // the sample that completed the debounce
+        public long ReadHostUs = -1;
+        public long DetectedHostUs = -1;
+        public long DispatchedHostUs = -1;
+        public long ShownHostUs = -1;
+        public long PaintedHostUs = -1;
+
+        /// <summary>The first photo was decoded on the approach, before the arrival.</summary>
+        public bool Prewarmed;
+
+        /// <summary>Duration of one stage in microseconds, -1 if unknown.</summary>
+        public long Duration(LatencyStage stage)
+        {
+            switch (stage)
+            {
+                case LatencyStage.Smooth:   return SmoothUs;
+                case LatencyStage.Debounce: return DebounceUs;
+                case LatencyStage.Serial:   return Span(SampleHostUs, ReadHostUs);
+                case LatencyStage.Parse:    return Span(ReadHostUs, DetectedHostUs);
+                case LatencyStage.Dispatch: return Span(DetectedHostUs, DispatchedHostUs);
+                case LatencyStage.Show:     return Span(DispatchedHostUs, ShownHostUs);
+                case LatencyStage.Paint:    return Span(ShownHostUs, PaintedHostUs);
+                case LatencyStage.Total:    return Span(ApproachHostUs, PaintedHostUs);
+                default:                    return -1;
+            }
+        }
+
+        public override string ToString()
+        {
+            var sb = new System.Text.StringBuilder("cube->photo");
+            for (int i = 0; i < StageCount; i++)
+            {
+                long us = Duration((LatencyStage)i);
+                sb.Append(' ').Append(((LatencyStage)i).ToString().ToLowerInvariant()).Append('=');
+                if (us < 0) sb.Append('-');
+                else sb.Append((us / 1000.0).ToString("F1", System.Globalization.CultureInfo.InvariantCulture));
+            }
+            sb.Append(" ms");
+            if (Prewarmed) sb.Append(" (prewarmed)");
+            return sb.ToString();
+        }
+
+        // Sync error can make the serial leg come out slightly negative; clamp it
+        private static long Span(long from, long to)
+        {
+            if (from < 0 || to < 0) return -1;
+            return to > from ? to - from : 0;
+        }
+    }
+}
@@ -0,0 +1,108 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+using System;
+
+namespace PhotoApp.Core
+{
+    /// <summary>
+    /// Called once per complete line. The bytes are only valid for the
+    /// duration of the call.
+    /// </summary>
+    public delegate void LineHandler(byte[] buffer, int offset, int count);
+
+    /// <summary>
+    /// Splits a serial byte stream into lines without allocating.
+    /// Lines may arrive split across any number of reads; the unfinished
+    /// tail is kept in a reusable buffer until its terminator shows up.
+    /// "\r\n", "\n" and "\r" all end a line and empty lines are skipped.
+    /// </summary>
+    public sealed class LineFramer
+    {
+        private readonly byte[] _partial;
+        private int _partialLen;
+        private bool _discarding;   // current line overflowed, skip to its end
+
+        public LineFramer(int maxLineLength = 256)
+        {
+            if (maxLineLength <= 0) throw new ArgumentOutOfRangeException(nameof(maxLineLength));
+            _partial = new byte[maxLineLength];
+        }
+
+        /// <summary>Complete lines handed to the handler so far.</summary>
+        public long LinesFramed { get; private set; }
+
+        /// <summary>
+        /// Lines thrown away because the part that had to be buffered
+        /// across reads was longer than the buffer.
+        /// </summary>
+        public long LinesOverflowed { get; private set; }
+
+        /// <summary>Bytes of an unfinished line currently buffered.</summary>
+        public int PendingBytes { get { return _partialLen; } }
+
+        public void Reset()
+        {
+            _partialLen = 0;
+            _discarding = false;
+        }
+
+        /// <summary>
+        /// Frames <paramref name="count"/> bytes. Lines that lie entirely
+        /// inside <paramref name="data"/> are passed straight from it;
+        /// only a line straddling two reads is copied.
+        /// </summary>
+        public void Feed(byte[] data, int offset, int count, LineHandler onLine)
+        {
+            if (data == null) throw new ArgumentNullException(nameof(data));
+            if (onLine == null) throw new ArgumentNullException(nameof(onLine));
+
+            int end = offset + count;
+            int start = offset;
+            for (int i = offset; i < end; i++)
+            {
+                byte b = data[i];
+                if (b != (byte)'\n' && b != (byte)'\r') continue;
+
+                if (!_discarding)
+                {
+                    if (_partialLen > 0)
+                    {
+                        if (Append(data, start, i - start))
+                            Emit(_partial, 0, _partialLen, onLine);
+                    }
+                    else if (i > start)
+                    {
+                        Emit(data, start, i - start, onLine);
+                    }
+                }
+                _discarding = false;
+                _partialLen = 0;
+                start = i + 1;
+            }
+
+            if (start < end && !_discarding) Append(data, start, end - start);
+        }
+
+        private bool Append(byte[] data, int offset, int count)
+        {
+            if (_partialLen + count > _partial.Length)
+            {
+                LinesOverflowed++;
+                _partialLen = 0;
+                _discarding = true;
+                return false;
+            }
+            Buffer.BlockCopy(data, offset, _partial, _partialLen, count);
+            _partialLen += count;
+            return true;
+        }
+
+        private void Emit(byte[] buffer, int offset, int count, LineHandler onLine)
+        {
+            LinesFramed++;
+            onLine(buffer, offset, count);
+        }
+    }
+}
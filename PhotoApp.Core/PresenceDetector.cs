@@ -0,0 +1,244 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+namespace PhotoApp.Core
+{
+    public enum PresenceChange
+    {
+        None,
+        Arrived,      // cube placed: start the slideshow
+        Left,         // cube removed: stop it
+        Approaching,  // cube on its way down: worth getting photos ready
+        Receded       // ...but it never arrived: drop them
+    }
+
+    /// <summary>Latest detector state, as published to the UI.</summary>
+    public enum PresenceState
+    {
+        Absent,
+        Approaching,
+        Present
+    }
+
+    /// <summary>
+    /// Decides from sensor B distances whether the cube is on the device.
+    /// Samples are averaged over a short window, then pass a hysteresis
+    /// band and must stay on one side of it for the debounce time before
+    /// the state flips. Time is whatever clock the caller stamps samples
+    /// with, in milliseconds. Not thread-safe; one instance per stream.
+    ///
+    /// While absent it also fits a line through the raw samples in the
+    /// window. Closing in fast enough to cross the start threshold within
+    /// <see cref="ApproachHorizonMs"/>, or being under it while the debounce
+    /// runs, reports <see cref="PresenceChange.Approaching"/>, so the host
+    /// can prepare the first photo before <see cref="PresenceChange.Arrived"/>.
+    /// If neither holds for <see cref="ApproachHoldMs"/>, it reports
+    /// <see cref="PresenceChange.Receded"/>.
+    /// </summary>
+    public sealed class PresenceDetector
+    {
+        // Hysteresis around 3 cm to avoid flicker
+        public const double DefaultStartCm = 2.8;   // ON when < 2.8 cm
+        public const double DefaultStopCm = 3.5;    // OFF when > 3.5 cm
+        public const long DefaultStartDebounceMs = 250;
+        public const long DefaultStopDebounceMs = 700;
+        public const int DefaultSmoothCount = 5;
+
+        // Approach trend
+        public const double DefaultApproachCmPerS = 4;     // closing speed that counts
+        public const double DefaultApproachMaxCm = 12;     // farther off is just movement nearby
+        public const long DefaultApproachHorizonMs = 600;  // predicted arrival at most this far ahead
+        public const long DefaultApproachHoldMs = 400;     // trend gone this long: cancel
+
+        private double _startCm;
+        private double _stopCm;
+        private readonly long _startDebounceMs;
+        private readonly long _stopDebounceMs;
+
+        // Moving average of the last N samples; times are for the trend
+        private readonly double[] _window;
+        private readonly long[] _times;
+        private int _windowCount;
+        private int _windowNext;
+
+        private bool _below, _above;   // an edge timer is running
+        private long _belowSince, _aboveSince;
+        private long _approachSince = -1;
+        private long _trendSeen;   // last sample that looked like an approach
+
+        public PresenceDetector()
+            : this(DefaultStartCm, DefaultStopCm, DefaultStartDebounceMs, DefaultStopDebounceMs, DefaultSmoothCount)
+        {
+        }
+
+        public PresenceDetector(double startCm, double stopCm, long startDebounceMs, long stopDebounceMs, int smoothCount)
+        {
+            _startCm = startCm;
+            _stopCm = stopCm;
+            _startDebounceMs = startDebounceMs;
+            _stopDebounceMs = stopDebounceMs;
+            _window = new double[smoothCount < 1 ? 1 : smoothCount];
+            _times = new long[_window.Length];
+            ApproachCmPerS = DefaultApproachCmPerS;
+            ApproachMaxCm = DefaultApproachMaxCm;
+            ApproachHorizonMs = DefaultApproachHorizonMs;
+            ApproachHoldMs = DefaultApproachHoldMs;
+        }
+
+        /// <summary>
+        /// Moves the ON/OFF thresholds, e.g. to the device's own
+        /// calibration. The smoothing window and running edge timers carry on.
+        /// </summary>
+        public void SetThresholds(double startCm, double stopCm)
+        {
+            _startCm = startCm;
+            _stopCm = stopCm;
+        }
+
+        public double StartCm { get { return _startCm; } }
+        public double StopCm { get { return _stopCm; } }
+
+        public double ApproachCmPerS { get; set; }
+        public double ApproachMaxCm { get; set; }
+        /// <summary>0 turns approach detection off.</summary>
+        public long ApproachHorizonMs { get; set; }
+        public long ApproachHoldMs { get; set; }
+
+        public bool Present { get; private set; }
+
+        /// <summary>An approach was reported and has not yet arrived or receded.</summary>
+        public bool Approaching { get; private set; }
+
+        public PresenceState State
+        {
+            get { return Present ? PresenceState.Present : Approaching ? PresenceState.Approaching : PresenceState.Absent; }
+        }
+
+        /// <summary>Least-squares slope of the raw window in cm/s (negative = closing), 0 until there are 3 samples.</summary>
+        public double TrendCmPerS { get; private set; }
+
+        /// <summary>Last smoothed distance, NaN before the first sample.</summary>
+        public double SmoothedCm { get; private set; } = double.NaN;
+
+        /// <summary>
+        /// Time of the first raw sample under the start threshold in the
+        /// current approach, -1 if none. Valid when Arrived is returned.
+        /// </summary>
+        public long ApproachSinceMs { get { return _approachSince; } }
+
+        /// <summary>Time the smoothed distance went under the start threshold, -1 if it is not under.</summary>
+        public long BelowSinceMs { get { return _below ? _belowSince : -1; } }
+
+        public void Reset()
+        {
+            Present = false;
+            Approaching = false;
+            TrendCmPerS = 0;
+            SmoothedCm = double.NaN;
+            _windowCount = 0;
+            _windowNext = 0;
+            _below = _above = false;
+            _approachSince = -1;
+        }
+
+        public PresenceChange Update(double cm, long timeMs)
+        {
+            if (double.IsNaN(cm)) return PresenceChange.None;
+            double b = Smooth(cm, timeMs);
+
+            // Start of the approach for latency tracing; a raw sample back
+            // over the threshold cancels it until the average has crossed
+            if (cm < _startCm) { if (_approachSince < 0) _approachSince = timeMs; }
+            else if (!_below) _approachSince = -1;
+
+            // Debounced state machine with hysteresis
+            if (b < _startCm)
+            {
+                if (!_below) { _below = true; _belowSince = timeMs; }
+                _above = false;
+
+                if (!Present && timeMs - _belowSince >= _startDebounceMs)
+                {
+                    Present = true;
+                    Approaching = false;
+                    return PresenceChange.Arrived;
+                }
+            }
+            else if (b > _stopCm)
+            {
+                if (!_above) { _above = true; _aboveSince = timeMs; }
+                _below = false;
+
+                if (Present && timeMs - _aboveSince >= _stopDebounceMs)
+                {
+                    Present = false;
+                    return PresenceChange.Left;
+                }
+            }
+            else
+            {
+                // between thresholds: reset edge timers
+                _below = _above = false;
+            }
+            return Present ? PresenceChange.None : UpdateApproach(b, timeMs);
+        }
+
+        private PresenceChange UpdateApproach(double b, long timeMs)
+        {
+            if (ApproachHorizonMs <= 0) return PresenceChange.None;
+
+            // Under the threshold already (debouncing), or closing in fast
+            // enough to get there within the horizon
+            double v = TrendCmPerS;
+            bool likely = _below
+                || (v <= -ApproachCmPerS && b <= ApproachMaxCm && (b - _startCm) * 1000 <= -v * ApproachHorizonMs);
+            if (likely) _trendSeen = timeMs;
+
+            if (!Approaching && likely)
+            {
+                Approaching = true;
+                return PresenceChange.Approaching;
+            }
+            if (Approaching && !likely && timeMs - _trendSeen >= ApproachHoldMs)
+            {
+                Approaching = false;
+                return PresenceChange.Receded;
+            }
+            return PresenceChange.None;
+        }
+
+        private double Smooth(double cm, long timeMs)
+        {
+            _window[_windowNext] = cm;
+            _times[_windowNext] = timeMs;
+            _windowNext = (_windowNext + 1) % _window.Length;
+            if (_windowCount < _window.Length) _windowCount++;
+
+            double sum = 0;
+            for (int i = 0; i < _windowCount; i++) sum += _window[i];
+            SmoothedCm = sum / _windowCount;
+            TrendCmPerS = Slope();
+            return SmoothedCm;
+        }
+
+        // Times relative to the newest sample keep the sums small
+        private double Slope()
+        {
+            int n = _windowCount;
+            if (n < 3) return 0;
+            long t0 = _times[(_windowNext + _window.Length - 1) % _window.Length];
+            double st = 0, sc = 0, stt = 0, stc = 0;
+            for (int i = 0; i < n; i++)
+            {
+                double t = (_times[i] - t0) / 1000.0;
+                st += t;
+                sc += _window[i];
+                stt += t * t;
+                stc += t * _window[i];
+            }
+            double den = n * stt - st * st;
+            return den > 1e-9 ? (n * stc - st * sc) / den : 0;
+        }
+    }
+}
@@ -0,0 +1,729 @@
+// <auto-generated>
+// Generated by tools/protogen/protogen.py from protocol/echome.schema.
+// Do not edit; change the schema and regenerate.
+// </auto-generated>
+
+using System;
+
+namespace PhotoApp.Core
+{
+    public static partial class Protocol
+    {
+        private static readonly byte[] L0 = new byte[] { 0x47, 0x6F, 0x6F, 0x64, 0x21, 0x20, 0x4E, 0x65, 0x78, 0x74, 0x20, 0x6C, 0x65, 0x76, 0x65, 0x6C, 0x2E, 0x2E, 0x2E };   // "Good! Next level..."
+        private static readonly byte[] L1 = new byte[] { 0x46, 0x41, 0x49, 0x4C, 0x21, 0x20, 0x52, 0x65, 0x73, 0x74, 0x61, 0x72, 0x74, 0x69, 0x6E, 0x67, 0x2E, 0x2E, 0x2E };   // "FAIL! Restarting..."
+        private static readonly byte[] L2 = new byte[] { 0x57, 0x72, 0x6F, 0x6E, 0x67, 0x21, 0x20, 0x54, 0x72, 0x79, 0x20, 0x61, 0x67, 0x61, 0x69, 0x6E, 0x2E };   // "Wrong! Try again."
+        private static readonly byte[] L3 = new byte[] { 0x52, 0x45, 0x41, 0x44, 0x59, 0x20, 0x45, 0x63, 0x68, 0x6F, 0x4D, 0x65 };   // "READY EchoMe"
+        private static readonly byte[] L4 = new byte[] { 0x53, 0x54, 0x41, 0x4C, 0x4C, 0x20, 0x74, 0x61, 0x73, 0x6B, 0x3D };   // "STALL task="
+        private static readonly byte[] L5 = new byte[] { 0x53, 0x4E, 0x44, 0x20, 0x76, 0x6F, 0x69, 0x63, 0x65, 0x73, 0x3D };   // "SND voices="
+        private static readonly byte[] L6 = new byte[] { 0x4C, 0x45, 0x44, 0x20, 0x66, 0x72, 0x61, 0x6D, 0x65, 0x73, 0x3D };   // "LED frames="
+        private static readonly byte[] L7 = new byte[] { 0x59, 0x6F, 0x75, 0x72, 0x20, 0x74, 0x75, 0x72, 0x6E, 0x21 };   // "Your turn!"
+        private static readonly byte[] L8 = new byte[] { 0x43, 0x6F, 0x72, 0x72, 0x65, 0x63, 0x74, 0x21 };   // "Correct!"
+        private static readonly byte[] L9 = new byte[] { 0x59, 0x4F, 0x55, 0x20, 0x57, 0x49, 0x4E, 0x21 };   // "YOU WIN!"
+        private static readonly byte[] L10 = new byte[] { 0x53, 0x59, 0x4E, 0x43, 0x20, 0x74, 0x3D };   // "SYNC t="
+        private static readonly byte[] L11 = new byte[] { 0x4C, 0x41, 0x54, 0x20, 0x62, 0x3D };   // "LAT b="
+        private static readonly byte[] L12 = new byte[] { 0x54, 0x75, 0x72, 0x6E, 0x20 };   // "Turn "
+        private static readonly byte[] L13 = new byte[] { 0x45, 0x52, 0x52, 0x20 };   // "ERR "
+        private static readonly byte[] L14 = new byte[] { 0x43, 0x41, 0x4C, 0x20 };   // "CAL "
+        private static readonly byte[] L15 = new byte[] { 0x41, 0x3A, 0x20 };   // "A: "
+        private static readonly byte[] L16 = new byte[] { 0x4F, 0x4B };   // "OK"
+        private static readonly byte[] L17 = new byte[] { 0x7E };   // "~"
+        private static readonly byte[] L18 = new byte[] { 0x20, 0x66, 0x77, 0x3D };   // " fw="
+        private static readonly byte[] L19 = new byte[] { 0x20, 0x7C, 0x20, 0x42, 0x3A, 0x20 };   // " | B: "
+        private static readonly byte[] L20 = new byte[] { 0x20, 0x7C, 0x20, 0x74, 0x3D };   // " | t="
+        private static readonly byte[] L21 = new byte[] { 0x20, 0x61, 0x74, 0x3D };   // " at="
+        private static readonly byte[] L22 = new byte[] { 0x6D, 0x73, 0x20, 0x63, 0x6F, 0x75, 0x6E, 0x74, 0x3D };   // "ms count="
+        private static readonly byte[] L23 = new byte[] { 0x20, 0x6E, 0x3D };   // " n="
+        private static readonly byte[] L24 = new byte[] { 0x20, 0x70, 0x35, 0x30, 0x3C, 0x3D };   // " p50<="
+        private static readonly byte[] L25 = new byte[] { 0x20, 0x70, 0x39, 0x39, 0x3C, 0x3D };   // " p99<="
+        private static readonly byte[] L26 = new byte[] { 0x20, 0x6D, 0x61, 0x78, 0x3D };   // " max="
+        private static readonly byte[] L27 = new byte[] { 0x20, 0x68, 0x3D };   // " h="
+        private static readonly byte[] L28 = new byte[] { 0x2F };   // "/"
+        private static readonly byte[] L29 = new byte[] { 0x63, 0x79, 0x20, 0x61, 0x76, 0x67, 0x3D };   // "cy avg="
+        private static readonly byte[] L30 = new byte[] { 0x63, 0x79, 0x20, 0x6C, 0x6F, 0x61, 0x64, 0x3D };   // "cy load="
+        private static readonly byte[] L31 = new byte[] { 0x25, 0x20, 0x62, 0x75, 0x64, 0x67, 0x65, 0x74, 0x3D };   // "% budget="
+        private static readonly byte[] L32 = new byte[] { 0x63, 0x79 };   // "cy"
+        private static readonly byte[] L33 = new byte[] { 0x2F, 0x73, 0x20, 0x73, 0x6B, 0x69, 0x70, 0x70, 0x65, 0x64, 0x3D };   // "/s skipped="
+        private static readonly byte[] L34 = new byte[] { 0x2F, 0x73, 0x20, 0x6F, 0x66, 0x66, 0x3D };   // "/s off="
+        private static readonly byte[] L35 = new byte[] { 0x75, 0x73, 0x2F, 0x73, 0x20, 0x6D, 0x61, 0x78, 0x3D };   // "us/s max="
+        private static readonly byte[] L36 = new byte[] { 0x75, 0x73 };   // "us"
+        private static readonly byte[] L37 = new byte[] { 0x20, 0x62, 0x61, 0x73, 0x65, 0x3D };   // " base="
+        private static readonly byte[] L38 = new byte[] { 0x6D, 0x6D, 0x20, 0x6E, 0x6F, 0x69, 0x73, 0x65, 0x3D };   // "mm noise="
+        private static readonly byte[] L39 = new byte[] { 0x6D, 0x6D, 0x20, 0x6F, 0x6E, 0x3D };   // "mm on="
+        private static readonly byte[] L40 = new byte[] { 0x6D, 0x6D, 0x20, 0x6F, 0x66, 0x66, 0x3D };   // "mm off="
+        private static readonly byte[] L41 = new byte[] { 0x6D, 0x6D, 0x20, 0x73, 0x72, 0x63, 0x3D };   // "mm src="
+
+        public enum MessageKind
+        {
+            Unknown,
+            Ready,
+            Distance,
+            SyncReply,
+            Ok,
+            Err,
+            Stall,
+            Latency,
+            Sound,
+            Strips,
+            Record,
+            Calibration,
+            Turn,
+            YourTurn,
+            Correct,
+            NextLevel,
+            Wrong,
+            Fail,
+            Win,
+        }
+
+        public enum Command
+        {
+            /// <summary>LAT?</summary>
+            LatDump,
+            /// <summary>LAT0</summary>
+            LatClear,
+            /// <summary>REC1</summary>
+            RecStart,
+            /// <summary>REC0</summary>
+            RecStop,
+            /// <summary>STREAM1</summary>
+            StreamOn,
+            /// <summary>STREAM0</summary>
+            StreamOff,
+            /// <summary>SYNC</summary>
+            Sync,
+            /// <summary>ID?</summary>
+            Identify,
+            /// <summary>CAL</summary>
+            Calibrate,
+            /// <summary>CAL?</summary>
+            CalDump,
+            /// <summary>LED?</summary>
+            StripDump,
+            /// <summary>SND?</summary>
+            SoundDump,
+            /// <summary>SND0</summary>
+            SoundClear,
+        }
+
+        /// <summary>READY EchoMe[ fw={fw:str:12}]</summary>
+        public struct Ready
+        {
+            public const int MaxLength = 28;
+            public bool HasFw;
+            public ArraySegment<byte> Fw;
+        }
+
+        /// <summary>A: {a:cm} | B: {b:cm}[ | t={t:u32}]</summary>
+        public struct Distance
+        {
+            public const int MaxLength = 44;
+            public double A;
+            public double B;
+            public bool HasT;
+            public uint T;
+        }
+
+        /// <summary>SYNC t={t:u32}</summary>
+        public struct SyncReply
+        {
+            public const int MaxLength = 17;
+            public uint T;
+        }
+
+        /// <summary>OK</summary>
+        public struct Ok
+        {
+            public const int MaxLength = 2;
+        }
+
+        /// <summary>ERR {cmd:str:15}</summary>
+        public struct Err
+        {
+            public const int MaxLength = 19;
+            public ArraySegment<byte> Cmd;
+        }
+
+        /// <summary>STALL task={task:str:8} at={at:u32}ms count={count:u8}</summary>
+        public struct Stall
+        {
+            public const int MaxLength = 45;
+            public ArraySegment<byte> Task;
+            public uint At;
+            public byte Count;
+        }
+
+        /// <summary>LAT b={b:u8} n={n:u32} p50&lt;={p50:str:3} p99&lt;={p99:str:3} max={max:u32} h={h:u16s:12}</summary>
+        public struct Latency
+        {
+            public const int MaxLength = 129;
+            public byte B;
+            public uint N;
+            public ArraySegment<byte> P50;
+            public ArraySegment<byte> P99;
+            public uint Max;
+            public ArraySegment<byte> H;
+        }
+
+        /// <summary>SND voices={voices:u8}/{slots:u8} max={max:u16}cy avg={avg:u16}cy load={load:u8}% budget={budget:u16}cy</summary>
+        public struct Sound
+        {
+            public const int MaxLength = 67;
+            public byte Voices;
+            public byte Slots;
+            public ushort Max;
+            public ushort Avg;
+            public byte Load;
+            public ushort Budget;
+        }
+
+        /// <summary>LED frames={frames:u16}/s skipped={skipped:u16}/s off={off:u32}us/s max={max:u16}us</summary>
+        public struct Strips
+        {
+            public const int MaxLength = 65;
+            public ushort Frames;
+            public ushort Skipped;
+            public uint Off;
+            public ushort Max;
+        }
+
+        /// <summary>~{data:hex:48}</summary>
+        public struct Record
+        {
+            public const int MaxLength = 97;
+            public ArraySegment<byte> Data;
+        }
+
+        /// <summary>CAL {sensor:str:1} base={base:u16}mm noise={noise:u16}mm on={on:u16}mm off={off:u16}mm src={src:str:7}</summary>
+        public struct Calibration
+        {
+            public const int MaxLength = 67;
+            public ArraySegment<byte> Sensor;
+            public ushort Base;
+            public ushort Noise;
+            public ushort On;
+            public ushort Off;
+            public ArraySegment<byte> Src;
+        }
+
+        /// <summary>Turn {n:u8}</summary>
+        public struct Turn
+        {
+            public const int MaxLength = 8;
+            public byte N;
+        }
+
+        /// <summary>Your turn!</summary>
+        public struct YourTurn
+        {
+            public const int MaxLength = 10;
+        }
+
+        /// <summary>Correct!</summary>
+        public struct Correct
+        {
+            public const int MaxLength = 8;
+        }
+
+        /// <summary>Good! Next level...</summary>
+        public struct NextLevel
+        {
+            public const int MaxLength = 19;
+        }
+
+        /// <summary>Wrong! Try again.</summary>
+        public struct Wrong
+        {
+            public const int MaxLength = 17;
+        }
+
+        /// <summary>FAIL! Restarting...</summary>
+        public struct Fail
+        {
+            public const int MaxLength = 19;
+        }
+
+        /// <summary>YOU WIN!</summary>
+        public struct Win
+        {
+            public const int MaxLength = 8;
+        }
+
+        /// <summary>Which message a line is, by its leading literal. Does not validate the rest.</summary>
+        public static MessageKind Classify(byte[] line, int offset, int count)
+        {
+            if (Matches(line, offset, count, L0)) return MessageKind.NextLevel;
+            if (Matches(line, offset, count, L1)) return MessageKind.Fail;
+            if (Matches(line, offset, count, L2)) return MessageKind.Wrong;
+            if (StartsWith(line, offset, count, L3)) return MessageKind.Ready;
+            if (StartsWith(line, offset, count, L4)) return MessageKind.Stall;
+            if (StartsWith(line, offset, count, L5)) return MessageKind.Sound;
+            if (StartsWith(line, offset, count, L6)) return MessageKind.Strips;
+            if (Matches(line, offset, count, L7)) return MessageKind.YourTurn;
+            if (Matches(line, offset, count, L8)) return MessageKind.Correct;
+            if (Matches(line, offset, count, L9)) return MessageKind.Win;
+            if (StartsWith(line, offset, count, L10)) return MessageKind.SyncReply;
+            if (StartsWith(line, offset, count, L11)) return MessageKind.Latency;
+            if (StartsWith(line, offset, count, L12)) return MessageKind.Turn;
+            if (StartsWith(line, offset, count, L13)) return MessageKind.Err;
+            if (StartsWith(line, offset, count, L14)) return MessageKind.Calibration;
+            if (StartsWith(line, offset, count, L15)) return MessageKind.Distance;
+            if (Matches(line, offset, count, L16)) return MessageKind.Ok;
+            if (StartsWith(line, offset, count, L17)) return MessageKind.Record;
+            return MessageKind.Unknown;
+        }
+
+        public static bool TryDecode(byte[] line, int offset, int count, out Ready m)
+        {
+            m = default(Ready);
+            var r = new Reader(line, offset, count);
+            if (!(r.Lit(L3))) return false;
+            if (r.AtEnd) return true;
+            if (!(r.Lit(L18)
+                  && r.Str(0, 12, out m.Fw))) return false;
+            m.HasFw = true;
+            return r.AtEnd;
+        }
+
+        /// <summary>Writes the line without its ending; returns its length. Needs MaxLength bytes.</summary>
+        public static int Encode(in Ready m, byte[] buffer, int offset)
+        {
+            var w = new Writer(buffer, offset);
+            w.Lit(L3);
+            if (m.HasFw)
+            {
+                w.Lit(L18);
+                w.Raw(m.Fw);
+            }
+            return w.Length;
+        }
+
+        public static bool TryDecode(byte[] line, int offset, int count, out Distance m)
+        {
+            m = default(Distance);
+            var r = new Reader(line, offset, count);
+            if (!(r.Lit(L15)
+                  && r.Cm(out m.A)
+                  && r.Lit(L19)
+                  && r.Cm(out m.B))) return false;
+            if (r.AtEnd) return true;
+            if (!(r.Lit(L20)
+                  && r.U32(out m.T))) return false;
+            m.HasT = true;
+            return r.AtEnd;
+        }
+
+        /// <summary>Writes the line without its ending; returns its length. Needs MaxLength bytes.</summary>
+        public static int Encode(in Distance m, byte[] buffer, int offset)
+        {
+            var w = new Writer(buffer, offset);
+            w.Lit(L15);
+            w.Cm(m.A);
+            w.Lit(L19);
+            w.Cm(m.B);
+            if (m.HasT)
+            {
+                w.Lit(L20);
+                w.U32(m.T);
+            }
+            return w.Length;
+        }
+
+        public static bool TryDecode(byte[] line, int offset, int count, out SyncReply m)
+        {
+            m = default(SyncReply);
+            var r = new Reader(line, offset, count);
+            if (!(r.Lit(L10)
+                  && r.U32(out m.T))) return false;
+            return r.AtEnd;
+        }
+
+        /// <summary>Writes the line without its ending; returns its length. Needs MaxLength bytes.</summary>
+        public static int Encode(in SyncReply m, byte[] buffer, int offset)
+        {
+            var w = new Writer(buffer, offset);
+            w.Lit(L10);
+            w.U32(m.T);
+            return w.Length;
+        }
+
+        public static bool TryDecode(byte[] line, int offset, int count, out Ok m)
+        {
+            m = default(Ok);
+            var r = new Reader(line, offset, count);
+            if (!(r.Lit(L16))) return false;
+            return r.AtEnd;
+        }
+
+        /// <summary>Writes the line without its ending; returns its length. Needs MaxLength bytes.</summary>
+        public static int Encode(in Ok m, byte[] buffer, int offset)
+        {
+            var w = new Writer(buffer, offset);
+            w.Lit(L16);
+            return w.Length;
+        }
+
+        public static bool TryDecode(byte[] line, int offset, int count, out Err m)
+        {
+            m = default(Err);
+            var r = new Reader(line, offset, count);
+            if (!(r.Lit(L13)
+                  && r.Str(0, 15, out m.Cmd))) return false;
+            return r.AtEnd;
+        }
+
+        /// <summary>Writes the line without its ending; returns its length. Needs MaxLength bytes.</summary>
+        public static int Encode(in Err m, byte[] buffer, int offset)
+        {
+            var w = new Writer(buffer, offset);
+            w.Lit(L13);
+            w.Raw(m.Cmd);
+            return w.Length;
+        }
+
+        public static bool TryDecode(byte[] line, int offset, int count, out Stall m)
+        {
+            m = default(Stall);
+            var r = new Reader(line, offset, count);
+            if (!(r.Lit(L4)
+                  && r.Str(32, 8, out m.Task)
+                  && r.Lit(L21)
+                  && r.U32(out m.At)
+                  && r.Lit(L22)
+                  && r.U8(out m.Count))) return false;
+            return r.AtEnd;
+        }
+
+        /// <summary>Writes the line without its ending; returns its length. Needs MaxLength bytes.</summary>
+        public static int Encode(in Stall m, byte[] buffer, int offset)
+        {
+            var w = new Writer(buffer, offset);
+            w.Lit(L4);
+            w.Raw(m.Task);
+            w.Lit(L21);
+            w.U32(m.At);
+            w.Lit(L22);
+            w.U32(m.Count);
+            return w.Length;
+        }
+
+        public static bool TryDecode(byte[] line, int offset, int count, out Latency m)
+        {
+            m = default(Latency);
+            var r = new Reader(line, offset, count);
+            if (!(r.Lit(L11)
+                  && r.U8(out m.B)
+                  && r.Lit(L23)
+                  && r.U32(out m.N)
+                  && r.Lit(L24)
+                  && r.Str(32, 3, out m.P50)
+                  && r.Lit(L25)
+                  && r.Str(32, 3, out m.P99)
+                  && r.Lit(L26)
+                  && r.U32(out m.Max)
+                  && r.Lit(L27)
+                  && r.U16s(12, out m.H))) return false;
+            return r.AtEnd;
+        }
+
+        /// <summary>Writes the line without its ending; returns its length. Needs MaxLength bytes.</summary>
+        public static int Encode(in Latency m, byte[] buffer, int offset)
+        {
+            var w = new Writer(buffer, offset);
+            w.Lit(L11);
+            w.U32(m.B);
+            w.Lit(L23);
+            w.U32(m.N);
+            w.Lit(L24);
+            w.Raw(m.P50);
+            w.Lit(L25);
+            w.Raw(m.P99);
+            w.Lit(L26);
+            w.U32(m.Max);
+            w.Lit(L27);
+            w.Raw(m.H);
+            return w.Length;
+        }
+
+        public static bool TryDecode(byte[] line, int offset, int count, out Sound m)
+        {
+            m = default(Sound);
+            var r = new Reader(line, offset, count);
+            if (!(r.Lit(L5)
+                  && r.U8(out m.Voices)
+                  && r.Lit(L28)
+                  && r.U8(out m.Slots)
+                  && r.Lit(L26)
+                  && r.U16(out m.Max)
+                  && r.Lit(L29)
+                  && r.U16(out m.Avg)
+                  && r.Lit(L30)
+                  && r.U8(out m.Load)
+                  && r.Lit(L31)
+                  && r.U16(out m.Budget)
+                  && r.Lit(L32))) return false;
+            return r.AtEnd;
+        }
+
+        /// <summary>Writes the line without its ending; returns its length. Needs MaxLength bytes.</summary>
+        public static int Encode(in Sound m, byte[] buffer, int offset)
+        {
+            var w = new Writer(buffer, offset);
+            w.Lit(L5);
+            w.U32(m.Voices);
+            w.Lit(L28);
+            w.U32(m.Slots);
+            w.Lit(L26);
+            w.U32(m.Max);
+            w.Lit(L29);
+            w.U32(m.Avg);
+            w.Lit(L30);
+            w.U32(m.Load);
+            w.Lit(L31);
+            w.U32(m.Budget);
+            w.Lit(L32);
+            return w.Length;
+        }
+
+        public static bool TryDecode(byte[] line, int offset, int count, out Strips m)
+        {
+            m = default(Strips);
+            var r = new Reader(line, offset, count);
+            if (!(r.Lit(L6)
+                  && r.U16(out m.Frames)
+                  && r.Lit(L33)
+                  && r.U16(out m.Skipped)
+                  && r.Lit(L34)
+                  && r.U32(out m.Off)
+                  && r.Lit(L35)
+                  && r.U16(out m.Max)
+                  && r.Lit(L36))) return false;
+            return r.AtEnd;
+        }
+
+        /// <summary>Writes the line without its ending; returns its length. Needs MaxLength bytes.</summary>
+        public static int Encode(in Strips m, byte[] buffer, int offset)
+        {
+            var w = new Writer(buffer, offset);
+            w.Lit(L6);
+            w.U32(m.Frames);
+            w.Lit(L33);
+            w.U32(m.Skipped);
+            w.Lit(L34);
+            w.U32(m.Off);
+            w.Lit(L35);
+            w.U32(m.Max);
+            w.Lit(L36);
+            return w.Length;
+        }
+
+        public static bool TryDecode(byte[] line, int offset, int count, out Record m)
+        {
+            m = default(Record);
+            var r = new Reader(line, offset, count);
+            if (!(r.Lit(L17)
+                  && r.Hex(48, out m.Data))) return false;
+            return r.AtEnd;
+        }
+
+        /// <summary>Writes the line without its ending; returns its length. Needs MaxLength bytes.</summary>
+        public static int Encode(in Record m, byte[] buffer, int offset)
+        {
+            var w = new Writer(buffer, offset);
+            w.Lit(L17);
+            w.Raw(m.Data);
+            return w.Length;
+        }
+
+        public static bool TryDecode(byte[] line, int offset, int count, out Calibration m)
+        {
+            m = default(Calibration);
+            var r = new Reader(line, offset, count);
+            if (!(r.Lit(L14)
+                  && r.Str(32, 1, out m.Sensor)
+                  && r.Lit(L37)
+                  && r.U16(out m.Base)
+                  && r.Lit(L38)
+                  && r.U16(out m.Noise)
+                  && r.Lit(L39)
+                  && r.U16(out m.On)
+                  && r.Lit(L40)
+                  && r.U16(out m.Off)
+                  && r.Lit(L41)
+                  && r.Str(0, 7, out m.Src))) return false;
+            return r.AtEnd;
+        }
+
+        /// <summary>Writes the line without its ending; returns its length. Needs MaxLength bytes.</summary>
+        public static int Encode(in Calibration m, byte[] buffer, int offset)
+        {
+            var w = new Writer(buffer, offset);
+            w.Lit(L14);
+            w.Raw(m.Sensor);
+            w.Lit(L37);
+            w.U32(m.Base);
+            w.Lit(L38);
+            w.U32(m.Noise);
+            w.Lit(L39);
+            w.U32(m.On);
+            w.Lit(L40);
+            w.U32(m.Off);
+            w.Lit(L41);
+            w.Raw(m.Src);
+            return w.Length;
+        }
+
+        public static bool TryDecode(byte[] line, int offset, int count, out Turn m)
+        {
+            m = default(Turn);
+            var r = new Reader(line, offset, count);
+            if (!(r.Lit(L12)
+                  && r.U8(out m.N))) return false;
+            return r.AtEnd;
+        }
+
+        /// <summary>Writes the line without its ending; returns its length. Needs MaxLength bytes.</summary>
+        public static int Encode(in Turn m, byte[] buffer, int offset)
+        {
+            var w = new Writer(buffer, offset);
+            w.Lit(L12);
+            w.U32(m.N);
+            return w.Length;
+        }
+
+        public static bool TryDecode(byte[] line, int offset, int count, out YourTurn m)
+        {
+            m = default(YourTurn);
+            var r = new Reader(line, offset, count);
+            if (!(r.Lit(L7))) return false;
+            return r.AtEnd;
+        }
+
+        /// <summary>Writes the line without its ending; returns its length. Needs MaxLength bytes.</summary>
+        public static int Encode(in YourTurn m, byte[] buffer, int offset)
+        {
+            var w = new Writer(buffer, offset);
+            w.Lit(L7);
+            return w.Length;
+        }
+
+        public static bool TryDecode(byte[] line, int offset, int count, out Correct m)
+        {
+            m = default(Correct);
+            var r = new Reader(line, offset, count);
+            if (!(r.Lit(L8))) return false;
+            return r.AtEnd;
+        }
+
+        /// <summary>Writes the line without its ending; returns its length. Needs MaxLength bytes.</summary>
+        public static int Encode(in Correct m, byte[] buffer, int offset)
+        {
+            var w = new Writer(buffer, offset);
+            w.Lit(L8);
+            return w.Length;
+        }
+
+        public static bool TryDecode(byte[] line, int offset, int count, out NextLevel m)
+        {
+            m = default(NextLevel);
+            var r = new Reader(line, offset, count);
+            if (!(r.Lit(L0))) return false;
+            return r.AtEnd;
+        }
+
+        /// <summary>Writes the line without its ending; returns its length. Needs MaxLength bytes.</summary>
+        public static int Encode(in NextLevel m, byte[] buffer, int offset)
+        {
+            var w = new Writer(buffer, offset);
+            w.Lit(L0);
+            return w.Length;
+        }
+
+        public static bool TryDecode(byte[] line, int offset, int count, out Wrong m)
+        {
+            m = default(Wrong);
+            var r = new Reader(line, offset, count);
+            if (!(r.Lit(L2))) return false;
+            return r.AtEnd;
+        }
+
+        /// <summary>Writes the line without its ending; returns its length. Needs MaxLength bytes.</summary>
+        public static int Encode(in Wrong m, byte[] buffer, int offset)
+        {
+            var w = new Writer(buffer, offset);
+            w.Lit(L2);
+            return w.Length;
+        }
+
+        public static bool TryDecode(byte[] line, int offset, int count, out Fail m)
+        {
+            m = default(Fail);
+            var r = new Reader(line, offset, count);
+            if (!(r.Lit(L1))) return false;
+            return r.AtEnd;
+        }
+
+        /// <summary>Writes the line without its ending; returns its length. Needs MaxLength bytes.</summary>
+        public static int Encode(in Fail m, byte[] buffer, int offset)
+        {
+            var w = new Writer(buffer, offset);
+            w.Lit(L1);
+            return w.Length;
+        }
+
+        public static bool TryDecode(byte[] line, int offset, int count, out Win m)
+        {
+            m = default(Win);
+            var r = new Reader(line, offset, count);
+            if (!(r.Lit(L9))) return false;
+            return r.AtEnd;
+        }
+
+        /// <summary>Writes the line without its ending; returns its length. Needs MaxLength bytes.</summary>
+        public static int Encode(in Win m, byte[] buffer, int offset)
+        {
+            var w = new Writer(buffer, offset);
+            w.Lit(L9);
+            return w.Length;
+        }
+
+        private static readonly byte[][] CommandLines =
+        {
+            new byte[] { 0x4C, 0x41, 0x54, 0x3F, 0x0A },
+            new byte[] { 0x4C, 0x41, 0x54, 0x30, 0x0A },
+            new byte[] { 0x52, 0x45, 0x43, 0x31, 0x0A },
+            new byte[] { 0x52, 0x45, 0x43, 0x30, 0x0A },
+            new byte[] { 0x53, 0x54, 0x52, 0x45, 0x41, 0x4D, 0x31, 0x0A },
+            new byte[] { 0x53, 0x54, 0x52, 0x45, 0x41, 0x4D, 0x30, 0x0A },
+            new byte[] { 0x53, 0x59, 0x4E, 0x43, 0x0A },
+            new byte[] { 0x49, 0x44, 0x3F, 0x0A },
+            new byte[] { 0x43, 0x41, 0x4C, 0x0A },
+            new byte[] { 0x43, 0x41, 0x4C, 0x3F, 0x0A },
+            new byte[] { 0x4C, 0x45, 0x44, 0x3F, 0x0A },
+            new byte[] { 0x53, 0x4E, 0x44, 0x3F, 0x0A },
+            new byte[] { 0x53, 0x4E, 0x44, 0x30, 0x0A },
+        };
+
+        /// <summary>The command as sent, "\n" included. Shared; do not modify.</summary>
+        public static byte[] CommandLine(Command command)
+        {
+            return CommandLines[(int)command];
+        }
+
+        /// <summary>Recognises a received command line (without its ending).</summary>
+        public static bool TryDecodeCommand(byte[] line, int offset, int count, out Command command)
+        {
+            for (int i = 0; i < CommandLines.Length; i++)
+            {
+                byte[] c = CommandLines[i];
+                if (count != c.Length - 1) continue;
+                int k = 0;
+                while (k < count && line[offset + k] == c[k]) k++;
+                if (k < count) continue;
+                command = (Command)i;
+                return true;
+            }
+            command = default(Command);
+            return false;
+        }
+    }
+}
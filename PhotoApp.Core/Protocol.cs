@@ -0,0 +1,286 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+using System;
+
+namespace PhotoApp.Core
+{
+    /// <summary>
+    /// Host side of the EchoMe serial protocol. The message structs,
+    /// <c>TryDecode</c>/<c>Encode</c> overloads and <see cref="Command"/>
+    /// are generated from protocol/echome.schema into
+    /// Protocol.Generated.cs (tools/protogen); this half holds the
+    /// scanner and writer they share. Decoding is strict (the whole line
+    /// must match its template) and allocation-free: text, list and hex
+    /// fields come back as <see cref="ArraySegment{T}"/> slices of the
+    /// line, to be read with <see cref="Text"/>, <see cref="ReadU16s"/>
+    /// or <see cref="ReadHex"/> if needed.
+    /// </summary>
+    public static partial class Protocol
+    {
+        /// <summary>ASCII text of a str field. Allocates; for logs and tests.</summary>
+        public static string Text(ArraySegment<byte> field)
+        {
+            return field.Array == null ? "" : System.Text.Encoding.ASCII.GetString(field.Array, field.Offset, field.Count);
+        }
+
+        /// <summary>Values of a u16s field into <paramref name="values"/>; returns how many.</summary>
+        public static int ReadU16s(ArraySegment<byte> field, ushort[] values)
+        {
+            int n = 0;
+            int v = 0;
+            bool any = false;
+            for (int i = 0; i < field.Count; i++)
+            {
+                byte c = field.Array[field.Offset + i];
+                if (c == (byte)',')
+                {
+                    if (n < values.Length) values[n] = (ushort)v;
+                    n++;
+                    v = 0;
+                    any = false;
+                }
+                else
+                {
+                    v = v * 10 + (c - '0');
+                    any = true;
+                }
+            }
+            if (any)
+            {
+                if (n < values.Length) values[n] = (ushort)v;
+                n++;
+            }
+            return Math.Min(n, values.Length);
+        }
+
+        /// <summary>Bytes of a hex field into <paramref name="bytes"/>; returns how many.</summary>
+        public static int ReadHex(ArraySegment<byte> field, byte[] bytes, int offset)
+        {
+            int n = Math.Min(field.Count / 2, bytes.Length - offset);
+            for (int i = 0; i < n; i++)
+            {
+                int hi = HexValue(field.Array[field.Offset + 2 * i]);
+                int lo = HexValue(field.Array[field.Offset + 2 * i + 1]);
+                bytes[offset + i] = (byte)(hi << 4 | lo);
+            }
+            return n;
+        }
+
+        private static bool StartsWith(byte[] line, int offset, int count, byte[] literal)
+        {
+            if (count < literal.Length) return false;
+            for (int i = 0; i < literal.Length; i++)
+                if (line[offset + i] != literal[i]) return false;
+            return true;
+        }
+
+        private static bool Matches(byte[] line, int offset, int count, byte[] literal)
+        {
+            return count == literal.Length && StartsWith(line, offset, count, literal);
+        }
+
+        private static int HexValue(byte c)
+        {
+            if (c >= (byte)'0' && c <= (byte)'9') return c - '0';
+            if (c >= (byte)'a' && c <= (byte)'f') return c - 'a' + 10;
+            if (c >= (byte)'A' && c <= (byte)'F') return c - 'A' + 10;
+            return -1;
+        }
+
+        // UTF-8 em dash: a distance with no echo
+        private static readonly byte[] NoEcho = { 0xE2, 0x80, 0x94 };
+        private static readonly byte[] CmSuffix = { (byte)' ', (byte)'c', (byte)'m' };
+
+        // Exact powers of ten for the fraction digits of a distance
+        private static readonly double[] Pow10 = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+
+        /// <summary>Scans one line field by field; every method consumes on success only.</summary>
+        private struct Reader
+        {
+            private readonly byte[] _b;
+            private readonly int _end;
+            private int _p;
+
+            public Reader(byte[] line, int offset, int count)
+            {
+                _b = line;
+                _p = offset;
+                _end = offset + count;
+            }
+
+            public bool AtEnd { get { return _p == _end; } }
+
+            public bool Lit(byte[] literal)
+            {
+                if (_end - _p < literal.Length) return false;
+                for (int i = 0; i < literal.Length; i++)
+                    if (_b[_p + i] != literal[i]) return false;
+                _p += literal.Length;
+                return true;
+            }
+
+            public bool U8(out byte v)
+            {
+                uint x;
+                bool ok = U32(out x) && x <= byte.MaxValue;
+                v = (byte)x;
+                return ok;
+            }
+
+            public bool U16(out ushort v)
+            {
+                uint x;
+                bool ok = U32(out x) && x <= ushort.MaxValue;
+                v = (ushort)x;
+                return ok;
+            }
+
+            public bool U32(out uint v)
+            {
+                ulong x = 0;
+                int p = _p;
+                while (p < _end && IsDigit(_b[p]) && p - _p < 10)
+                {
+                    x = x * 10 + (uint)(_b[p] - '0');
+                    p++;
+                }
+                v = (uint)x;
+                if (p == _p || x > uint.MaxValue || (p < _end && IsDigit(_b[p]))) return false;
+                _p = p;
+                return true;
+            }
+
+            // "12.34 cm" or the em dash
+            public bool Cm(out double v)
+            {
+                v = double.NaN;
+                if (Lit(NoEcho)) return true;
+
+                int p = _p;
+                bool negative = p < _end && _b[p] == (byte)'-';
+                if (negative) p++;
+                long whole = 0, frac = 0;
+                int start = p, fracDigits = 0;
+                while (p < _end && IsDigit(_b[p]) && p - start < 9) whole = whole * 10 + (_b[p++] - '0');
+                if (p == start) return false;
+                if (p < _end && _b[p] == (byte)'.')
+                {
+                    p++;
+                    while (p < _end && IsDigit(_b[p]) && fracDigits < 9) { frac = frac * 10 + (_b[p++] - '0'); fracDigits++; }
+                    if (fracDigits == 0) return false;
+                }
+                int save = _p;
+                _p = p;
+                if (!Lit(CmSuffix)) { _p = save; return false; }
+                double x = whole + frac / Pow10[fracDigits];
+                v = negative ? -x : x;
+                return true;
+            }
+
+            // Up to max bytes, ending before `stop` (0: at the line end)
+            public bool Str(byte stop, int max, out ArraySegment<byte> s)
+            {
+                int p = _p;
+                while (p < _end && _b[p] != stop && p - _p < max) p++;
+                s = new ArraySegment<byte>(_b, _p, p - _p);
+                if (stop == 0 ? p != _end : (p == _end || _b[p] != stop)) return false;
+                _p = p;
+                return true;
+            }
+
+            public bool U16s(int max, out ArraySegment<byte> s)
+            {
+                int p = _p, values = 0;
+                while (p < _end && values < max)
+                {
+                    int start = p;
+                    while (p < _end && IsDigit(_b[p]) && p - start < 5) p++;
+                    if (p == start) break;
+                    values++;
+                    if (p < _end && _b[p] == (byte)',' && values < max) p++;
+                    else break;
+                }
+                s = new ArraySegment<byte>(_b, _p, p - _p);
+                if (values == 0 || _b[p - 1] == (byte)',') return false;
+                _p = p;
+                return true;
+            }
+
+            public bool Hex(int max, out ArraySegment<byte> s)
+            {
+                int p = _p;
+                while (p < _end && HexValue(_b[p]) >= 0 && p - _p < 2 * max) p++;
+                s = new ArraySegment<byte>(_b, _p, p - _p);
+                if ((p - _p) % 2 != 0) return false;
+                _p = p;
+                return true;
+            }
+
+            private static bool IsDigit(byte c) { return c >= (byte)'0' && c <= (byte)'9'; }
+        }
+
+        /// <summary>Appends one line's fields to a caller-owned buffer.</summary>
+        private struct Writer
+        {
+            private readonly byte[] _b;
+            private readonly int _start;
+            private int _p;
+
+            public Writer(byte[] buffer, int offset)
+            {
+                _b = buffer;
+                _start = offset;
+                _p = offset;
+            }
+
+            public int Length { get { return _p - _start; } }
+
+            public void Lit(byte[] literal)
+            {
+                Buffer.BlockCopy(literal, 0, _b, _p, literal.Length);
+                _p += literal.Length;
+            }
+
+            public void Raw(ArraySegment<byte> field)
+            {
+                if (field.Count == 0) return;
+                Buffer.BlockCopy(field.Array, field.Offset, _b, _p, field.Count);
+                _p += field.Count;
+            }
+
+            public void U32(uint v)
+            {
+                int digits = 1;
+                for (uint x = v; x >= 10; x /= 10) digits++;
+                for (int i = digits - 1; i >= 0; i--)
+                {
+                    _b[_p + i] = (byte)('0' + v % 10);
+                    v /= 10;
+                }
+                _p += digits;
+            }
+
+            public void Cm(double v)
+            {
+                if (double.IsNaN(v))
+                {
+                    Lit(NoEcho);
+                    return;
+                }
+                if (v < 0)
+                {
+                    _b[_p++] = (byte)'-';
+                    v = -v;
+                }
+                ulong hundredths = (ulong)(v * 100 + 0.5);
+                U32((uint)(hundredths / 100));
+                _b[_p++] = (byte)'.';
+                _b[_p++] = (byte)('0' + hundredths / 10 % 10);
+                _b[_p++] = (byte)('0' + hundredths % 10);
+                Lit(CmSuffix);
+            }
+        }
+    }
+}
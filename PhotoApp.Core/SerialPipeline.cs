@@ -0,0 +1,282 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+using System;
+using System.Diagnostics;
+using System.IO;
+using System.Threading;
+
+namespace PhotoApp.Core
+{
+    /// <summary>
+    /// Serial ingestion off the UI thread, in three stages:
+    /// <list type="number">
+    /// <item>a reader thread that only copies bytes from the stream into
+    /// pooled chunks,</item>
+    /// <item>a parser thread that feeds them to a <see cref="TelemetryProcessor"/>
+    /// (framing, sensor B, the <see cref="PresenceDetector"/>),</item>
+    /// <item>the processor's coalesced notification for the UI.</item>
+    /// </list>
+    /// Chunks travel over two <see cref="SpscChannel{T}"/>s (full and free),
+    /// so the pool bounds memory. When the parser falls behind, the reader
+    /// waits for a free chunk, and past <see cref="StallMs"/> it drops data
+    /// and counts it. Presence is published as a single latest value.
+    /// <see cref="PresenceChanged"/> fires only when no earlier notification
+    /// is still unread, so the UI gets at most one queued update, however
+    /// fast the device streams.
+    /// Samples stamped with "t=" are debounced on device time, so serial
+    /// buffering cannot distort the debounce windows. On a writable stream
+    /// the pipeline also pings SYNC to keep <see cref="Clock"/> mapping
+    /// device time to host time.
+    /// Two threads per device; for many devices see <see cref="DeviceSession"/>.
+    /// </summary>
+    public sealed class SerialPipeline : IDisposable
+    {
+        private const int ChunkSize = 512;
+        private const int ChunkCount = 16;   // power of two: channel capacity
+        private const int StallMs = 50;      // backpressure before dropping
+
+        private sealed class Chunk
+        {
+            public readonly byte[] Data = new byte[ChunkSize];
+            public int Count;
+            public long Timestamp;   // Stopwatch ticks when read
+            public bool Gap;         // bytes were dropped just before this chunk
+        }
+
+        private readonly Stream _stream;
+        private readonly TelemetryProcessor _telemetry;
+        private readonly SpscChannel<Chunk> _filled = new SpscChannel<Chunk>(ChunkCount);
+        private readonly SpscChannel<Chunk> _free = new SpscChannel<Chunk>(ChunkCount);
+        private readonly ManualResetEventSlim _dataReady = new ManualResetEventSlim(false);
+        private readonly ManualResetEventSlim _spaceReady = new ManualResetEventSlim(false);
+        private readonly byte[] _scratch = new byte[ChunkSize];   // drop target when no chunk is free
+        private readonly Thread _reader;
+        private readonly Thread _parser;
+
+        private volatile bool _stopping;
+        private volatile bool _readerDone;
+
+        // Counters; each is written by the reader thread only
+        private long _bytesRead, _bytesDropped, _stalls;
+
+        public SerialPipeline(Stream stream)
+            : this(stream, new PresenceDetector())
+        {
+        }
+
+        public SerialPipeline(Stream stream, PresenceDetector detector)
+        {
+            if (stream == null) throw new ArgumentNullException(nameof(stream));
+            _stream = stream;
+            _telemetry = new TelemetryProcessor(stream, detector);
+            for (int i = 0; i < ChunkCount; i++) _free.TryWrite(new Chunk());
+
+            _reader = new Thread(ReadLoop) { IsBackground = true, Name = "Serial reader" };
+            _parser = new Thread(ParseLoop) { IsBackground = true, Name = "Serial parser" };
+        }
+
+        /// <summary>
+        /// Raised on the parser thread when the state changed (approach
+        /// included) and the previous notification has been taken. Call
+        /// <see cref="TakeState"/> or <see cref="TakePresence"/> to read the
+        /// state and re-arm it.
+        /// </summary>
+        public event Action PresenceChanged
+        {
+            add { _telemetry.PresenceChanged += value; }
+            remove { _telemetry.PresenceChanged -= value; }
+        }
+
+        /// <summary>Raised on the parser thread once the stream has ended and all data is processed.</summary>
+        public event Action Completed;
+
+        public long BytesRead { get { return Interlocked.Read(ref _bytesRead); } }
+        public long BytesDropped { get { return Interlocked.Read(ref _bytesDropped); } }
+        /// <summary>Times the reader had to wait for the parser.</summary>
+        public long Stalls { get { return Interlocked.Read(ref _stalls); } }
+        public long Samples { get { return _telemetry.Samples; } }
+        /// <summary>Samples that carried a device timestamp.</summary>
+        public long DeviceStamped { get { return _telemetry.DeviceStamped; } }
+        /// <summary>State changes, approaches and receded approaches included.</summary>
+        public long Transitions { get { return _telemetry.Transitions; } }
+        public long Notifications { get { return _telemetry.Notifications; } }
+        /// <summary>Presence changes folded into a notification that was still pending.</summary>
+        public long Coalesced { get { return _telemetry.Coalesced; } }
+        public long LinesOverflowed { get { return _telemetry.LinesOverflowed; } }
+
+        /// <summary>Device-to-host time mapping from SYNC pings.</summary>
+        public ClockSync Clock { get { return _telemetry.Clock; } }
+
+        public void Start()
+        {
+            _parser.Start();
+            _reader.Start();
+            _telemetry.StartSync();
+        }
+
+        /// <summary>Writes one command line to the device. Safe from any thread.</summary>
+        public bool Send(string command)
+        {
+            return _telemetry.Send(command);
+        }
+
+        /// <summary>Current state. Re-arms <see cref="PresenceChanged"/>.</summary>
+        public PresenceState TakeState()
+        {
+            return _telemetry.TakeState();
+        }
+
+        /// <summary>Whether the cube is present. Re-arms <see cref="PresenceChanged"/>.</summary>
+        public bool TakePresence()
+        {
+            return _telemetry.TakePresence();
+        }
+
+        /// <summary>
+        /// Timing of the latest arrival up to the detector decision, or null.
+        /// The UI fills in the remaining stages.
+        /// </summary>
+        public LatencyTrace TakeArrivalTrace()
+        {
+            return _telemetry.TakeArrivalTrace();
+        }
+
+        /// <summary>Waits for the parser to finish after the stream ends.</summary>
+        public bool WaitForCompletion(int timeoutMs)
+        {
+            return _parser.Join(timeoutMs);
+        }
+
+        /// <summary>
+        /// Asks both threads to stop without waiting. The reader only notices
+        /// once its blocking Read returns (data arrives or the stream closes).
+        /// </summary>
+        public void Stop()
+        {
+            _stopping = true;
+            _telemetry.StopSync();
+            _dataReady.Set();
+            _spaceReady.Set();
+        }
+
+        /// <summary>
+        /// Stops and waits for both threads. The reader may be blocked in
+        /// Read, so close the stream (or port) as well; the caller owns it.
+        /// </summary>
+        public void Dispose()
+        {
+            Stop();
+            if (_parser.IsAlive) _parser.Join(3000);
+            if (_reader.IsAlive) _reader.Join(3000);
+        }
+
+        // ------------------ Stage 1: reader ------------------
+        private void ReadLoop()
+        {
+            bool gap = false;
+            Chunk c = null;   // kept across read timeouts; only the parser returns chunks to _free
+            try
+            {
+                while (!_stopping)
+                {
+                    if (c == null) c = TakeFreeChunk();
+                    if (_stopping) break;
+
+                    // No free chunk means the parser is stuck: keep the port
+                    // drained into scratch and remember the hole
+                    byte[] target = c != null ? c.Data : _scratch;
+                    int n;
+                    try
+                    {
+                        n = _stream.Read(target, 0, target.Length);
+                    }
+                    catch (TimeoutException)
+                    {
+                        continue;   // quiet line
+                    }
+                    if (n <= 0) break;   // end of stream
+
+                    if (c == null)
+                    {
+                        Interlocked.Add(ref _bytesDropped, n);
+                        gap = true;
+                        continue;
+                    }
+
+                    c.Count = n;
+                    c.Timestamp = Stopwatch.GetTimestamp();
+                    c.Gap = gap;
+                    gap = false;
+                    Interlocked.Add(ref _bytesRead, n);
+                    _filled.TryWrite(c);   // cannot be full: only ChunkCount chunks exist
+                    c = null;
+                    _dataReady.Set();
+                }
+            }
+            catch (Exception)
+            {
+                // port closed or unplugged
+            }
+            finally
+            {
+                _readerDone = true;
+                _dataReady.Set();
+            }
+        }
+
+        private Chunk TakeFreeChunk()
+        {
+            Chunk c;
+            if (_free.TryRead(out c)) return c;
+
+            Interlocked.Increment(ref _stalls);
+            var deadline = Stopwatch.StartNew();
+            while (!_stopping && deadline.ElapsedMilliseconds < StallMs)
+            {
+                _spaceReady.Reset();
+                if (_free.TryRead(out c)) return c;
+                _spaceReady.Wait(StallMs);
+            }
+            return null;
+        }
+
+        // ------------------ Stage 2: parser + detector ------------------
+        private void ParseLoop()
+        {
+            while (true)
+            {
+                Chunk c;
+                if (!_filled.TryRead(out c))
+                {
+                    if (_stopping) return;
+                    if (_readerDone && _filled.Count == 0) break;
+                    _dataReady.Reset();
+                    if (!_filled.TryRead(out c))
+                    {
+                        _dataReady.Wait(100);
+                        continue;
+                    }
+                }
+
+                Process(c);
+                ReturnChunk(c);
+            }
+
+            var done = Completed;
+            if (done != null) done();
+        }
+
+        private void Process(Chunk c)
+        {
+            _telemetry.Feed(c.Data, 0, c.Count, c.Timestamp, c.Gap);
+        }
+
+        private void ReturnChunk(Chunk c)
+        {
+            _free.TryWrite(c);
+            _spaceReady.Set();
+        }
+    }
+}
@@ -0,0 +1,70 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+using System;
+using System.Threading;
+
+namespace PhotoApp.Core
+{
+    /// <summary>
+    /// Bounded lock-free queue for exactly one producer thread and one
+    /// consumer thread. Neither side ever blocks or allocates; a full
+    /// queue is reported to the producer, which decides whether to wait
+    /// (backpressure) or drop.
+    /// </summary>
+    public sealed class SpscChannel<T>
+    {
+        private readonly T[] _items;
+        private readonly int _mask;
+        private long _head;   // next slot to read, written by the consumer only
+        private long _tail;   // next slot to write, written by the producer only
+        private long _full;
+
+        public SpscChannel(int capacity)
+        {
+            if (capacity <= 0 || (capacity & (capacity - 1)) != 0)
+                throw new ArgumentOutOfRangeException(nameof(capacity), "must be a power of two");
+            _items = new T[capacity];
+            _mask = capacity - 1;
+        }
+
+        public int Capacity { get { return _items.Length; } }
+
+        /// <summary>Items waiting. Exact only when called from one of the two ends.</summary>
+        public int Count { get { return (int)(Volatile.Read(ref _tail) - Volatile.Read(ref _head)); } }
+
+        /// <summary>Times <see cref="TryWrite"/> found the queue full.</summary>
+        public long FullCount { get { return Interlocked.Read(ref _full); } }
+
+        // Producer only
+        public bool TryWrite(T item)
+        {
+            long tail = _tail;
+            if (tail - Volatile.Read(ref _head) >= _items.Length)
+            {
+                Interlocked.Increment(ref _full);
+                return false;
+            }
+            _items[tail & _mask] = item;
+            Volatile.Write(ref _tail, tail + 1);   // publish after the slot is filled
+            return true;
+        }
+
+        // Consumer only
+        public bool TryRead(out T item)
+        {
+            long head = _head;
+            if (head == Volatile.Read(ref _tail))
+            {
+                item = default(T);
+                return false;
+            }
+            int slot = (int)(head & _mask);
+            item = _items[slot];
+            _items[slot] = default(T);
+            Volatile.Write(ref _head, head + 1);   // hand the slot back after it is read
+            return true;
+        }
+    }
+}
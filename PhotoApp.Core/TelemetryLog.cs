@@ -0,0 +1,458 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+using System;
+using System.Globalization;
+using System.IO;
+
+namespace PhotoApp.Core
+{
+    /// <summary>What a <see cref="LogRecord"/> holds: a distance sample or one event.</summary>
+    public enum LogEvent : byte
+    {
+        Sample,
+        Ready,       // device (re)booted
+        Stall,       // watchdog reset; Arg = reset count
+        Arrived,     // detector: cube placed
+        Left,        // detector: cube removed
+        Turn,        // game prompts from here on; Arg = turn number
+        YourTurn,
+        Correct,
+        NextLevel,
+        Wrong,
+        Fail,
+        Win,
+        Calibrated   // device thresholds; Arg = presence sensor's ON threshold in mm
+    }
+
+    /// <summary>One 16-byte entry of a <see cref="TelemetryLog"/>.</summary>
+    public struct LogRecord
+    {
+        /// <summary>A or B of a sample whose sensor saw no echo.</summary>
+        public const ushort NoEcho = 0xFFFF;
+
+        public long TimeUs;      // µs since the Unix epoch, UTC
+        public LogEvent Event;
+        public ushort A;         // samples: distances in 1/100 cm
+        public ushort B;
+        public ushort Arg;       // events: see LogEvent
+
+        public double ACm { get { return ToCm(A); } }
+        public double BCm { get { return ToCm(B); } }
+
+        public DateTime TimeUtc { get { return TelemetryLog.UnixEpoch.AddTicks(TimeUs * 10); } }
+
+        public static ushort FromCm(double cm)
+        {
+            if (double.IsNaN(cm) || cm < 0) return NoEcho;
+            return (ushort)Math.Min(NoEcho - 1, Math.Round(cm * 100));
+        }
+
+        private static double ToCm(ushort v)
+        {
+            return v == NoEcho ? double.NaN : v / 100.0;
+        }
+    }
+
+    /// <summary>
+    /// Append-only history of one device: every distance sample, game
+    /// prompt and presence change, kept for offline analysis with
+    /// <see cref="TelemetryLogReader"/> (photoapp-tools query).
+    ///
+    /// One pair of files per UTC day:
+    ///   yyyy-MM-dd.log   header, then 16-byte records in time order
+    ///   yyyy-MM-dd.idx   header, then one entry per <see cref="BlockRecords"/>
+    ///                    records: the block's first time and a mask of the
+    ///                    <see cref="LogEvent"/>s in it
+    /// The index is tiny (a day at 20 samples/s is 27 KB), so a query reads
+    /// it whole, binary-searches it and skips blocks outside its range or
+    /// without its events; only the blocks left are read, through a memory
+    /// map.
+    ///
+    /// Records are staged in a fixed buffer and written when it fills or a
+    /// second after the last write, so appending allocates nothing and
+    /// costs one write call a second at streaming rates. A crash loses that
+    /// second at most; a torn last record and missing index entries are
+    /// repaired when the day's files are reopened. Times never go backwards
+    /// within a file (a clock step back is clamped).
+    ///
+    /// Thread-safe. Writing never throws: the first I/O error stops the log
+    /// and is kept in <see cref="Error"/>, the device carries on without it.
+    /// </summary>
+    public sealed class TelemetryLog : IDisposable
+    {
+        public const int RecordSize = 16;
+        public const int HeaderSize = 16;
+        public const int IndexEntrySize = 16;
+        public const int BlockRecords = 1024;
+
+        internal const string DataExtension = ".log";
+        internal const string IndexExtension = ".idx";
+        internal const string DayFormat = "yyyy-MM-dd";
+        internal const long UsPerDay = 86400L * 1000000;
+        internal static readonly DateTime UnixEpoch = new DateTime(1970, 1, 1, 0, 0, 0, DateTimeKind.Utc);
+
+        private static readonly byte[] DataMagic = { (byte)'E', (byte)'C', (byte)'H', (byte)'O', (byte)'L', (byte)'O', (byte)'G', (byte)'1' };
+        private static readonly byte[] IndexMagic = { (byte)'E', (byte)'C', (byte)'H', (byte)'O', (byte)'I', (byte)'D', (byte)'X', (byte)'1' };
+
+        private const int StagedRecords = 4096;   // 64 KB
+        private const long FlushIntervalUs = 1000000;
+
+        private readonly string _directory;
+        private readonly object _lock = new object();
+        private readonly byte[] _staged = new byte[StagedRecords * RecordSize];
+        private readonly byte[] _stagedIndex = new byte[(StagedRecords / BlockRecords + 1) * IndexEntrySize];
+        private int _stagedCount, _stagedIndexCount;
+
+        private FileStream _data, _index;
+        private long _day = long.MinValue;   // days since the epoch of the open files
+        private long _records;               // in the open file, staged ones included
+        private long _blockFirstUs;
+        private uint _blockMask;
+        private long _lastUs = long.MinValue;
+        private long _lastFlushUs;
+        private long _hostToUnixUs;
+        private bool _disposed;
+
+        public TelemetryLog(string directory)
+        {
+            if (directory == null) throw new ArgumentNullException(nameof(directory));
+            _directory = directory;
+            _hostToUnixUs = HostToUnixOffset();
+        }
+
+        public string Directory { get { return _directory; } }
+
+        /// <summary>Why the log stopped, or null while it is writing.</summary>
+        public Exception Error { get; private set; }
+
+        public long RecordsWritten { get; private set; }
+
+        /// <summary>Microseconds since the Unix epoch for a <see cref="ClockSync.HostMicros"/> time.</summary>
+        public long UnixMicros(long hostUs)
+        {
+            return hostUs + _hostToUnixUs;
+        }
+
+        /// <summary>A sample read at host time <paramref name="hostUs"/>; NaN for no echo.</summary>
+        public void AppendSample(long hostUs, double aCm, double bCm)
+        {
+            var r = new LogRecord
+            {
+                TimeUs = UnixMicros(hostUs),
+                Event = LogEvent.Sample,
+                A = LogRecord.FromCm(aCm),
+                B = LogRecord.FromCm(bCm)
+            };
+            Append(in r);
+        }
+
+        public void AppendEvent(long hostUs, LogEvent e, int arg)
+        {
+            var r = new LogRecord
+            {
+                TimeUs = UnixMicros(hostUs),
+                Event = e,
+                Arg = (ushort)Math.Min(Math.Max(arg, 0), ushort.MaxValue)
+            };
+            Append(in r);
+        }
+
+        public void Append(in LogRecord record)
+        {
+            lock (_lock)
+            {
+                if (_disposed || Error != null) return;
+                try
+                {
+                    AppendLocked(in record);
+                }
+                catch (Exception ex) when (ex is IOException || ex is UnauthorizedAccessException || ex is InvalidDataException)
+                {
+                    Fail(ex);
+                }
+            }
+        }
+
+        /// <summary>Writes everything staged so far.</summary>
+        public void Flush()
+        {
+            lock (_lock)
+            {
+                if (_disposed || Error != null) return;
+                try
+                {
+                    FlushLocked();
+                }
+                catch (Exception ex) when (ex is IOException || ex is UnauthorizedAccessException)
+                {
+                    Fail(ex);
+                }
+            }
+        }
+
+        public void Dispose()
+        {
+            lock (_lock)
+            {
+                if (_disposed) return;
+                try
+                {
+                    if (Error == null) FlushLocked();
+                }
+                catch (Exception ex) when (ex is IOException || ex is UnauthorizedAccessException)
+                {
+                    Error = ex;
+                }
+                _disposed = true;
+                CloseFiles();
+            }
+        }
+
+        internal static string PartitionName(long day)
+        {
+            return UnixEpoch.AddDays(day).ToString(DayFormat, CultureInfo.InvariantCulture);
+        }
+
+        internal static bool TryParsePartition(string path, out long day)
+        {
+            DateTime date;
+            day = 0;
+            if (!DateTime.TryParseExact(Path.GetFileNameWithoutExtension(path), DayFormat, CultureInfo.InvariantCulture,
+                                        DateTimeStyles.AssumeUniversal | DateTimeStyles.AdjustToUniversal, out date))
+                return false;
+            day = (long)(date - UnixEpoch).TotalDays;
+            return true;
+        }
+
+        internal static bool CheckHeader(byte[] header, bool index)
+        {
+            byte[] magic = index ? IndexMagic : DataMagic;
+            for (int i = 0; i < magic.Length; i++)
+                if (header[i] != magic[i]) return false;
+            return ReadInt32(header, 8) == (index ? IndexEntrySize : RecordSize) && ReadInt32(header, 12) == BlockRecords;
+        }
+
+        internal static void ReadRecord(byte[] b, int o, out LogRecord r)
+        {
+            r.TimeUs = ReadInt64(b, o);
+            r.Event = (LogEvent)b[o + 8];
+            r.A = (ushort)(b[o + 10] | b[o + 11] << 8);
+            r.B = (ushort)(b[o + 12] | b[o + 13] << 8);
+            r.Arg = (ushort)(b[o + 14] | b[o + 15] << 8);
+        }
+
+        internal static long ReadInt64(byte[] b, int o)
+        {
+            return (long)((uint)ReadInt32(b, o) | (ulong)(uint)ReadInt32(b, o + 4) << 32);
+        }
+
+        internal static int ReadInt32(byte[] b, int o)
+        {
+            return b[o] | b[o + 1] << 8 | b[o + 2] << 16 | b[o + 3] << 24;
+        }
+
+        // ------------------ Writing ------------------
+        private void AppendLocked(in LogRecord record)
+        {
+            long t = record.TimeUs;
+            long day = FloorDiv(t, UsPerDay);
+            if (day > _day) OpenDay(day);   // a step back past midnight stays in today's file
+            if (t < _lastUs) t = _lastUs;
+
+            if (_records % BlockRecords == 0)
+            {
+                _blockFirstUs = t;
+                _blockMask = 0;
+            }
+            _blockMask |= 1u << (int)record.Event;
+
+            int o = _stagedCount * RecordSize;
+            WriteInt64(_staged, o, t);
+            _staged[o + 8] = (byte)record.Event;
+            _staged[o + 9] = 0;
+            WriteUInt16(_staged, o + 10, record.A);
+            WriteUInt16(_staged, o + 12, record.B);
+            WriteUInt16(_staged, o + 14, record.Arg);
+            _stagedCount++;
+            _records++;
+            _lastUs = t;
+            RecordsWritten++;
+
+            if (_records % BlockRecords == 0) StageIndexEntry(_blockFirstUs, _blockMask);
+            if (_stagedCount == StagedRecords || t - _lastFlushUs >= FlushIntervalUs)
+            {
+                FlushLocked();
+                _lastFlushUs = t;
+            }
+        }
+
+        // Data first, so an index entry never points past the data
+        private void FlushLocked()
+        {
+            if (_stagedCount > 0)
+            {
+                _data.Write(_staged, 0, _stagedCount * RecordSize);
+                _stagedCount = 0;
+            }
+            if (_stagedIndexCount > 0)
+            {
+                _index.Write(_stagedIndex, 0, _stagedIndexCount * IndexEntrySize);
+                _stagedIndexCount = 0;
+            }
+        }
+
+        private void StageIndexEntry(long firstUs, uint mask)
+        {
+            int o = _stagedIndexCount * IndexEntrySize;
+            WriteInt64(_stagedIndex, o, firstUs);
+            WriteInt32(_stagedIndex, o + 8, (int)mask);
+            WriteInt32(_stagedIndex, o + 12, 0);
+            _stagedIndexCount++;
+        }
+
+        private void OpenDay(long day)
+        {
+            if (_data != null) FlushLocked();
+            CloseFiles();
+            System.IO.Directory.CreateDirectory(_directory);
+            _hostToUnixUs = HostToUnixOffset();   // follow wall-clock corrections once a day
+
+            string name = Path.Combine(_directory, PartitionName(day));
+            // Unbuffered: records are staged here already
+            _data = new FileStream(name + DataExtension, FileMode.OpenOrCreate, FileAccess.ReadWrite, FileShare.Read | FileShare.Delete, 1);
+            _index = new FileStream(name + IndexExtension, FileMode.OpenOrCreate, FileAccess.ReadWrite, FileShare.Read | FileShare.Delete, 1);
+            _day = day;
+
+            _records = Math.Max(0, (OpenFile(_data, false) - HeaderSize) / RecordSize);
+            SetLength(_data, HeaderSize + _records * RecordSize);   // drops a torn record
+            long entries = Math.Max(0, (OpenFile(_index, true) - HeaderSize) / IndexEntrySize);
+            long complete = _records / BlockRecords;
+            if (entries > complete) entries = complete;
+            SetLength(_index, HeaderSize + entries * IndexEntrySize);
+            _index.Seek(0, SeekOrigin.End);
+
+            // Index entries lost in a crash, then the unfinished block
+            _lastUs = long.MinValue;
+            _blockMask = 0;
+            for (long block = entries; block * BlockRecords < _records; block++)
+            {
+                int count = (int)Math.Min(BlockRecords, _records - block * BlockRecords);
+                ScanBlock(block, count);
+                if (count < BlockRecords) break;
+                StageIndexEntry(_blockFirstUs, _blockMask);
+                if (_stagedIndexCount * IndexEntrySize == _stagedIndex.Length) FlushLocked();
+            }
+            if (_lastUs == long.MinValue && _records > 0) _lastUs = LastTime();
+
+            _data.Seek(0, SeekOrigin.End);
+            _lastFlushUs = 0;   // the first record goes straight out
+            FlushLocked();
+        }
+
+        // Length of a file with a valid header, writing one if it is new
+        private static long OpenFile(FileStream file, bool index)
+        {
+            var header = new byte[HeaderSize];
+            if (file.Length < HeaderSize)
+            {
+                Buffer.BlockCopy(index ? IndexMagic : DataMagic, 0, header, 0, 8);
+                WriteInt32(header, 8, index ? IndexEntrySize : RecordSize);
+                WriteInt32(header, 12, BlockRecords);
+                file.SetLength(0);
+                file.Write(header, 0, HeaderSize);
+                return HeaderSize;
+            }
+            file.Position = 0;
+            ReadFully(file, header, HeaderSize);
+            if (!CheckHeader(header, index)) throw new InvalidDataException(file.Name + " is not an EchoMe log file");
+            return file.Length;
+        }
+
+        // Only when it changes: a file mapped by a reader cannot shrink on Windows
+        private static void SetLength(FileStream file, long length)
+        {
+            if (file.Length != length) file.SetLength(length);
+        }
+
+        private void ScanBlock(long block, int count)
+        {
+            _data.Position = HeaderSize + block * BlockRecords * RecordSize;
+            ReadFully(_data, _staged, count * RecordSize);
+            _blockMask = 0;
+            for (int i = 0; i < count; i++)
+            {
+                LogRecord r;
+                ReadRecord(_staged, i * RecordSize, out r);
+                if (i == 0) _blockFirstUs = r.TimeUs;
+                _blockMask |= 1u << (int)r.Event;
+                _lastUs = r.TimeUs;
+            }
+        }
+
+        private long LastTime()
+        {
+            _data.Position = HeaderSize + (_records - 1) * RecordSize;
+            ReadFully(_data, _staged, RecordSize);
+            return ReadInt64(_staged, 0);
+        }
+
+        private void Fail(Exception ex)
+        {
+            Error = ex;
+            _stagedCount = 0;
+            _stagedIndexCount = 0;
+            CloseFiles();
+        }
+
+        private void CloseFiles()
+        {
+            if (_data != null) _data.Dispose();
+            if (_index != null) _index.Dispose();
+            _data = null;
+            _index = null;
+        }
+
+        private static long HostToUnixOffset()
+        {
+            return (DateTime.UtcNow - UnixEpoch).Ticks / 10 - ClockSync.HostMicrosNow();
+        }
+
+        private static long FloorDiv(long a, long b)
+        {
+            long q = a / b;
+            return a % b < 0 ? q - 1 : q;
+        }
+
+        private static void ReadFully(Stream s, byte[] buffer, int count)
+        {
+            for (int got = 0; got < count;)
+            {
+                int n = s.Read(buffer, got, count - got);
+                if (n <= 0) throw new EndOfStreamException();
+                got += n;
+            }
+        }
+
+        internal static void WriteInt64(byte[] b, int o, long v)
+        {
+            WriteInt32(b, o, (int)v);
+            WriteInt32(b, o + 4, (int)(v >> 32));
+        }
+
+        internal static void WriteInt32(byte[] b, int o, int v)
+        {
+            b[o] = (byte)v;
+            b[o + 1] = (byte)(v >> 8);
+            b[o + 2] = (byte)(v >> 16);
+            b[o + 3] = (byte)(v >> 24);
+        }
+
+        internal static void WriteUInt16(byte[] b, int o, ushort v)
+        {
+            b[o] = (byte)v;
+            b[o + 1] = (byte)(v >> 8);
+        }
+    }
+}
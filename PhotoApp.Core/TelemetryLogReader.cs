@@ -0,0 +1,173 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+using System;
+using System.IO;
+using System.IO.MemoryMappedFiles;
+
+namespace PhotoApp.Core
+{
+    /// <summary>Called once per matching record, in time order.</summary>
+    public delegate void LogRecordHandler(in LogRecord record);
+
+    /// <summary>How much of the log a query had to touch.</summary>
+    public struct LogQueryStats
+    {
+        public int Partitions;       // day files opened
+        public long BlocksRead;
+        public long BlocksSkipped;   // by the index: wrong events
+        public long Matched;
+    }
+
+    /// <summary>
+    /// Time-range and event queries over a <see cref="TelemetryLog"/>
+    /// directory. Days outside the range are skipped by file name, blocks
+    /// by the day's index, and the blocks left are read out of a memory
+    /// map of the data file. Safe while the log is being written: each day
+    /// is read up to its length when the query reaches it.
+    /// </summary>
+    public sealed class TelemetryLogReader
+    {
+        /// <summary>Mask for <see cref="Query"/> that matches everything.</summary>
+        public const uint AllEvents = uint.MaxValue;
+
+        private readonly string _directory;
+        private readonly byte[] _block = new byte[TelemetryLog.BlockRecords * TelemetryLog.RecordSize];
+        private readonly byte[] _header = new byte[TelemetryLog.HeaderSize];
+
+        public TelemetryLogReader(string directory)
+        {
+            if (directory == null) throw new ArgumentNullException(nameof(directory));
+            _directory = directory;
+        }
+
+        public static uint Mask(LogEvent e)
+        {
+            return 1u << (int)e;
+        }
+
+        /// <summary>
+        /// Hands every record with <paramref name="fromUs"/> &lt;= time &lt;
+        /// <paramref name="toUs"/> (µs since the Unix epoch) whose event is in
+        /// <paramref name="events"/> (<see cref="Mask"/> bits) to
+        /// <paramref name="handler"/>. Not thread-safe; use one reader per thread.
+        /// </summary>
+        public LogQueryStats Query(long fromUs, long toUs, uint events, LogRecordHandler handler)
+        {
+            var stats = new LogQueryStats();
+            if (!Directory.Exists(_directory) || fromUs >= toUs) return stats;
+
+            string[] files = Directory.GetFiles(_directory, "*" + TelemetryLog.DataExtension);
+            Array.Sort(files, StringComparer.Ordinal);   // yyyy-MM-dd sorts by day
+            foreach (string path in files)
+            {
+                long day;
+                if (!TelemetryLog.TryParsePartition(path, out day)) continue;
+                long dayUs = day * TelemetryLog.UsPerDay;
+                if (dayUs >= toUs) break;
+                if (dayUs + TelemetryLog.UsPerDay <= fromUs) continue;
+
+                stats.Partitions++;
+                QueryDay(path, fromUs, toUs, events, handler, ref stats);
+            }
+            return stats;
+        }
+
+        private void QueryDay(string path, long fromUs, long toUs, uint events, LogRecordHandler handler, ref LogQueryStats stats)
+        {
+            const int RecordSize = TelemetryLog.RecordSize;
+            const int BlockRecords = TelemetryLog.BlockRecords;
+
+            using (var data = new FileStream(path, FileMode.Open, FileAccess.Read, FileShare.ReadWrite | FileShare.Delete, 1))
+            {
+                long records = (data.Length - TelemetryLog.HeaderSize) / RecordSize;
+                if (records <= 0 || data.Read(_header, 0, _header.Length) != _header.Length) return;
+                if (!TelemetryLog.CheckHeader(_header, false)) throw new InvalidDataException(path + " is not an EchoMe log file");
+
+                byte[] index = ReadIndex(Path.ChangeExtension(path, TelemetryLog.IndexExtension));
+                long entries = Math.Min(index.Length / TelemetryLog.IndexEntrySize, records / BlockRecords);
+                long blocks = (records + BlockRecords - 1) / BlockRecords;
+
+                // Last indexed block starting at or before fromUs
+                long lo = 0, hi = entries - 1, first = 0;
+                while (lo <= hi)
+                {
+                    long mid = (lo + hi) / 2;
+                    if (EntryTime(index, mid) <= fromUs)
+                    {
+                        first = mid;
+                        lo = mid + 1;
+                    }
+                    else
+                    {
+                        hi = mid - 1;
+                    }
+                }
+
+                using (var map = MemoryMappedFile.CreateFromFile(data, null, 0, MemoryMappedFileAccess.Read, HandleInheritability.None, true))
+                using (var view = map.CreateViewAccessor(TelemetryLog.HeaderSize, records * RecordSize, MemoryMappedFileAccess.Read))
+                {
+                    for (long b = first; b < blocks; b++)
+                    {
+                        if (b < entries)
+                        {
+                            if (EntryTime(index, b) >= toUs) return;
+                            if ((EntryMask(index, b) & events) == 0)
+                            {
+                                stats.BlocksSkipped++;
+                                continue;
+                            }
+                        }
+
+                        int count = (int)Math.Min(BlockRecords, records - b * BlockRecords);
+                        view.ReadArray(b * BlockRecords * RecordSize, _block, 0, count * RecordSize);
+                        stats.BlocksRead++;
+                        for (int i = 0; i < count; i++)
+                        {
+                            LogRecord r;
+                            TelemetryLog.ReadRecord(_block, i * RecordSize, out r);
+                            if (r.TimeUs >= toUs) return;
+                            if (r.TimeUs < fromUs || (Mask(r.Event) & events) == 0) continue;
+                            stats.Matched++;
+                            handler(in r);
+                        }
+                    }
+                }
+            }
+        }
+
+        // Entries only, header checked; empty if missing or foreign
+        private byte[] ReadIndex(string path)
+        {
+            if (!File.Exists(path)) return new byte[0];
+            using (var file = new FileStream(path, FileMode.Open, FileAccess.Read, FileShare.ReadWrite | FileShare.Delete, 1))
+            {
+                long length = file.Length - TelemetryLog.HeaderSize;
+                if (length <= 0 || file.Read(_header, 0, _header.Length) != _header.Length) return new byte[0];
+                if (!TelemetryLog.CheckHeader(_header, true)) return new byte[0];
+
+                var entries = new byte[length - length % TelemetryLog.IndexEntrySize];
+                int got = 0;
+                while (got < entries.Length)
+                {
+                    int n = file.Read(entries, got, entries.Length - got);
+                    if (n <= 0) break;
+                    got += n;
+                }
+                if (got < entries.Length) Array.Resize(ref entries, got - got % TelemetryLog.IndexEntrySize);
+                return entries;
+            }
+        }
+
+        private static long EntryTime(byte[] index, long entry)
+        {
+            return TelemetryLog.ReadInt64(index, (int)(entry * TelemetryLog.IndexEntrySize));
+        }
+
+        private static uint EntryMask(byte[] index, long entry)
+        {
+            return (uint)TelemetryLog.ReadInt32(index, (int)(entry * TelemetryLog.IndexEntrySize) + 8);
+        }
+    }
+}
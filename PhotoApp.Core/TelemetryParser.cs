@@ -0,0 +1,148 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+namespace PhotoApp.Core
+{
+    /// <summary>
+    /// Allocation-free scanners for the firmware's text telemetry, e.g.
+    /// "A: 10.23 cm | B: 2.75 cm". Equivalent to the old
+    /// <c>\bB:\s*([-+]?\d+(?:\.\d+)?)</c> regex on ASCII input.
+    /// </summary>
+    public static class TelemetryParser
+    {
+        // Exact powers of ten for building a double from digits
+        private static readonly double[] Pow10 =
+        {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8,
+            1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15
+        };
+
+        /// <summary>
+        /// Finds "B:" (case-insensitive, not preceded by a word character)
+        /// and parses the number after it. Returns false when the line has
+        /// no B: value or the value is "—" (no echo).
+        /// </summary>
+        public static bool TryParseDistanceB(byte[] line, int offset, int count, out double cm)
+        {
+            return TryParseField(line, offset, count, (byte)'B', out cm);
+        }
+
+        /// <summary>Same as <see cref="TryParseDistanceB"/> for sensor A.</summary>
+        public static bool TryParseDistanceA(byte[] line, int offset, int count, out double cm)
+        {
+            return TryParseField(line, offset, count, (byte)'A', out cm);
+        }
+
+        /// <summary>
+        /// Parses the "t=&lt;micros&gt;" stamp the firmware appends to distance
+        /// lines and SYNC replies. The value is the raw 32-bit micros(),
+        /// see <see cref="DeviceClock"/> for unwrapping it.
+        /// </summary>
+        public static bool TryParseDeviceTime(byte[] line, int offset, int count, out uint micros)
+        {
+            int end = offset + count;
+            for (int i = offset; i + 1 < end; i++)
+            {
+                if (line[i] != (byte)'t' || line[i + 1] != (byte)'=') continue;
+                if (i > offset && IsWordChar(line[i - 1])) continue;
+
+                ulong v = 0;
+                int p = i + 2;
+                while (p < end && IsDigit(line[p]) && v <= uint.MaxValue)
+                {
+                    v = v * 10 + (uint)(line[p] - '0');
+                    p++;
+                }
+                if (p == i + 2 || v > uint.MaxValue) break;
+                micros = (uint)v;
+                return true;
+            }
+            micros = 0;
+            return false;
+        }
+
+        /// <summary>True when the line starts with <paramref name="prefix"/> (ASCII).</summary>
+        public static bool StartsWith(byte[] line, int offset, int count, string prefix)
+        {
+            if (count < prefix.Length) return false;
+            for (int i = 0; i < prefix.Length; i++)
+                if (line[offset + i] != (byte)prefix[i]) return false;
+            return true;
+        }
+
+        private static bool TryParseField(byte[] line, int offset, int count, byte key, out double cm)
+        {
+            int end = offset + count;
+            byte lower = (byte)(key | 0x20);
+            for (int i = offset; i + 1 < end; i++)
+            {
+                byte c = line[i];
+                if ((c != key && c != lower) || line[i + 1] != (byte)':') continue;
+                if (i > offset && IsWordChar(line[i - 1])) continue;
+
+                int p = i + 2;
+                while (p < end && IsSpace(line[p])) p++;
+                if (TryParseNumber(line, p, end, out cm)) return true;
+            }
+            cm = double.NaN;
+            return false;
+        }
+
+        /// <summary>
+        /// Parses [-+]?\d+(\.\d+)? starting at <paramref name="pos"/>.
+        /// Up to 15 significant digits are exact; the rest is truncated.
+        /// </summary>
+        public static bool TryParseNumber(byte[] s, int pos, int end, out double value)
+        {
+            value = double.NaN;
+            bool negative = false;
+            if (pos < end && (s[pos] == (byte)'-' || s[pos] == (byte)'+'))
+            {
+                negative = s[pos] == (byte)'-';
+                pos++;
+            }
+
+            long mantissa = 0;
+            int digits = 0, scale = 0, intDigits = 0;
+            while (pos < end && IsDigit(s[pos]))
+            {
+                if (digits < 15) { mantissa = mantissa * 10 + (s[pos] - '0'); digits++; }
+                else scale--;   // beyond precision: keep magnitude only
+                intDigits++;
+                pos++;
+            }
+            if (intDigits == 0) return false;
+
+            if (pos + 1 < end && s[pos] == (byte)'.' && IsDigit(s[pos + 1]))
+            {
+                pos++;
+                while (pos < end && IsDigit(s[pos]))
+                {
+                    if (digits < 15) { mantissa = mantissa * 10 + (s[pos] - '0'); digits++; scale++; }
+                    pos++;
+                }
+            }
+
+            double v = mantissa;
+            if (scale > 0) v /= Pow10[scale];
+            else if (scale < 0) v *= System.Math.Pow(10, -scale);
+            value = negative ? -v : v;
+            return true;
+        }
+
+        private static bool IsDigit(byte c) { return c >= (byte)'0' && c <= (byte)'9'; }
+
+        private static bool IsSpace(byte c)
+        {
+            return c == (byte)' ' || c == (byte)'\t' || c == (byte)'\r' || c == (byte)'\n' ||
+                   c == (byte)'\f' || c == (byte)'\v';
+        }
+
+        private static bool IsWordChar(byte c)
+        {
+            return IsDigit(c) || c == (byte)'_' ||
+                   (c >= (byte)'a' && c <= (byte)'z') || (c >= (byte)'A' && c <= (byte)'Z');
+        }
+    }
+}
@@ -0,0 +1,376 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+using System;
+using System.Diagnostics;
+using System.IO;
+using System.Text;
+using System.Threading;
+
+namespace PhotoApp.Core
+{
+    /// <summary>One decoded device line, as <see cref="TelemetryProcessor.Recorded"/> reports it.</summary>
+    public struct TelemetryEvent
+    {
+        public LogEvent Event;
+        public int Arg;            // as LogRecord.Arg
+        public double ACm, BCm;    // samples; NaN for no echo
+        public long HostUs;        // device stamp mapped by SYNC, else ReadHostUs
+        public long ReadHostUs;    // bytes read
+    }
+
+    public delegate void TelemetryEventHandler(in TelemetryEvent e);
+
+    /// <summary>
+    /// Everything that happens to one device's bytes after they are read:
+    /// line framing, SYNC/READY handling, sensor B parsing, the
+    /// <see cref="PresenceDetector"/>, arrival traces, the optional
+    /// <see cref="TelemetryLog"/> and the coalesced
+    /// <see cref="PresenceChanged"/> notification. How the bytes are read is
+    /// up to the owner (<see cref="SerialPipeline"/> uses threads,
+    /// <see cref="DeviceSession"/> async reads).
+    /// <see cref="Feed"/> must not be called concurrently; everything else
+    /// is safe from any thread.
+    /// </summary>
+    public sealed class TelemetryProcessor
+    {
+        private const int SyncBurst = 8;           // quick pings after connecting...
+        private const int SyncBurstMs = 250;
+        private const int SyncIntervalMs = 5000;   // ...then one every few seconds
+
+        private readonly Stream _stream;   // commands only
+        private readonly PresenceDetector _detector;
+        private readonly LineFramer _framer = new LineFramer();
+        private readonly LineHandler _onLine;
+        private readonly DeviceClock _deviceClock = new DeviceClock();
+        private readonly ClockSync _sync = new ClockSync();
+        private readonly object _sendLock = new object();
+        private Timer _syncTimer;
+        private int _syncPings;
+        private long _syncSentUs;   // host time of the unanswered SYNC, 0 = none
+        private long _lineTimestamp;
+
+        // Latest PresenceState and whether the UI has yet to read it
+        private int _state;
+        private int _notifyPending;
+        private LatencyTrace _arrivalTrace;   // latest arrival, until the UI takes it
+
+        // Counters; each is written by the feeding thread only
+        private long _samples, _deviceStamped, _transitions, _notifications, _coalesced;
+
+        public TelemetryProcessor(Stream stream, PresenceDetector detector)
+        {
+            if (stream == null) throw new ArgumentNullException(nameof(stream));
+            if (detector == null) throw new ArgumentNullException(nameof(detector));
+            _stream = stream;
+            _detector = detector;
+            _onLine = OnLine;
+        }
+
+        /// <summary>
+        /// Raised on the feeding thread when the state changed (approach
+        /// included) and the previous notification has been taken. Call
+        /// <see cref="TakeState"/> or <see cref="TakePresence"/> to read the
+        /// state and re-arm it.
+        /// </summary>
+        public event Action PresenceChanged;
+
+        public long Samples { get { return Interlocked.Read(ref _samples); } }
+        /// <summary>Samples that carried a device timestamp.</summary>
+        public long DeviceStamped { get { return Interlocked.Read(ref _deviceStamped); } }
+        /// <summary>State changes, approaches and receded approaches included.</summary>
+        public long Transitions { get { return Interlocked.Read(ref _transitions); } }
+        public long Notifications { get { return Interlocked.Read(ref _notifications); } }
+        /// <summary>Presence changes folded into a notification that was still pending.</summary>
+        public long Coalesced { get { return Interlocked.Read(ref _coalesced); } }
+        public long LinesOverflowed { get { return _framer.LinesOverflowed; } }
+
+        /// <summary>
+        /// History of decoded samples, game prompts and presence changes;
+        /// null (the default) keeps none. Set before the first
+        /// <see cref="Feed"/>; the owner disposes it.
+        /// </summary>
+        public TelemetryLog Log { get; set; }
+
+        /// <summary>
+        /// Raised on the feeding thread for every decoded sample, READY,
+        /// STALL and game prompt (presence goes through
+        /// <see cref="PresenceChanged"/>). Keep handlers short.
+        /// </summary>
+        public event TelemetryEventHandler Recorded;
+
+        /// <summary>Device-to-host time mapping from SYNC pings.</summary>
+        public ClockSync Clock { get { return _sync; } }
+
+        /// <summary>Starts SYNC pings if the stream is writable.</summary>
+        public void StartSync()
+        {
+            lock (_sendLock)
+            {
+                if (_syncTimer != null || !_stream.CanWrite) return;
+                _syncPings = 0;
+                _syncTimer = new Timer(_ => SendSync(), null, 0, SyncBurstMs);
+            }
+        }
+
+        public void StopSync()
+        {
+            lock (_sendLock)
+            {
+                if (_syncTimer != null) _syncTimer.Dispose();
+                _syncTimer = null;
+            }
+        }
+
+        /// <summary>Writes one command line to the device. Safe from any thread.</summary>
+        public bool Send(string command)
+        {
+            return Write(Encoding.ASCII.GetBytes(command + "\n"));
+        }
+
+        /// <summary>Writes one schema command to the device. Safe from any thread.</summary>
+        public bool Send(Protocol.Command command)
+        {
+            return Write(Protocol.CommandLine(command));
+        }
+
+        /// <summary>Current state. Re-arms <see cref="PresenceChanged"/>.</summary>
+        public PresenceState TakeState()
+        {
+            Volatile.Write(ref _notifyPending, 0);
+            return (PresenceState)Volatile.Read(ref _state);
+        }
+
+        /// <summary>Whether the cube is present. Re-arms <see cref="PresenceChanged"/>.</summary>
+        public bool TakePresence()
+        {
+            return TakeState() == PresenceState.Present;
+        }
+
+        /// <summary>
+        /// Timing of the latest arrival up to the detector decision, or null.
+        /// The UI fills in the remaining stages.
+        /// </summary>
+        public LatencyTrace TakeArrivalTrace()
+        {
+            return Interlocked.Exchange(ref _arrivalTrace, null);
+        }
+
+        /// <summary>
+        /// Processes bytes read at <paramref name="timestamp"/> (Stopwatch
+        /// ticks). <paramref name="gap"/> says bytes were lost just before
+        /// these, so the partial line is dropped and framing resyncs.
+        /// </summary>
+        public void Feed(byte[] data, int offset, int count, long timestamp, bool gap)
+        {
+            int end = offset + count;
+            if (gap)
+            {
+                _framer.Reset();
+                while (offset < end && data[offset] != (byte)'\n' && data[offset] != (byte)'\r') offset++;
+            }
+            _lineTimestamp = timestamp;
+            _framer.Feed(data, offset, end - offset, _onLine);
+        }
+
+        private void OnLine(byte[] buffer, int offset, int count)
+        {
+            switch (Protocol.Classify(buffer, offset, count))
+            {
+                case Protocol.MessageKind.SyncReply:
+                    Protocol.SyncReply reply;
+                    if (Protocol.TryDecode(buffer, offset, count, out reply)) OnSyncReply(reply.T);
+                    return;
+                case Protocol.MessageKind.Ready:
+                    // Rebooted: micros() restarted and old pings no longer apply
+                    _deviceClock.Restart();
+                    _sync.Reset();
+                    RecordLine(LogEvent.Ready, 0);
+                    return;
+                case Protocol.MessageKind.Stall:
+                    Protocol.Stall stall;
+                    if (Protocol.TryDecode(buffer, offset, count, out stall)) RecordLine(LogEvent.Stall, stall.Count);
+                    return;
+                case Protocol.MessageKind.Calibration:
+                    Protocol.Calibration cal;
+                    if (Protocol.TryDecode(buffer, offset, count, out cal)) OnCalibration(cal);
+                    return;
+                case Protocol.MessageKind.Turn:
+                    Protocol.Turn turn;
+                    if (Protocol.TryDecode(buffer, offset, count, out turn)) RecordLine(LogEvent.Turn, turn.N);
+                    return;
+                case Protocol.MessageKind.YourTurn: RecordLine(LogEvent.YourTurn, 0); return;
+                case Protocol.MessageKind.Correct: RecordLine(LogEvent.Correct, 0); return;
+                case Protocol.MessageKind.NextLevel: RecordLine(LogEvent.NextLevel, 0); return;
+                case Protocol.MessageKind.Wrong: RecordLine(LogEvent.Wrong, 0); return;
+                case Protocol.MessageKind.Fail: RecordLine(LogEvent.Fail, 0); return;
+                case Protocol.MessageKind.Win: RecordLine(LogEvent.Win, 0); return;
+                case Protocol.MessageKind.Distance:
+                    break;
+                default:
+                    return;
+            }
+
+            Protocol.Distance line;
+            if (!Protocol.TryDecode(buffer, offset, count, out line)) return;
+            long deviceUs = line.HasT ? _deviceClock.Extend(line.T) : -1;
+            if (Log != null || Recorded != null)
+                Record(LogEvent.Sample, 0, line.A, line.B, SampleHostUs(deviceUs));   // no-echo samples too
+
+            if (double.IsNaN(line.B)) return;
+            double cm = line.B;
+            Interlocked.Increment(ref _samples);
+
+            // Device time when stamped, else (older firmware) when the bytes were read
+            long ms;
+            if (deviceUs >= 0)
+            {
+                Interlocked.Increment(ref _deviceStamped);
+                ms = deviceUs / 1000;
+            }
+            else
+            {
+                ms = _lineTimestamp * 1000 / Stopwatch.Frequency;
+            }
+
+            PresenceChange change = _detector.Update(cm, ms);
+            if (change == PresenceChange.None) return;
+
+            if (change == PresenceChange.Arrived)
+            {
+                long belowMs = _detector.BelowSinceMs;
+                long approachMs = _detector.ApproachSinceMs >= 0 ? _detector.ApproachSinceMs : belowMs;
+                Volatile.Write(ref _arrivalTrace, TraceArrival(deviceUs, ms, approachMs, belowMs));
+            }
+            var log = Log;
+            if (log != null && (change == PresenceChange.Arrived || change == PresenceChange.Left))
+                log.AppendEvent(SampleHostUs(deviceUs), change == PresenceChange.Arrived ? LogEvent.Arrived : LogEvent.Left, 0);
+            Publish(_detector.State);
+        }
+
+        // The presence sensor's thresholds come from the device once it has
+        // calibrated them; "default" means it has none of its own
+        private void OnCalibration(in Protocol.Calibration cal)
+        {
+            if (cal.Sensor.Count != 1 || cal.Sensor.Array[cal.Sensor.Offset] != (byte)'B') return;
+            if (Protocol.Text(cal.Src) == "default") return;
+            // The device rounds to whole mm, then is ON at or below on= and OFF
+            // above off=; half a mm up gives the same band (and width) in cm
+            _detector.SetThresholds((cal.On + 0.5) / 10.0, (cal.Off + 0.5) / 10.0);
+            RecordLine(LogEvent.Calibrated, cal.On);
+        }
+
+        // Host time of a sample: its device stamp once synced, else when it was read
+        private long SampleHostUs(long deviceUs)
+        {
+            return deviceUs >= 0 && _sync.IsSynced ? _sync.ToHostUs(deviceUs) : ClockSync.HostMicros(_lineTimestamp);
+        }
+
+        private void RecordLine(LogEvent e, int arg)
+        {
+            Record(e, arg, double.NaN, double.NaN, ClockSync.HostMicros(_lineTimestamp));
+        }
+
+        // One decoded line to the log and to Recorded
+        private void Record(LogEvent e, int arg, double aCm, double bCm, long hostUs)
+        {
+            var log = Log;
+            if (log != null)
+            {
+                if (e == LogEvent.Sample) log.AppendSample(hostUs, aCm, bCm);
+                else log.AppendEvent(hostUs, e, arg);
+            }
+            var handler = Recorded;
+            if (handler != null)
+            {
+                var r = new TelemetryEvent
+                {
+                    Event = e,
+                    Arg = arg,
+                    ACm = aCm,
+                    BCm = bCm,
+                    HostUs = hostUs,
+                    ReadHostUs = ClockSync.HostMicros(_lineTimestamp)
+                };
+                handler(in r);
+            }
+        }
+
+        // Detector times are device ms when deviceUs >= 0, else host ms
+        private LatencyTrace TraceArrival(long deviceUs, long ms, long approachMs, long belowMs)
+        {
+            var t = new LatencyTrace
+            {
+                SmoothUs = (belowMs - approachMs) * 1000,
+                DebounceUs = (ms - belowMs) * 1000,
+                ReadHostUs = ClockSync.HostMicros(_lineTimestamp),
+                DetectedHostUs = ClockSync.HostMicrosNow()
+            };
+            if (deviceUs < 0)
+            {
+                t.ApproachHostUs = approachMs * 1000;
+            }
+            else if (_sync.IsSynced)
+            {
+                t.SampleHostUs = _sync.ToHostUs(deviceUs);
+                t.ApproachHostUs = _sync.ToHostUs(approachMs * 1000);
+            }
+            return t;
+        }
+
+        // ------------------ Clock sync ------------------
+        // Timer thread
+        private void SendSync()
+        {
+            lock (_sendLock)
+            {
+                if (_syncTimer == null) return;
+                if (++_syncPings == SyncBurst) _syncTimer.Change(SyncIntervalMs, SyncIntervalMs);
+                // One ping in flight; an unanswered one (old firmware, lost line) is replaced
+                Volatile.Write(ref _syncSentUs, ClockSync.HostMicrosNow());
+                if (!Write(Protocol.CommandLine(Protocol.Command.Sync))) Volatile.Write(ref _syncSentUs, 0);
+            }
+        }
+
+        // Feeding thread
+        private void OnSyncReply(uint micros)
+        {
+            long sent = Interlocked.Exchange(ref _syncSentUs, 0);
+            long device = _deviceClock.Extend(micros);
+            if (sent != 0) _sync.Add(sent, device, ClockSync.HostMicros(_lineTimestamp));
+        }
+
+        private bool Write(byte[] bytes)
+        {
+            lock (_sendLock)
+            {
+                try
+                {
+                    _stream.Write(bytes, 0, bytes.Length);
+                    return true;
+                }
+                catch (Exception)
+                {
+                    return false;   // port closing; the reader reports the end
+                }
+            }
+        }
+
+        // ------------------ Coalesced UI notification ------------------
+        private void Publish(PresenceState state)
+        {
+            Interlocked.Increment(ref _transitions);
+            Volatile.Write(ref _state, (int)state);
+
+            if (Interlocked.CompareExchange(ref _notifyPending, 1, 0) != 0)
+            {
+                Interlocked.Increment(ref _coalesced);   // UI will read the new value anyway
+                return;
+            }
+            Interlocked.Increment(ref _notifications);
+            var handler = PresenceChanged;
+            if (handler != null) handler();
+        }
+    }
+}
@@ -0,0 +1,229 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.IO.Pipes;
+using System.Threading;
+using System.Threading.Tasks;
+using PhotoApp.Core;
+
+namespace PhotoApp.Daemon
+{
+    /// <summary>
+    /// Serves the <see cref="HostEvents"/> stream on a named pipe (a Unix
+    /// domain socket outside Windows). <see cref="Publish"/> runs on the
+    /// device's read thread: it encodes the frame once per subscriber into
+    /// that subscriber's ring and wakes its writer thread, so a slow or
+    /// stuck subscriber loses its own frames (the sequence jumps) and never
+    /// holds up the serial read or anyone else.
+    /// </summary>
+    internal sealed class EventServer : IDisposable
+    {
+        private const int QueueFrames = 4096;
+
+        private readonly string _pipeName;
+        private readonly object _gate = new object();
+        private readonly List<Subscriber> _subscribers = new List<Subscriber>();
+        private readonly Dictionary<byte, HostEvent> _devices = new Dictionary<byte, HostEvent>();   // DeviceUp frames, Code kept current
+        private readonly CancellationTokenSource _cancel = new CancellationTokenSource();
+        private Task _accept;
+
+        public EventServer(string pipeName)
+        {
+            _pipeName = pipeName;
+        }
+
+        public int Subscribers { get { lock (_gate) return _subscribers.Count; } }
+
+        public void Start()
+        {
+            if (_accept == null) _accept = Task.Run(AcceptLoopAsync);
+        }
+
+        /// <summary>
+        /// Stamps <see cref="HostEvent.PublishedHostUs"/> and queues the
+        /// frame for every subscriber that asked for its type.
+        /// </summary>
+        public void Publish(ref HostEvent e)
+        {
+            e.PublishedHostUs = ClockSync.HostMicrosNow();
+            lock (_gate)
+            {
+                switch (e.Type)
+                {
+                    case HostFrameType.DeviceUp:
+                        _devices[e.Device] = e;
+                        break;
+                    case HostFrameType.DeviceDown:
+                        _devices.Remove(e.Device);
+                        break;
+                    case HostFrameType.Presence:
+                        HostEvent up;
+                        if (_devices.TryGetValue(e.Device, out up))
+                        {
+                            up.Code = e.Code;
+                            _devices[e.Device] = up;
+                        }
+                        break;
+                }
+                for (int i = 0; i < _subscribers.Count; i++) _subscribers[i].Enqueue(ref e);
+            }
+        }
+
+        public void Dispose()
+        {
+            _cancel.Cancel();
+            var accept = _accept;
+            if (accept != null) accept.Wait(1000);
+            Subscriber[] all;
+            lock (_gate) all = _subscribers.ToArray();
+            foreach (Subscriber s in all) s.Dispose();
+        }
+
+        private async Task AcceptLoopAsync()
+        {
+            while (!_cancel.IsCancellationRequested)
+            {
+                var pipe = new NamedPipeServerStream(_pipeName, PipeDirection.InOut,
+                    NamedPipeServerStream.MaxAllowedServerInstances, PipeTransmissionMode.Byte, PipeOptions.Asynchronous);
+                try
+                {
+                    await pipe.WaitForConnectionAsync(_cancel.Token).ConfigureAwait(false);
+                }
+                catch (Exception)
+                {
+                    pipe.Dispose();
+                    if (_cancel.IsCancellationRequested) return;
+                    continue;   // client gave up mid-connect
+                }
+                new Subscriber(this, pipe).Start();
+            }
+        }
+
+        // Called once the subscriber has said what it wants; the snapshot and
+        // the registration happen under one lock, so no live frame for a
+        // device can overtake its DeviceUp
+        private void Add(Subscriber s)
+        {
+            lock (_gate)
+            {
+                _subscribers.Add(s);
+                foreach (HostEvent up in _devices.Values)
+                {
+                    HostEvent e = up;
+                    s.Enqueue(ref e);
+                }
+            }
+        }
+
+        private void Remove(Subscriber s)
+        {
+            lock (_gate) _subscribers.Remove(s);
+        }
+
+        private sealed class Subscriber : IDisposable
+        {
+            private readonly EventServer _server;
+            private readonly NamedPipeServerStream _pipe;
+            private readonly byte[] _ring = new byte[QueueFrames * HostEvents.FrameSize];
+            private readonly object _lock = new object();
+            private int _head, _count;
+            private uint _sequence;
+            private uint _mask;
+            private bool _closed;
+
+            public Subscriber(EventServer server, NamedPipeServerStream pipe)
+            {
+                _server = server;
+                _pipe = pipe;
+            }
+
+            public void Start()
+            {
+                new Thread(Run) { IsBackground = true, Name = "Subscriber" }.Start();
+            }
+
+            // Under the server's gate; only takes the queue lock briefly
+            public void Enqueue(ref HostEvent e)
+            {
+                if ((_mask & HostEvents.Mask(e.Type)) == 0) return;
+                lock (_lock)
+                {
+                    e.Sequence = _sequence++;
+                    if (_count == QueueFrames || _closed) return;   // dropped; the jump tells the subscriber
+                    int slot = (_head + _count) % QueueFrames;
+                    HostEvents.Write(in e, _ring, slot * HostEvents.FrameSize);
+                    if (_count++ == 0) Monitor.Pulse(_lock);
+                }
+            }
+
+            public void Dispose()
+            {
+                lock (_lock)
+                {
+                    _closed = true;
+                    Monitor.Pulse(_lock);
+                }
+                _pipe.Dispose();
+            }
+
+            private void Run()
+            {
+                var frame = new byte[HostEvents.FrameSize];
+                var batch = new byte[QueueFrames * HostEvents.FrameSize];
+                try
+                {
+                    if (!ReadFull(frame)) return;
+                    HostEvent subscribe;
+                    HostEvents.Read(frame, 0, out subscribe);
+                    if (subscribe.Type != HostFrameType.Subscribe) return;
+                    _mask = subscribe.Sequence | HostEvents.AlwaysSent;
+                    _server.Add(this);
+
+                    while (true)
+                    {
+                        int bytes;
+                        lock (_lock)
+                        {
+                            while (_count == 0 && !_closed) Monitor.Wait(_lock);
+                            if (_closed) return;
+
+                            // Everything queued in at most two copies, then write outside the lock
+                            int first = Math.Min(_count, QueueFrames - _head);
+                            Buffer.BlockCopy(_ring, _head * HostEvents.FrameSize, batch, 0, first * HostEvents.FrameSize);
+                            Buffer.BlockCopy(_ring, 0, batch, first * HostEvents.FrameSize, (_count - first) * HostEvents.FrameSize);
+                            bytes = _count * HostEvents.FrameSize;
+                            _head = (_head + _count) % QueueFrames;
+                            _count = 0;
+                        }
+                        _pipe.Write(batch, 0, bytes);
+                    }
+                }
+                catch (Exception ex) when (ex is IOException || ex is ObjectDisposedException)
+                {
+                    // subscriber went away
+                }
+                finally
+                {
+                    _server.Remove(this);
+                    Dispose();
+                }
+            }
+
+            private bool ReadFull(byte[] buffer)
+            {
+                int have = 0;
+                while (have < buffer.Length)
+                {
+                    int n = _pipe.Read(buffer, have, buffer.Length - have);
+                    if (n <= 0) return false;
+                    have += n;
+                }
+                return true;
+            }
+        }
+    }
+}
@@ -0,0 +1,168 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Threading;
+using PhotoApp.Core;
+
+namespace PhotoApp.Daemon
+{
+    /// <summary>
+    /// The devices the daemon owns. Each port gets a DeviceSession (framing,
+    /// SYNC, PresenceDetector) and optionally a TelemetryLog; its decoded
+    /// lines and presence changes are published straight from the read
+    /// thread, with no hop through any other thread before the subscriber's
+    /// writer.
+    /// </summary>
+    internal sealed class HostDaemon : IDisposable
+    {
+        private sealed class Device
+        {
+            public byte Id;
+            public string Name;
+            public Stream Port;
+            public DeviceSession Session;
+            public TelemetryLog Log;
+        }
+
+        private readonly EventServer _server;
+        private readonly string _logFolder;   // null: no log
+        private readonly object _gate = new object();
+        private readonly List<Device> _devices = new List<Device>();
+        private byte _nextId = 1;
+
+        public HostDaemon(EventServer server, string logFolder)
+        {
+            _server = server;
+            _logFolder = logFolder;
+        }
+
+        /// <summary>Raised when a port closes, fails or is unplugged.</summary>
+        public event Action<string> DeviceLost;
+
+        /// <summary>Takes over a port DeviceDiscovery found, starts reading and announces it.</summary>
+        public void Attach(DiscoveredDevice found)
+        {
+            string port = found.Port;
+            var device = new Device { Name = port, Port = found.Stream };
+            lock (_gate) device.Id = _nextId++;
+            try
+            {
+                device.Session = new DeviceSession(port, device.Port);
+                if (_logFolder != null)
+                {
+                    device.Log = new TelemetryLog(Path.Combine(_logFolder, Path.GetFileName(port)));
+                    device.Session.Telemetry.Log = device.Log;
+                }
+                device.Session.Telemetry.Recorded += (in TelemetryEvent r) => Device_Recorded(device, in r);
+                device.Session.Telemetry.PresenceChanged += () => Device_PresenceChanged(device);
+                device.Session.Completed += s => Device_Completed(device);
+
+                var up = new HostEvent { Type = HostFrameType.DeviceUp, Device = device.Id, Code = (byte)PresenceState.Absent, Name = port };
+                _server.Publish(ref up);
+                lock (_gate) _devices.Add(device);
+
+                device.Session.Start();
+                device.Session.Telemetry.Send(Protocol.Command.StreamOn);   // every sample, device-stamped (older firmware answers ERR)
+            }
+            catch
+            {
+                Close(device);
+                throw;
+            }
+        }
+
+        public void Dispose()
+        {
+            Device[] all;
+            lock (_gate) all = _devices.ToArray();
+            foreach (Device d in all) Close(d);
+        }
+
+        private void Device_Recorded(Device device, in TelemetryEvent r)
+        {
+            var e = new HostEvent
+            {
+                Device = device.Id,
+                Code = (byte)r.Event,
+                Arg = (ushort)r.Arg,
+                SampleHostUs = r.HostUs,
+                ReadHostUs = r.ReadHostUs,
+                ApproachHostUs = -1
+            };
+            if (r.Event == LogEvent.Sample)
+            {
+                e.Type = HostFrameType.Sample;
+                e.A = LogRecord.FromCm(r.ACm);
+                e.B = LogRecord.FromCm(r.BCm);
+            }
+            else
+            {
+                e.Type = HostFrameType.Event;
+                e.A = e.B = LogRecord.NoEcho;
+            }
+            _server.Publish(ref e);
+        }
+
+        private void Device_PresenceChanged(Device device)
+        {
+            PresenceState state = device.Session.Telemetry.TakeState();
+            LatencyTrace trace = state == PresenceState.Present ? device.Session.Telemetry.TakeArrivalTrace() : null;
+            var e = new HostEvent
+            {
+                Type = HostFrameType.Presence,
+                Device = device.Id,
+                Code = (byte)state,
+                A = LogRecord.NoEcho,
+                B = LogRecord.NoEcho,
+                SampleHostUs = -1,
+                ReadHostUs = -1,
+                ApproachHostUs = -1,
+                SmoothUs = -1,
+                DebounceUs = -1
+            };
+            if (trace != null)
+            {
+                e.SampleHostUs = trace.SampleHostUs;
+                e.ReadHostUs = trace.ReadHostUs;
+                e.ApproachHostUs = trace.ApproachHostUs;
+                e.SmoothUs = (int)trace.SmoothUs;
+                e.DebounceUs = (int)trace.DebounceUs;
+            }
+            _server.Publish(ref e);
+        }
+
+        private void Device_Completed(Device device)
+        {
+            bool owned;
+            lock (_gate) owned = _devices.Contains(device);
+            if (!owned) return;   // closed by us
+
+            // Not on the session's own thread: disposing it waits for that thread
+            ThreadPool.QueueUserWorkItem(_ =>
+            {
+                Close(device);
+                var lost = DeviceLost;
+                if (lost != null) lost(device.Name);
+            });
+        }
+
+        private void Close(Device device)
+        {
+            bool announced;
+            lock (_gate) announced = _devices.Remove(device);
+            if (announced)
+            {
+                var down = new HostEvent { Type = HostFrameType.DeviceDown, Device = device.Id };
+                _server.Publish(ref down);
+            }
+            if (device.Session != null) device.Session.Stop();
+            if (device.Port != null) device.Port.Dispose();   // wakes the pending read
+            if (device.Session != null) device.Session.Dispose();
+            if (device.Log != null) device.Log.Dispose();      // after the session: no more appends
+        }
+    }
+}
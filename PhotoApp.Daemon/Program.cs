@@ -0,0 +1,112 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Runtime.InteropServices;
+using System.Threading;
+using PhotoApp.Core;
+
+namespace PhotoApp.Daemon
+{
+    /// <summary>
+    /// echome-hostd: owns the EchoMe serial ports, runs framing, detection
+    /// and debounce, logs, and publishes presence, game events and
+    /// (on request) samples to local subscribers. PhotoApp attaches to it
+    /// when it is running; see <see cref="HostEvents"/> for the stream.
+    /// Boards are found by <see cref="DeviceDiscovery"/>, among the ports
+    /// given or else every USB serial port, and picked up again after
+    /// being unplugged.
+    /// </summary>
+    internal static class Program
+    {
+        private sealed class Options
+        {
+            public string Pipe = HostEvents.DefaultPipeName;
+            public string LogFolder = Path.Combine(
+                Environment.GetFolderPath(Environment.SpecialFolder.LocalApplicationData), "RemindME", "Log");
+            public readonly List<string> Ports = new List<string>();
+        }
+
+        private static int Main(string[] args)
+        {
+            Options o = Parse(args);
+            if (o == null)
+            {
+                Console.Error.WriteLine("usage: echome-hostd [--pipe name|/socket/path] [--log folder | --no-log] [port...]");
+                Console.Error.WriteLine("  with no ports, every USB serial port is probed for an EchoMe");
+                return 2;
+            }
+
+            var stop = new ManualResetEventSlim();
+            Console.CancelKeyPress += (s, e) => { e.Cancel = true; stop.Set(); };
+            using (PosixSignalRegistration.Create(PosixSignal.SIGTERM, c => { c.Cancel = true; stop.Set(); }))   // service stop
+            using (var server = new EventServer(o.Pipe))
+            using (var daemon = new HostDaemon(server, o.LogFolder))
+            using (var discovery = new DeviceDiscovery(Candidates(o.Ports), SerialDevice.Open))
+            {
+                discovery.Found += found =>
+                {
+                    try
+                    {
+                        daemon.Attach(found);
+                        Console.WriteLine("{0}: EchoMe {1}, answered in {2} ms", found.Port, found.Firmware ?? "(no version)", found.ProbeMs);
+                    }
+                    catch (Exception ex)
+                    {
+                        Console.Error.WriteLine("{0}: {1}", found.Port, ex.Message);
+                        discovery.Release(found.Port);
+                    }
+                };
+                discovery.Rejected += port => Console.WriteLine("{0}: not an EchoMe", port);
+                daemon.DeviceLost += port =>
+                {
+                    Console.WriteLine("{0}: closed, watching for it", port);
+                    discovery.Release(port);
+                };
+
+                server.Start();
+                discovery.Start();
+                Console.WriteLine("publishing on {0}{1}; Ctrl+C to stop", o.Pipe,
+                    o.LogFolder != null ? ", logging to " + o.LogFolder : "");
+                stop.Wait();
+            }
+            return 0;
+        }
+
+        private static Options Parse(string[] args)
+        {
+            var o = new Options();
+            for (int i = 0; i < args.Length; i++)
+            {
+                string a = args[i];
+                string v = i + 1 < args.Length ? args[i + 1] : null;
+                switch (a)
+                {
+                    case "--pipe": if (v == null) return null; o.Pipe = v; i++; break;
+                    case "--log": if (v == null) return null; o.LogFolder = v; i++; break;
+                    case "--no-log": o.LogFolder = null; break;
+                    default:
+                        if (a.StartsWith("-")) return null;
+                        o.Ports.Add(a);
+                        break;
+                }
+            }
+            return o;
+        }
+
+        // The ports named on the command line that exist right now, or every USB serial port
+        private static Func<string[]> Candidates(List<string> named)
+        {
+            if (named.Count == 0) return SerialDevice.List;
+            return () =>
+            {
+                string[] present = SerialDevice.List();
+                return named.Where(p => present.Contains(p, StringComparer.OrdinalIgnoreCase) || File.Exists(p)).ToArray();
+            };
+        }
+    }
+}
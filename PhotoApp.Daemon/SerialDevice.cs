@@ -0,0 +1,149 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+using System;
+using System.Collections.Generic;
+using System.ComponentModel;
+using System.IO;
+using System.Runtime.InteropServices;
+using Microsoft.Win32;
+using Microsoft.Win32.SafeHandles;
+
+namespace PhotoApp.Daemon
+{
+    /// <summary>
+    /// Opens a serial port at the EchoMe's 9600 8N1 without System.IO.Ports,
+    /// as a <see cref="SerialStream"/>. Linux and macOS set the tty raw
+    /// through termios (also fine on a pty from photoapp-tools emulate);
+    /// Windows opens \\.\COMn and sets the DCB and timeouts directly.
+    /// </summary>
+    internal static class SerialDevice
+    {
+        private const int Baud = 9600;
+
+        public static Stream Open(string port)
+        {
+            if (OperatingSystem.IsWindows()) return OpenWindows(port);
+            return OpenPosix(port);
+        }
+
+        // USB serial adapters only: built-in UARTs and terminals are not EchoMes
+        private static readonly string[] PosixPatterns = { "ttyACM*", "ttyUSB*", "cu.usbmodem*", "cu.usbserial*", "cu.wchusbserial*" };
+
+        /// <summary>Serial ports present now, for DeviceDiscovery.</summary>
+        public static string[] List()
+        {
+            var ports = new List<string>();
+            if (OperatingSystem.IsWindows())
+            {
+                // Where SerialPort.GetPortNames looks too
+                using (RegistryKey map = Registry.LocalMachine.OpenSubKey(@"HARDWARE\DEVICEMAP\SERIALCOMM"))
+                {
+                    if (map != null)
+                        foreach (string name in map.GetValueNames())
+                            if (map.GetValue(name) is string port) ports.Add(port);
+                }
+            }
+            else
+            {
+                foreach (string pattern in PosixPatterns)
+                    ports.AddRange(Directory.GetFiles("/dev", pattern));
+            }
+            ports.Sort(StringComparer.Ordinal);
+            return ports.ToArray();
+        }
+
+        // ------------------ Linux / macOS ------------------
+        private const int TCSANOW = 0;
+        private const int O_RDWR = 0x2;
+
+        private static Stream OpenPosix(string path)
+        {
+            // O_NOCTTY: a daemon with no terminal must not adopt the port as
+            // one, or unplugging it would send us SIGHUP
+            bool linux = RuntimeInformation.IsOSPlatform(OSPlatform.Linux);
+            int flags = O_RDWR | (linux ? 0x100 | 0x80000 : 0x20000 | 0x1000000);   // O_NOCTTY | O_CLOEXEC
+            int fd = open(path, flags);
+            if (fd < 0) throw Error("open " + path);
+            var handle = new SafeFileHandle((IntPtr)fd, true);
+            try
+            {
+                // termios is handled as an opaque buffer so its layout does not matter
+                var tio = new byte[256];
+                if (tcgetattr(fd, tio) == 0)   // not a tty (a file or FIFO under test): nothing to set
+                {
+                    cfmakeraw(tio);
+                    // speed_t is the B9600 code on Linux and the rate itself on the BSDs
+                    cfsetspeed(tio, linux ? (IntPtr)13 : (IntPtr)Baud);
+                    if (tcsetattr(fd, TCSANOW, tio) != 0) throw Error("tcsetattr " + path);
+                }
+                return new SerialStream(handle);
+            }
+            catch
+            {
+                handle.Dispose();
+                throw;
+            }
+        }
+
+        [DllImport("libc", SetLastError = true)] private static extern int open([MarshalAs(UnmanagedType.LPStr)] string path, int flags);
+        [DllImport("libc", SetLastError = true)] private static extern int tcgetattr(int fd, byte[] termios);
+        [DllImport("libc", SetLastError = true)] private static extern int tcsetattr(int fd, int action, byte[] termios);
+        [DllImport("libc")] private static extern void cfmakeraw(byte[] termios);
+        [DllImport("libc", SetLastError = true)] private static extern int cfsetspeed(byte[] termios, IntPtr speed);
+
+        // ------------------ Windows ------------------
+        private const uint MAXDWORD = 0xFFFFFFFF;
+
+        [StructLayout(LayoutKind.Sequential)]
+        private struct CommTimeouts
+        {
+            public uint ReadIntervalTimeout;
+            public uint ReadTotalTimeoutMultiplier;
+            public uint ReadTotalTimeoutConstant;
+            public uint WriteTotalTimeoutMultiplier;
+            public uint WriteTotalTimeoutConstant;
+        }
+
+        private static Stream OpenWindows(string port)
+        {
+            string path = port.StartsWith(@"\\.\") ? port : @"\\.\" + port;   // COM10 and up need the prefix
+            SafeFileHandle handle = File.OpenHandle(path, FileMode.Open, FileAccess.ReadWrite, FileShare.None);
+            try
+            {
+                // DCB is 28 bytes; BuildCommDCB fills it from a mode string
+                var dcb = new byte[28];
+                dcb[0] = 28;
+                if (!GetCommState(handle, dcb)) throw Error("GetCommState " + port);
+                if (!BuildCommDCB("baud=" + Baud + " parity=N data=8 stop=1 dtr=on rts=on", dcb)) throw Error("BuildCommDCB");
+                if (!SetCommState(handle, dcb)) throw Error("SetCommState " + port);
+
+                // Return as soon as any byte is in, or with none after one slice
+                var timeouts = new CommTimeouts
+                {
+                    ReadIntervalTimeout = MAXDWORD,
+                    ReadTotalTimeoutMultiplier = MAXDWORD,
+                    ReadTotalTimeoutConstant = SerialStream.SliceMs
+                };
+                if (!SetCommTimeouts(handle, ref timeouts)) throw Error("SetCommTimeouts " + port);
+                return new SerialStream(handle);
+            }
+            catch
+            {
+                handle.Dispose();
+                throw;
+            }
+        }
+
+        [DllImport("kernel32", SetLastError = true)] private static extern bool GetCommState(SafeFileHandle file, byte[] dcb);
+        [DllImport("kernel32", SetLastError = true)] private static extern bool SetCommState(SafeFileHandle file, byte[] dcb);
+        [DllImport("kernel32", SetLastError = true, CharSet = CharSet.Unicode, EntryPoint = "BuildCommDCBW")] private static extern bool BuildCommDCB(string def, byte[] dcb);
+        [DllImport("kernel32", SetLastError = true)] private static extern bool SetCommTimeouts(SafeFileHandle file, ref CommTimeouts timeouts);
+
+        private static Exception Error(string what)
+        {
+            return new Win32Exception(Marshal.GetLastWin32Error(), what + " failed");
+        }
+    }
+}
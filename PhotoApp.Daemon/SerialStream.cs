@@ -0,0 +1,164 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+using System;
+using System.ComponentModel;
+using System.IO;
+using System.Runtime.InteropServices;
+using Microsoft.Win32.SafeHandles;
+
+namespace PhotoApp.Daemon
+{
+    /// <summary>
+    /// A configured serial port handle as a Stream. Reads wait for data in
+    /// slices of <see cref="SliceMs"/> (poll on POSIX, comm timeouts on
+    /// Windows) and return as soon as any byte is in, so latency is not
+    /// affected; between slices they check for <see cref="Stream.Dispose()"/>.
+    /// A FileStream would not do: closing a tty does not wake a read that
+    /// is already blocked on it, and a probe of a silent port could then
+    /// never give the port back. Read returns 0 only once the port is
+    /// closed or hung up (unplugged), which is what DeviceSession takes as
+    /// the end of the device.
+    /// </summary>
+    internal sealed class SerialStream : Stream
+    {
+        public const int SliceMs = 100;
+
+        private const int Quiet = -1;
+        private readonly SafeFileHandle _handle;
+        private readonly bool _windows;
+        private volatile bool _closed;
+
+        public SerialStream(SafeFileHandle handle)
+        {
+            _handle = handle;
+            _windows = OperatingSystem.IsWindows();
+        }
+
+        public override bool CanRead { get { return !_closed; } }
+        public override bool CanWrite { get { return !_closed; } }
+        public override bool CanSeek { get { return false; } }
+        public override long Length { get { throw new NotSupportedException(); } }
+        public override long Position { get { throw new NotSupportedException(); } set { throw new NotSupportedException(); } }
+
+        public override int Read(byte[] buffer, int offset, int count)
+        {
+            if (count == 0) return 0;
+            while (!_closed)
+            {
+                int n;
+                try
+                {
+                    n = _windows ? ReadWindows(buffer, offset, count) : ReadPosix(buffer, offset, count);
+                }
+                catch (ObjectDisposedException)
+                {
+                    return 0;   // closed between the check and the call
+                }
+                if (n != Quiet) return n;
+            }
+            return 0;
+        }
+
+        public override void Write(byte[] buffer, int offset, int count)
+        {
+            if (_closed) throw new ObjectDisposedException(nameof(SerialStream));
+            while (count > 0)
+            {
+                int n = _windows ? WriteWindows(buffer, offset, count) : WritePosix(buffer, offset, count);
+                offset += n;
+                count -= n;
+            }
+        }
+
+        public override void Flush() { }
+        public override long Seek(long offset, SeekOrigin origin) { throw new NotSupportedException(); }
+        public override void SetLength(long value) { throw new NotSupportedException(); }
+
+        protected override void Dispose(bool disposing)
+        {
+            _closed = true;
+            _handle.Dispose();   // the descriptor closes once a read in progress lets go of it
+            base.Dispose(disposing);
+        }
+
+        // ------------------ POSIX ------------------
+        private const short POLLIN = 0x1;
+        private const short POLLERR = 0x8;
+        private const short POLLHUP = 0x10;
+        private const short POLLNVAL = 0x20;
+        private const int EINTR = 4;
+        private const int EAGAIN = 11;
+        private const int EIO = 5;
+
+        [StructLayout(LayoutKind.Sequential)]
+        private struct PollFd
+        {
+            public int Fd;
+            public short Events;
+            public short Revents;
+        }
+
+        private int ReadPosix(byte[] buffer, int offset, int count)
+        {
+            bool added = false;
+            try
+            {
+                _handle.DangerousAddRef(ref added);   // keeps the number from being closed and reused under us
+                var p = new PollFd { Fd = (int)_handle.DangerousGetHandle(), Events = POLLIN };
+                int ready = poll(ref p, 1, SliceMs);
+                if (ready < 0) return Marshal.GetLastWin32Error() == EINTR ? Quiet : 0;
+                if (ready == 0) return Quiet;
+                if ((p.Revents & POLLIN) == 0) return 0;   // hung up, error or closed
+
+                long n = (long)read(p.Fd, ref buffer[offset], (IntPtr)count);
+                if (n >= 0) return (int)n;
+                int err = Marshal.GetLastWin32Error();
+                if (err == EINTR || err == EAGAIN) return Quiet;
+                if (err == EIO) return 0;   // unplugged
+                throw new IOException("serial read failed", new Win32Exception(err));
+            }
+            finally
+            {
+                if (added) _handle.DangerousRelease();
+            }
+        }
+
+        private int WritePosix(byte[] buffer, int offset, int count)
+        {
+            while (true)
+            {
+                long n = (long)write(_handle, ref buffer[offset], (IntPtr)count);
+                if (n >= 0) return (int)n;
+                int err = Marshal.GetLastWin32Error();
+                if (err != EINTR) throw new IOException("serial write failed", new Win32Exception(err));
+            }
+        }
+
+        [DllImport("libc", SetLastError = true)] private static extern int poll(ref PollFd fds, uint nfds, int timeout);
+        [DllImport("libc", SetLastError = true)] private static extern IntPtr read(int fd, ref byte buf, IntPtr count);
+        [DllImport("libc", SetLastError = true)] private static extern IntPtr write(SafeFileHandle fd, ref byte buf, IntPtr count);
+
+        // ------------------ Windows ------------------
+        // SerialDevice sets the read timeouts to return on the first byte or after SliceMs
+        private int ReadWindows(byte[] buffer, int offset, int count)
+        {
+            int n;
+            if (!ReadFile(_handle, ref buffer[offset], count, out n, IntPtr.Zero))
+                throw new IOException("serial read failed", new Win32Exception(Marshal.GetLastWin32Error()));
+            return n == 0 ? Quiet : n;
+        }
+
+        private int WriteWindows(byte[] buffer, int offset, int count)
+        {
+            int n;
+            if (!WriteFile(_handle, ref buffer[offset], count, out n, IntPtr.Zero))
+                throw new IOException("serial write failed", new Win32Exception(Marshal.GetLastWin32Error()));
+            return n;
+        }
+
+        [DllImport("kernel32", SetLastError = true)] private static extern bool ReadFile(SafeFileHandle file, ref byte buffer, int count, out int read, IntPtr overlapped);
+        [DllImport("kernel32", SetLastError = true)] private static extern bool WriteFile(SafeFileHandle file, ref byte buffer, int count, out int written, IntPtr overlapped);
+    }
+}
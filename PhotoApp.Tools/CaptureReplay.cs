@@ -0,0 +1,247 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Globalization;
+using System.IO;
+using PhotoApp.Core;
+
+namespace PhotoApp.Tools
+{
+    /// <summary>
+    /// Runs a saved serial capture through the same framer, parser and
+    /// <see cref="PresenceDetector"/> as PhotoApp, as fast as possible, and
+    /// prints every arrival/departure with its time. Threshold changes can
+    /// be checked against real sessions without a device or Windows.
+    ///
+    /// Sample time comes from, in order: the firmware's "t=" stamp, a
+    /// "[seconds]" prefix (echome-replay -t output), or the line count times
+    /// --interval-ms.
+    /// </summary>
+    internal static class CaptureReplay
+    {
+        private struct Decision
+        {
+            public long TimeMs;
+            public PresenceChange Change;
+            public double SmoothedCm;
+            public long Line;
+        }
+
+        private sealed class Options
+        {
+            public string Path;
+            public double StartCm = PresenceDetector.DefaultStartCm;
+            public double StopCm = PresenceDetector.DefaultStopCm;
+            public long StartDebounceMs = PresenceDetector.DefaultStartDebounceMs;
+            public long StopDebounceMs = PresenceDetector.DefaultStopDebounceMs;
+            public int Smooth = PresenceDetector.DefaultSmoothCount;
+            public long HorizonMs = PresenceDetector.DefaultApproachHorizonMs;
+            public double ApproachCmPerS = PresenceDetector.DefaultApproachCmPerS;
+            public long IntervalMs = 2000;   // firmware's default print interval
+            public int Repeat = 5;
+            public bool Quiet;
+        }
+
+        // State for one pass; static so the line handler is a cached delegate
+        private static PresenceDetector _detector;
+        private static DeviceClock _clock;
+        private static readonly List<Decision> _decisions = new List<Decision>(1024);
+        private static long _lines, _samples, _stamped;
+        private static long _intervalMs;
+
+        public static int Run(string[] args)
+        {
+            Options o = Parse(args);
+            if (o == null)
+            {
+                Console.Error.WriteLine("usage: photoapp-tools replay [--start cm] [--stop cm] [--start-debounce ms] [--stop-debounce ms]");
+                Console.Error.WriteLine("                             [--smooth n] [--horizon ms] [--approach-speed cm/s]");
+                Console.Error.WriteLine("                             [--interval-ms ms] [--repeat n] [-q] <capture|->");
+                return 2;
+            }
+
+            byte[] data;
+            if (o.Path == "-")
+            {
+                using (var ms = new MemoryStream())
+                {
+                    Console.OpenStandardInput().CopyTo(ms);
+                    data = ms.ToArray();
+                }
+            }
+            else
+            {
+                data = File.ReadAllBytes(o.Path);
+            }
+
+            _intervalMs = o.IntervalMs;
+            Pass(data, o);   // warm up JIT and size the decision list
+
+            GC.Collect();
+            GC.WaitForPendingFinalizers();
+            int gen0 = GC.CollectionCount(0);
+            long alloc = GC.GetAllocatedBytesForCurrentThread();
+            var sw = Stopwatch.StartNew();
+            for (int i = 0; i < o.Repeat; i++) Pass(data, o);
+            sw.Stop();
+            alloc = GC.GetAllocatedBytesForCurrentThread() - alloc;
+            gen0 = GC.CollectionCount(0) - gen0;
+
+            if (!o.Quiet)
+            {
+                foreach (Decision d in _decisions)
+                {
+                    Console.WriteLine("{0,12:F3} s  line {1,-8} {2,-11} B~{3:F2} cm",
+                        d.TimeMs / 1000.0, d.Line, d.Change.ToString().ToUpperInvariant(), d.SmoothedCm);
+                }
+                Console.WriteLine();
+            }
+
+            long totalLines = _lines * o.Repeat;
+            double secs = sw.Elapsed.TotalSeconds;
+            Console.WriteLine("{0} bytes, {1} lines, {2} samples ({3} device-stamped)", data.Length, _lines, _samples, _stamped);
+            Console.WriteLine("thresholds on<{0} off>{1} cm, debounce {2}/{3} ms, smoothing {4}",
+                o.StartCm.ToString(CultureInfo.InvariantCulture), o.StopCm.ToString(CultureInfo.InvariantCulture),
+                o.StartDebounceMs, o.StopDebounceMs, o.Smooth);
+            Console.WriteLine("{0} decisions ({1} arrivals)", _decisions.Count,
+                _decisions.FindAll(d => d.Change == PresenceChange.Arrived).Count);
+            PrintApproaches(o);
+            Console.WriteLine("{0:F0} lines/s, {1:F1} ns/line, {2:F2} bytes allocated/line, {3} gen0 ({4} passes)",
+                totalLines / secs, secs * 1e9 / totalLines, (double)alloc / totalLines, gen0, o.Repeat);
+            return 0;
+        }
+
+        // How much warning the approach trend gave, and how often it was wrong
+        private static void PrintApproaches(Options o)
+        {
+            if (o.HorizonMs <= 0) return;
+            var leads = new List<long>();
+            int approaches = 0, receded = 0, arrivals = 0;
+            long approachMs = -1;
+            foreach (Decision d in _decisions)
+            {
+                switch (d.Change)
+                {
+                    case PresenceChange.Approaching: approaches++; approachMs = d.TimeMs; break;
+                    case PresenceChange.Receded: receded++; approachMs = -1; break;
+                    case PresenceChange.Arrived:
+                        arrivals++;
+                        if (approachMs >= 0) leads.Add(d.TimeMs - approachMs);
+                        approachMs = -1;
+                        break;
+                }
+            }
+            leads.Sort();
+            Console.WriteLine("approach horizon {0} ms at {1} cm/s: {2} approaches, {3} receded, {4}/{5} arrivals warned{6}",
+                o.HorizonMs, o.ApproachCmPerS.ToString(CultureInfo.InvariantCulture), approaches, receded, leads.Count, arrivals,
+                leads.Count == 0 ? "" : string.Format(CultureInfo.InvariantCulture, ", lead p50 {0} ms, min {1} ms", leads[(leads.Count - 1) / 2], leads[0]));
+        }
+
+        private static readonly LineHandler OnLine = HandleLine;
+
+        private static void Pass(byte[] data, Options o)
+        {
+            _detector = new PresenceDetector(o.StartCm, o.StopCm, o.StartDebounceMs, o.StopDebounceMs, o.Smooth)
+            {
+                ApproachHorizonMs = o.HorizonMs,
+                ApproachCmPerS = o.ApproachCmPerS
+            };
+            _clock = new DeviceClock();
+            _decisions.Clear();
+            _lines = _samples = _stamped = 0;
+
+            var framer = new LineFramer(1024);
+            const int Chunk = 4096;   // like a large serial read
+            for (int pos = 0; pos < data.Length; pos += Chunk)
+                framer.Feed(data, pos, Math.Min(Chunk, data.Length - pos), OnLine);
+        }
+
+        private static void HandleLine(byte[] buf, int off, int count)
+        {
+            _lines++;
+            if (TelemetryParser.StartsWith(buf, off, count, "READY"))
+            {
+                _clock.Restart();
+                return;
+            }
+
+            double cm;
+            if (!TelemetryParser.TryParseDistanceB(buf, off, count, out cm)) return;
+            _samples++;
+
+            long ms;
+            uint micros;
+            if (TelemetryParser.TryParseDeviceTime(buf, off, count, out micros))
+            {
+                _stamped++;
+                ms = _clock.Extend(micros) / 1000;
+            }
+            else if (!TryParsePrefixSeconds(buf, off, count, out ms))
+            {
+                ms = _samples * _intervalMs;
+            }
+
+            PresenceChange change = _detector.Update(cm, ms);
+            if (change != PresenceChange.None)
+            {
+                _decisions.Add(new Decision
+                {
+                    TimeMs = ms,
+                    Change = change,
+                    SmoothedCm = _detector.SmoothedCm,
+                    Line = _lines
+                });
+            }
+        }
+
+        // "[    12.345] ..." as written by echome-replay -t
+        private static bool TryParsePrefixSeconds(byte[] buf, int off, int count, out long ms)
+        {
+            ms = 0;
+            if (count < 3 || buf[off] != (byte)'[') return false;
+            int p = off + 1, end = off + count;
+            while (p < end && buf[p] == (byte)' ') p++;
+            double s;
+            if (!TelemetryParser.TryParseNumber(buf, p, end, out s)) return false;
+            ms = (long)(s * 1000);
+            return true;
+        }
+
+        private static Options Parse(string[] args)
+        {
+            var o = new Options();
+            for (int i = 0; i < args.Length; i++)
+            {
+                string a = args[i];
+                string v = i + 1 < args.Length ? args[i + 1] : null;
+                switch (a)
+                {
+                    case "--start": if (!TryDouble(v, out o.StartCm)) return null; i++; break;
+                    case "--stop": if (!TryDouble(v, out o.StopCm)) return null; i++; break;
+                    case "--start-debounce": if (!long.TryParse(v, out o.StartDebounceMs)) return null; i++; break;
+                    case "--stop-debounce": if (!long.TryParse(v, out o.StopDebounceMs)) return null; i++; break;
+                    case "--smooth": if (!int.TryParse(v, out o.Smooth)) return null; i++; break;
+                    case "--horizon": if (!long.TryParse(v, out o.HorizonMs)) return null; i++; break;
+                    case "--approach-speed": if (!TryDouble(v, out o.ApproachCmPerS)) return null; i++; break;
+                    case "--interval-ms": if (!long.TryParse(v, out o.IntervalMs)) return null; i++; break;
+                    case "--repeat": if (!int.TryParse(v, out o.Repeat) || o.Repeat < 1) return null; i++; break;
+                    case "-q": o.Quiet = true; break;
+                    default:
+                        if (o.Path != null || (a.StartsWith("-") && a != "-")) return null;
+                        o.Path = a;
+                        break;
+                }
+            }
+            return o.Path == null ? null : o;
+        }
+
+        private static bool TryDouble(string s, out double v)
+        {
+            return double.TryParse(s, NumberStyles.Float, CultureInfo.InvariantCulture, out v);
+        }
+    }
+}
@@ -0,0 +1,232 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+using System;
+using System.Collections.Generic;
+using System.Globalization;
+using System.Text;
+using System.Threading;
+using PhotoApp.Core;
+
+namespace PhotoApp.Tools
+{
+    internal sealed class EmulatorOptions
+    {
+        public double Rate = 20;           // samples per second
+        public double JitterMs = 0;        // +- on each sample interval
+        public int FragmentBytes = 0;      // > 0: write lines in random 1..n byte pieces
+        public double CorruptPct = 0;      // % of lines damaged
+        public bool Legacy = false;        // no "t=" stamps (firmware before 1.2.0)
+        public double OnSeconds = 5;       // cube placed...
+        public double OffSeconds = 5;      // ...and removed, repeatedly
+        public int Seed = 439;
+    }
+
+    /// <summary>
+    /// Stand-in for an EchoMe board on the master end of a pseudo-terminal.
+    /// Streams distance lines in firmware format while a scripted cube is
+    /// placed and removed. Answers SYNC/STREAM commands like the firmware.
+    /// Its "device" clock is the host Stopwatch, so stamps can be checked
+    /// against the host's own reading times.
+    /// </summary>
+    internal sealed class DeviceEmulator : IDisposable
+    {
+        private const int CommandSliceMs = 100;   // how often the command reader checks for Stop
+
+        private readonly PseudoTerminal _pty;
+        private readonly EmulatorOptions _o;
+        private readonly object _writeLock = new object();
+        private readonly long _bootUs = ClockSync.HostMicrosNow();
+        private readonly List<long> _placements = new List<long>();
+        private readonly Thread _writer;
+        private readonly Thread _commands;
+        private volatile bool _stopping;
+
+        private long _samples, _bytes, _corrupted;
+
+        public DeviceEmulator(PseudoTerminal pty, EmulatorOptions options)
+        {
+            _pty = pty;
+            _o = options;
+            _writer = new Thread(WriteLoop) { IsBackground = true, Name = "Emulator output" };
+            _commands = new Thread(CommandLoop) { IsBackground = true, Name = "Emulator commands" };
+        }
+
+        public long SamplesSent { get { return Interlocked.Read(ref _samples); } }
+        public long BytesSent { get { return Interlocked.Read(ref _bytes); } }
+        public long LinesCorrupted { get { return Interlocked.Read(ref _corrupted); } }
+
+        /// <summary>Host µs at which each placement's first "cube present" sample was written.</summary>
+        public long[] Placements()
+        {
+            lock (_placements) return _placements.ToArray();
+        }
+
+        public void Start()
+        {
+            Send("READY EchoMe fw=emulator");
+            _commands.Start();
+            _writer.Start();
+        }
+
+        public void Stop()
+        {
+            _stopping = true;
+            if (_writer.IsAlive) _writer.Join();
+            if (_commands.IsAlive) _commands.Join();   // within one CommandSliceMs
+        }
+
+        public void Dispose()
+        {
+            Stop();
+        }
+
+        private uint DeviceMicros()
+        {
+            return unchecked((uint)(ClockSync.HostMicrosNow() - _bootUs));
+        }
+
+        private void Send(string line)
+        {
+            byte[] bytes = Encoding.ASCII.GetBytes(line + "\r\n");
+            lock (_writeLock) _pty.Write(bytes, 0, bytes.Length);
+        }
+
+        // ------------------ Telemetry ------------------
+        private void WriteLoop()
+        {
+            var rng = new Random(_o.Seed);
+            var sb = new StringBuilder(256);
+            double intervalUs = 1e6 / _o.Rate;
+            double cycleUs = (_o.OnSeconds + _o.OffSeconds) * 1e6;
+            long startUs = ClockSync.HostMicrosNow();
+            double nextUs = startUs;
+            bool wasOn = false;
+
+            try
+            {
+                while (!_stopping)
+                {
+                    long now = ClockSync.HostMicrosNow();
+                    if (now < nextUs)
+                    {
+                        Thread.Sleep(nextUs - now > 2000 ? 1 : 0);
+                        continue;
+                    }
+
+                    // Everything due since the last pass goes out in one write,
+                    // like a burst from the device's TX buffer
+                    sb.Clear();
+                    while (nextUs <= now)
+                    {
+                        double phase = cycleUs > 0 ? (nextUs - startUs) % cycleUs : 0;
+                        bool on = phase >= _o.OffSeconds * 1e6;   // each cycle starts empty
+                        if (on && !wasOn)
+                            lock (_placements) _placements.Add(now);
+                        wasOn = on;
+
+                        AppendSample(sb, rng, on);
+                        Interlocked.Increment(ref _samples);
+
+                        double jitter = _o.JitterMs > 0 ? (rng.NextDouble() * 2 - 1) * _o.JitterMs * 1000 : 0;
+                        nextUs += Math.Max(1, intervalUs + jitter);
+                    }
+                    Write(Encoding.ASCII.GetBytes(sb.ToString()), rng);
+                }
+            }
+            catch (Exception)
+            {
+                // pty closed
+            }
+        }
+
+        private void AppendSample(StringBuilder sb, Random rng, bool on)
+        {
+            double a = 10 + rng.NextDouble() * 30;
+            double b = on ? 2.0 + rng.NextDouble() * 0.6 : 8 + rng.NextDouble() * 25;
+            int start = sb.Length;
+            sb.Append("A: ").Append(a.ToString("F2", CultureInfo.InvariantCulture))
+              .Append(" cm | B: ").Append(b.ToString("F2", CultureInfo.InvariantCulture)).Append(" cm");
+            if (!_o.Legacy) sb.Append(" | t=").Append(DeviceMicros());
+
+            if (_o.CorruptPct > 0 && rng.NextDouble() * 100 < _o.CorruptPct)
+            {
+                Interlocked.Increment(ref _corrupted);
+                int len = sb.Length - start;
+                switch (rng.Next(4))
+                {
+                    case 0:   // bit error
+                        int i = start + rng.Next(len);
+                        sb[i] = (char)(sb[i] ^ (1 << rng.Next(7)));
+                        break;
+                    case 1:   // tail lost
+                        sb.Length = start + rng.Next(len);
+                        break;
+                    case 2:   // line noise
+                        sb.Insert(start + rng.Next(len), "\u007f#@~");
+                        break;
+                    default:  // terminator lost: runs into the next line
+                        return;
+                }
+            }
+            sb.Append("\r\n");
+        }
+
+        private void Write(byte[] bytes, Random rng)
+        {
+            Interlocked.Add(ref _bytes, bytes.Length);
+            if (_o.FragmentBytes <= 0)
+            {
+                lock (_writeLock) _pty.Write(bytes, 0, bytes.Length);
+                return;
+            }
+
+            // Separate writes so the reader sees lines split across reads
+            for (int pos = 0; pos < bytes.Length;)
+            {
+                int n = Math.Min(bytes.Length - pos, rng.Next(1, _o.FragmentBytes + 1));
+                lock (_writeLock) _pty.Write(bytes, pos, n);
+                pos += n;
+            }
+        }
+
+        // ------------------ Commands ------------------
+        private void CommandLoop()
+        {
+            var framer = new LineFramer(64);
+            var buf = new byte[256];
+            LineHandler onLine = (b, off, count) =>
+            {
+                Protocol.Command cmd;
+                if (!Protocol.TryDecodeCommand(b, off, count, out cmd)) Send("ERR " + Encoding.ASCII.GetString(b, off, count).Trim());
+                else if (cmd == Protocol.Command.Sync) Send("SYNC t=" + DeviceMicros().ToString(CultureInfo.InvariantCulture));
+                else if (cmd == Protocol.Command.StreamOn || cmd == Protocol.Command.StreamOff) Send("OK");
+                else if (cmd == Protocol.Command.Identify) Send("READY EchoMe fw=emulator");
+                else if (cmd == Protocol.Command.Calibrate || cmd == Protocol.Command.CalDump)
+                {
+                    // Nothing to measure: report the firmware's defaults
+                    if (cmd == Protocol.Command.Calibrate) Send("OK");
+                    Send("CAL A base=0mm noise=0mm on=30mm off=35mm src=default");
+                    Send("CAL B base=0mm noise=0mm on=30mm off=35mm src=default");
+                }
+                else Send("ERR " + Encoding.ASCII.GetString(Protocol.CommandLine(cmd)).Trim());
+            };
+
+            try
+            {
+                while (!_stopping)
+                {
+                    int n = _pty.Read(buf, 0, buf.Length, CommandSliceMs);
+                    if (n == PseudoTerminal.Quiet) continue;
+                    if (n == 0) break;
+                    framer.Feed(buf, 0, n, onLine);
+                }
+            }
+            catch (Exception)
+            {
+                // pty closed
+            }
+        }
+    }
+}
@@ -0,0 +1,242 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+using System;
+using System.Collections.Generic;
+using System.Globalization;
+using System.IO;
+using System.Threading;
+using PhotoApp.Core;
+
+namespace PhotoApp.Tools
+{
+    /// <summary>
+    /// "emulate": runs a <see cref="DeviceEmulator"/> on a pseudo-terminal.
+    /// Without --measure it just serves the pty for PhotoApp or a terminal.
+    /// With --measure the host's own <see cref="SerialPipeline"/> reads it,
+    /// and --sweep doubles the rate until the host starts losing data or
+    /// missing the cube.
+    /// </summary>
+    internal static class EmulateCommand
+    {
+        private sealed class RunResult
+        {
+            public double Rate;
+            public long Sent, Parsed, Corrupted, BytesDropped, Overflowed;
+            public int Placements, Arrivals, Missed, Spurious;
+            public long[] ArrivalUs = new long[0];    // placement -> UI notification
+            public long[] HostPathUs = new long[0];   // deciding sample written -> UI notification
+
+            public bool Healthy
+            {
+                get
+                {
+                    long lost = Sent - Corrupted - Parsed;
+                    return BytesDropped == 0 && Missed == 0 && lost <= Sent / 1000;
+                }
+            }
+        }
+
+        public static int Run(string[] args)
+        {
+            var o = new EmulatorOptions();
+            double seconds = 0;
+            bool measure = false, sweep = false;
+            for (int i = 0; i < args.Length; i++)
+            {
+                string a = args[i];
+                string v = i + 1 < args.Length ? args[i + 1] : null;
+                bool ok = true;
+                switch (a)
+                {
+                    case "--rate": ok = TryDouble(v, out o.Rate) && o.Rate > 0; i++; break;
+                    case "--jitter-ms": ok = TryDouble(v, out o.JitterMs); i++; break;
+                    case "--fragment": ok = int.TryParse(v, out o.FragmentBytes); i++; break;
+                    case "--corrupt-pct": ok = TryDouble(v, out o.CorruptPct); i++; break;
+                    case "--on": ok = TryDouble(v, out o.OnSeconds); i++; break;
+                    case "--off": ok = TryDouble(v, out o.OffSeconds); i++; break;
+                    case "--seconds": ok = TryDouble(v, out seconds); i++; break;
+                    case "--seed": ok = int.TryParse(v, out o.Seed); i++; break;
+                    case "--legacy": o.Legacy = true; break;
+                    case "--measure": measure = true; break;
+                    case "--sweep": measure = sweep = true; break;
+                    default: ok = false; break;
+                }
+                if (!ok) return Usage();
+            }
+
+            try
+            {
+                if (!measure) return Serve(o, seconds);
+
+                if (seconds <= 0) seconds = 10;
+                if (!sweep)
+                {
+                    PrintHeader();
+                    Print(Measure(o, seconds));
+                    return 0;
+                }
+
+                // Double the rate until the host falls over (or 2^10 x the start)
+                PrintHeader();
+                for (int step = 0; step <= 10; step++)
+                {
+                    RunResult r = Measure(o, seconds);
+                    Print(r);
+                    if (!r.Healthy)
+                    {
+                        Console.WriteLine();
+                        Console.WriteLine("host falls over at about {0} samples/s", r.Rate.ToString("F0", CultureInfo.InvariantCulture));
+                        return 0;
+                    }
+                    o.Rate *= 2;
+                }
+                Console.WriteLine();
+                Console.WriteLine("no failure up to {0} samples/s", (o.Rate / 2).ToString("F0", CultureInfo.InvariantCulture));
+                return 0;
+            }
+            catch (PlatformNotSupportedException ex)
+            {
+                Console.Error.WriteLine("emulate: " + ex.Message);
+                return 1;
+            }
+        }
+
+        private static int Usage()
+        {
+            Console.Error.WriteLine("usage: photoapp-tools emulate [--rate n] [--jitter-ms ms] [--fragment bytes] [--corrupt-pct p]");
+            Console.Error.WriteLine("                              [--on s] [--off s] [--legacy] [--seed n] [--seconds s]");
+            Console.Error.WriteLine("                              [--measure | --sweep]");
+            return 2;
+        }
+
+        // Serve the pty until --seconds or Ctrl+C
+        private static int Serve(EmulatorOptions o, double seconds)
+        {
+            using (var pty = new PseudoTerminal())
+            using (var emu = new DeviceEmulator(pty, o))
+            {
+                var done = new ManualResetEventSlim(false);
+                Console.CancelKeyPress += (s, e) => { e.Cancel = true; done.Set(); };
+                emu.Start();
+                Console.WriteLine("EchoMe emulator on {0} ({1} samples/s); Ctrl+C to stop", pty.SlavePath, o.Rate);
+                done.Wait(seconds > 0 ? TimeSpan.FromSeconds(seconds) : Timeout.InfiniteTimeSpan);
+                emu.Stop();
+                Console.WriteLine("{0} samples, {1} bytes, {2} corrupted lines", emu.SamplesSent, emu.BytesSent, emu.LinesCorrupted);
+            }
+            return 0;
+        }
+
+        private static RunResult Measure(EmulatorOptions o, double seconds)
+        {
+            var arrivals = new List<long>();
+            var hostPath = new List<long>();
+
+            using (var pty = new PseudoTerminal())
+            using (var emu = new DeviceEmulator(pty, o))
+            using (var port = new FileStream(pty.SlavePath, FileMode.Open, FileAccess.ReadWrite, FileShare.ReadWrite, 0))
+            {
+                var pipeline = new SerialPipeline(port);
+                pipeline.PresenceChanged += () =>
+                {
+                    long now = ClockSync.HostMicrosNow();
+                    if (!pipeline.TakePresence()) return;
+                    LatencyTrace t = pipeline.TakeArrivalTrace();
+                    lock (arrivals)
+                    {
+                        arrivals.Add(now);
+                        if (t != null && t.SampleHostUs >= 0) hostPath.Add(now - t.SampleHostUs);
+                    }
+                };
+
+                pipeline.Start();
+                emu.Start();
+                Thread.Sleep(TimeSpan.FromSeconds(seconds));
+
+                emu.Stop();
+                var r = new RunResult
+                {
+                    Rate = o.Rate,
+                    Sent = emu.SamplesSent,
+                    Corrupted = emu.LinesCorrupted
+                };
+
+                // Let the pipeline drain, then wake its reader so it can exit
+                long parsed;
+                do
+                {
+                    parsed = pipeline.Samples;
+                    Thread.Sleep(100);
+                } while (pipeline.Samples != parsed);
+                pipeline.Stop();
+                pty.Write(new byte[] { (byte)'\n' }, 0, 1);
+                pipeline.Dispose();
+
+                r.Parsed = pipeline.Samples;
+                r.BytesDropped = pipeline.BytesDropped;
+                r.Overflowed = pipeline.LinesOverflowed;
+                lock (arrivals) Match(r, emu.Placements(), arrivals, o);
+                r.HostPathUs = hostPath.ToArray();
+                return r;
+            }
+        }
+
+        // Pairs each placement with the first arrival inside its "on" window
+        private static void Match(RunResult r, long[] placements, List<long> arrivals, EmulatorOptions o)
+        {
+            long windowUs = (long)(o.OnSeconds * 1e6);
+            var latencies = new List<long>();
+            int next = 0, matched = 0;
+            foreach (long p in placements)
+            {
+                while (next < arrivals.Count && arrivals[next] < p) next++;
+                if (next < arrivals.Count && arrivals[next] - p <= windowUs)
+                {
+                    latencies.Add(arrivals[next] - p);
+                    matched++;
+                    next++;
+                }
+                else if (p + windowUs < ClockSync.HostMicrosNow())
+                {
+                    r.Missed++;   // only count placements whose window has closed
+                }
+            }
+            r.Placements = placements.Length;
+            r.Arrivals = arrivals.Count;
+            r.Spurious = arrivals.Count - matched;
+            r.ArrivalUs = latencies.ToArray();
+        }
+
+        private static void PrintHeader()
+        {
+            Console.WriteLine("{0,9} {1,9} {2,9} {3,7} {4,8} {5,6} {6,11} {7,15} {8,15}",
+                "rate/s", "sent", "parsed", "corrupt", "dropB", "ovfl", "arrive/plc", "cube p50/p95", "host p50/p95");
+        }
+
+        private static void Print(RunResult r)
+        {
+            Console.WriteLine("{0,9:F0} {1,9} {2,9} {3,7} {4,8} {5,6} {6,11} {7,15} {8,15}{9}",
+                r.Rate, r.Sent, r.Parsed, r.Corrupted, r.BytesDropped, r.Overflowed,
+                r.Arrivals + "/" + r.Placements, Pair(r.ArrivalUs), Pair(r.HostPathUs),
+                r.Healthy ? "" : "  <-- " + (r.Missed > 0 ? r.Missed + " missed" : "losing data"));
+        }
+
+        private static string Pair(long[] us)
+        {
+            if (us.Length == 0) return "-";
+            Array.Sort(us);
+            return Ms(us[(us.Length - 1) / 2]) + "/" + Ms(us[(int)Math.Ceiling(us.Length * 0.95) - 1]) + " ms";
+        }
+
+        private static string Ms(long us)
+        {
+            return (us / 1000.0).ToString("F1", CultureInfo.InvariantCulture);
+        }
+
+        private static bool TryDouble(string s, out double v)
+        {
+            return double.TryParse(s, NumberStyles.Float, CultureInfo.InvariantCulture, out v);
+        }
+    }
+}
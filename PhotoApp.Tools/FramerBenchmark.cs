@@ -0,0 +1,137 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Globalization;
+using System.Text;
+using System.Text.RegularExpressions;
+using PhotoApp.Core;
+
+namespace PhotoApp.Tools
+{
+    /// <summary>
+    /// Compares the original Form1 receive path (ReadExisting + Split +
+    /// Regex) with LineFramer + TelemetryParser on the same byte stream,
+    /// cut into random 1..64 byte reads like DataReceived delivers them.
+    /// </summary>
+    internal static class FramerBenchmark
+    {
+        // Copy of the regex Form1 used before the framer
+        private static readonly Regex LegacyRegex = new Regex(
+            @"\bB:\s*([-+]?\d+(?:\.\d+)?)\s*(?:cm)?",
+            RegexOptions.IgnoreCase | RegexOptions.Compiled);
+
+        private static int _parsed;
+        private static double _sum;
+
+        public static int Run(string[] args)
+        {
+            int lines = 200000;
+            if (args.Length > 0 && !int.TryParse(args[0], out lines)) return 2;
+
+            List<byte[]> chunks = BuildStream(lines, out int telemetryLines);
+            Console.WriteLine("{0} lines ({1} with B:), {2} reads", lines, telemetryLines, chunks.Count);
+            Console.WriteLine();
+            Console.WriteLine("{0,-8} {1,12} {2,14} {3,8} {4,10}", "path", "ns/line", "bytes/line", "gen0", "B values");
+
+            // Warm both paths (JIT, regex compilation) before measuring
+            Legacy(chunks);
+            Framed(chunks);
+
+            Report("legacy", lines, () => Legacy(chunks));
+            Report("framer", lines, () => Framed(chunks));
+            return 0;
+        }
+
+        private static void Report(string name, int lines, Action run)
+        {
+            GC.Collect();
+            GC.WaitForPendingFinalizers();
+            int gen0 = GC.CollectionCount(0);
+            long alloc = GC.GetAllocatedBytesForCurrentThread();
+            var sw = Stopwatch.StartNew();
+            run();
+            sw.Stop();
+            alloc = GC.GetAllocatedBytesForCurrentThread() - alloc;
+            gen0 = GC.CollectionCount(0) - gen0;
+
+            double ns = sw.Elapsed.TotalMilliseconds * 1e6 / lines;
+            Console.WriteLine("{0,-8} {1,12:F1} {2,14:F1} {3,8} {4,10}",
+                name, ns, (double)alloc / lines, gen0, _parsed);
+        }
+
+        private static void Legacy(List<byte[]> chunks)
+        {
+            _parsed = 0;
+            _sum = 0;
+            var separators = new[] { "\r\n", "\n", "\r" };
+            foreach (byte[] chunk in chunks)
+            {
+                string text = Encoding.ASCII.GetString(chunk);   // ReadExisting()
+                foreach (string line in text.Split(separators, StringSplitOptions.RemoveEmptyEntries))
+                {
+                    Match m = LegacyRegex.Match(line);
+                    if (!m.Success) continue;
+                    if (double.TryParse(m.Groups[1].Value, NumberStyles.Float, CultureInfo.InvariantCulture, out double cm))
+                    {
+                        _parsed++;
+                        _sum += cm;
+                    }
+                }
+            }
+        }
+
+        private static readonly LineHandler OnLine = (buf, off, len) =>
+        {
+            if (TelemetryParser.TryParseDistanceB(buf, off, len, out double cm))
+            {
+                _parsed++;
+                _sum += cm;
+            }
+        };
+
+        private static void Framed(List<byte[]> chunks)
+        {
+            _parsed = 0;
+            _sum = 0;
+            var framer = new LineFramer();
+            foreach (byte[] chunk in chunks)
+                framer.Feed(chunk, 0, chunk.Length, OnLine);
+        }
+
+        private static List<byte[]> BuildStream(int lines, out int telemetryLines)
+        {
+            var rng = new Random(439);
+            var sb = new StringBuilder();
+            telemetryLines = 0;
+            for (int i = 0; i < lines; i++)
+            {
+                if (i % 20 == 19)
+                {
+                    sb.Append("Turn ").Append(i % 15 + 1).Append("\r\n");
+                    continue;
+                }
+                double a = rng.NextDouble() * 40, b = rng.NextDouble() * 8;
+                sb.Append("A: ").Append(a.ToString("F2", CultureInfo.InvariantCulture))
+                  .Append(" cm | B: ").Append(b.ToString("F2", CultureInfo.InvariantCulture))
+                  .Append(" cm\r\n");
+                telemetryLines++;
+            }
+
+            byte[] all = Encoding.ASCII.GetBytes(sb.ToString());
+            var chunks = new List<byte[]>();
+            for (int pos = 0; pos < all.Length;)
+            {
+                int n = Math.Min(rng.Next(1, 65), all.Length - pos);
+                var c = new byte[n];
+                Buffer.BlockCopy(all, pos, c, 0, n);
+                chunks.Add(c);
+                pos += n;
+            }
+            return chunks;
+        }
+    }
+}
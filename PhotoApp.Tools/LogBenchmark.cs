@@ -0,0 +1,131 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+using System;
+using System.Diagnostics;
+using System.IO;
+using PhotoApp.Core;
+
+namespace PhotoApp.Tools
+{
+    /// <summary>
+    /// Writes days of synthetic streaming telemetry through
+    /// <see cref="TelemetryLog"/> into a temporary folder, then times the
+    /// kinds of queries caregivers and engineers run against it. The cube
+    /// is placed every 10 minutes with a game round each time; a day has
+    /// one win.
+    /// </summary>
+    internal static class LogBenchmark
+    {
+        private static long _matched;
+
+        public static int Run(string[] args)
+        {
+            int days = 30;
+            int rate = 20;   // samples/s with STREAM1
+            if (args.Length > 0 && !int.TryParse(args[0], out days)) return 2;
+            if (args.Length > 1 && !int.TryParse(args[1], out rate)) return 2;
+
+            string dir = Path.Combine(Path.GetTempPath(), "photoapp-bench-log-" + Process.GetCurrentProcess().Id);
+            try
+            {
+                long startUs = (new DateTime(2026, 1, 1, 0, 0, 0, DateTimeKind.Utc) - new DateTime(1970, 1, 1, 0, 0, 0, DateTimeKind.Utc)).Ticks / 10;
+                long endUs = startUs + days * 86400L * 1000000;
+                Ingest(dir, startUs, endUs, rate);
+
+                var reader = new TelemetryLogReader(dir);
+                Console.WriteLine();
+                Console.WriteLine("{0,-28} {1,10} {2,10} {3,10} {4,10}", "query", "ms", "matched", "blocks", "skipped");
+                long hourUs = 3600L * 1000000;
+                long lastNoon = endUs - 12 * hourUs;
+                Time(reader, "one hour, everything", lastNoon, lastNoon + hourUs, TelemetryLogReader.AllEvents);
+                Time(reader, "one day, arrivals", lastNoon - 12 * hourUs, lastNoon + 12 * hourUs, TelemetryLogReader.Mask(LogEvent.Arrived));
+                Time(reader, "all days, wins", startUs, endUs, TelemetryLogReader.Mask(LogEvent.Win));
+                Time(reader, "all days, game prompts", startUs, endUs,
+                    TelemetryLogReader.Mask(LogEvent.Turn) | TelemetryLogReader.Mask(LogEvent.Correct) | TelemetryLogReader.Mask(LogEvent.Wrong));
+                Time(reader, "all days, every sample", startUs, endUs, TelemetryLogReader.Mask(LogEvent.Sample));
+                return 0;
+            }
+            finally
+            {
+                if (Directory.Exists(dir)) Directory.Delete(dir, true);
+            }
+        }
+
+        private static void Ingest(string dir, long startUs, long endUs, int rate)
+        {
+            var rng = new Random(439);
+            long intervalUs = 1000000 / rate;
+            long cycleUs = 600L * 1000000;   // a placement every 10 minutes...
+            long presentUs = 120L * 1000000; // ...for 2 minutes
+            long records = 0;
+
+            GC.Collect();
+            int gen0 = GC.CollectionCount(0);
+            long alloc = GC.GetAllocatedBytesForCurrentThread();
+            var sw = Stopwatch.StartNew();
+            using (var log = new TelemetryLog(dir))
+            {
+                var r = new LogRecord();
+                bool wasPresent = false;
+                for (long t = startUs; t < endUs; t += intervalUs)
+                {
+                    long phase = (t - startUs) % cycleUs;
+                    bool present = phase < presentUs;
+                    r.TimeUs = t;
+                    r.Event = LogEvent.Sample;
+                    r.A = (ushort)(1000 + rng.Next(3000));
+                    r.B = (ushort)(present ? 200 + rng.Next(60) : 800 + rng.Next(2500));
+                    r.Arg = 0;
+                    log.Append(in r);
+                    records++;
+
+                    if (present == wasPresent) continue;
+                    wasPresent = present;
+                    records += AppendEvent(log, t, present ? LogEvent.Arrived : LogEvent.Left, 0);
+                    if (!present) continue;
+
+                    // One round of the memory game while the cube is down
+                    int turn = (int)(phase / intervalUs % 6) + 1;
+                    records += AppendEvent(log, t + 1000, LogEvent.Turn, turn);
+                    records += AppendEvent(log, t + 2000, LogEvent.YourTurn, 0);
+                    records += AppendEvent(log, t + 3000, rng.Next(4) == 0 ? LogEvent.Wrong : LogEvent.Correct, 0);
+                    if ((t - startUs) % (86400L * 1000000) < cycleUs)
+                        records += AppendEvent(log, t + 4000, LogEvent.Win, 0);
+                }
+            }
+            sw.Stop();
+            alloc = GC.GetAllocatedBytesForCurrentThread() - alloc;
+            gen0 = GC.CollectionCount(0) - gen0;
+
+            long bytes = 0;
+            foreach (string f in Directory.GetFiles(dir)) bytes += new FileInfo(f).Length;
+            Console.WriteLine("{0} days at {1} samples/s: {2} records, {3:F1} MB on disk",
+                (endUs - startUs) / (86400L * 1000000), rate, records, bytes / 1048576.0);
+            Console.WriteLine("ingest {0:F2} M records/s, {1:F3} bytes allocated/record, {2} gen0",
+                records / sw.Elapsed.TotalSeconds / 1e6, (double)alloc / records, gen0);
+        }
+
+        private static int AppendEvent(TelemetryLog log, long t, LogEvent e, int arg)
+        {
+            var r = new LogRecord { TimeUs = t, Event = e, Arg = (ushort)arg };
+            log.Append(in r);
+            return 1;
+        }
+
+        private static readonly LogRecordHandler Count = (in LogRecord r) => _matched++;
+
+        // Second run reported: the first warms the page cache and the JIT
+        private static void Time(TelemetryLogReader reader, string name, long fromUs, long toUs, uint events)
+        {
+            reader.Query(fromUs, toUs, events, Count);
+            _matched = 0;
+            var sw = Stopwatch.StartNew();
+            LogQueryStats stats = reader.Query(fromUs, toUs, events, Count);
+            sw.Stop();
+            Console.WriteLine("{0,-28} {1,10:F2} {2,10} {3,10} {4,10}",
+                name, sw.Elapsed.TotalMilliseconds, _matched, stats.BlocksRead, stats.BlocksSkipped);
+        }
+    }
+}
@@ -0,0 +1,131 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+using System;
+using System.Diagnostics;
+using System.Globalization;
+using PhotoApp.Core;
+
+namespace PhotoApp.Tools
+{
+    /// <summary>
+    /// Prints or counts the records of a PhotoApp device log
+    /// (<see cref="TelemetryLog"/>, %LOCALAPPDATA%\RemindME\Log\&lt;port&gt;)
+    /// in a time range, optionally only some event types. Times are local
+    /// unless --utc is given.
+    /// </summary>
+    internal static class LogQuery
+    {
+        private sealed class Options
+        {
+            public string Path;
+            public long FromUs = long.MinValue;
+            public long ToUs = long.MaxValue;
+            public uint Events = TelemetryLogReader.AllEvents;
+            public bool Count;
+            public bool Utc;
+        }
+
+        private static bool _utc;
+        private static readonly long[] _counts = new long[32];
+
+        public static int Run(string[] args)
+        {
+            Options o = Parse(args);
+            if (o == null)
+            {
+                Console.Error.WriteLine("usage: photoapp-tools query [--from time] [--to time] [--event name[,name...]] [--count] [--utc] <log folder>");
+                Console.Error.WriteLine("  events: " + string.Join(", ", Enum.GetNames(typeof(LogEvent))).ToLowerInvariant());
+                Console.Error.WriteLine("  times:  yyyy-MM-dd[ HH:mm[:ss]]");
+                return 2;
+            }
+
+            _utc = o.Utc;
+            var reader = new TelemetryLogReader(o.Path);
+            var sw = Stopwatch.StartNew();
+            LogQueryStats stats = reader.Query(o.FromUs, o.ToUs, o.Events, o.Count ? (LogRecordHandler)Tally : Print);
+            sw.Stop();
+
+            if (o.Count)
+            {
+                for (int i = 0; i < _counts.Length; i++)
+                    if (_counts[i] != 0) Console.WriteLine("{0,-10} {1,12}", ((LogEvent)i).ToString().ToLowerInvariant(), _counts[i]);
+            }
+            Console.Error.WriteLine("{0} records from {1} day(s): {2} blocks read, {3} skipped by the index, {4:F1} ms",
+                stats.Matched, stats.Partitions, stats.BlocksRead, stats.BlocksSkipped, sw.Elapsed.TotalMilliseconds);
+            return 0;
+        }
+
+        private static void Tally(in LogRecord r)
+        {
+            _counts[(int)r.Event]++;
+        }
+
+        private static void Print(in LogRecord r)
+        {
+            DateTime t = _utc ? r.TimeUtc : r.TimeUtc.ToLocalTime();
+            string time = t.ToString("yyyy-MM-dd HH:mm:ss.ffffff", CultureInfo.InvariantCulture);
+            string name = r.Event.ToString().ToLowerInvariant();
+            if (r.Event == LogEvent.Sample)
+                Console.WriteLine("{0}  {1,-10} A={2} B={3}", time, name, Cm(r.ACm), Cm(r.BCm));
+            else if (r.Event == LogEvent.Turn || r.Event == LogEvent.Stall || r.Event == LogEvent.Calibrated)
+                Console.WriteLine("{0}  {1,-10} {2}", time, name, r.Arg);
+            else
+                Console.WriteLine("{0}  {1}", time, name);
+        }
+
+        private static string Cm(double cm)
+        {
+            return double.IsNaN(cm) ? "-" : cm.ToString("F2", CultureInfo.InvariantCulture);
+        }
+
+        private static Options Parse(string[] args)
+        {
+            var o = new Options();
+            for (int i = 0; i < args.Length; i++)
+            {
+                string a = args[i];
+                string v = i + 1 < args.Length ? args[i + 1] : null;
+                switch (a)
+                {
+                    case "--from": if (!TryTime(v, args, out o.FromUs)) return null; i++; break;
+                    case "--to": if (!TryTime(v, args, out o.ToUs)) return null; i++; break;
+                    case "--event": if (!TryEvents(v, out o.Events)) return null; i++; break;
+                    case "--count": o.Count = true; break;
+                    case "--utc": o.Utc = true; break;
+                    default:
+                        if (o.Path != null || a.StartsWith("-")) return null;
+                        o.Path = a;
+                        break;
+                }
+            }
+            return o.Path == null ? null : o;
+        }
+
+        // --utc anywhere on the line applies to --from/--to as well
+        private static bool TryTime(string s, string[] args, out long us)
+        {
+            us = 0;
+            DateTime t;
+            DateTimeStyles style = Array.IndexOf(args, "--utc") >= 0 ? DateTimeStyles.AssumeUniversal : DateTimeStyles.AssumeLocal;
+            if (s == null || !DateTime.TryParse(s, CultureInfo.InvariantCulture, style | DateTimeStyles.AdjustToUniversal, out t))
+                return false;
+            us = (t - new DateTime(1970, 1, 1, 0, 0, 0, DateTimeKind.Utc)).Ticks / 10;
+            return true;
+        }
+
+        private static bool TryEvents(string s, out uint mask)
+        {
+            mask = 0;
+            if (s == null) return false;
+            foreach (string name in s.Split(','))
+            {
+                LogEvent e;
+                if (!Enum.TryParse(name.Trim(), true, out e) || !Enum.IsDefined(typeof(LogEvent), e)) return false;
+                mask |= TelemetryLogReader.Mask(e);
+            }
+            return true;
+        }
+    }
+}
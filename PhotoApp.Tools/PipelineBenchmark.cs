@@ -0,0 +1,120 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+using System;
+using System.Collections.Concurrent;
+using System.Diagnostics;
+using System.Globalization;
+using System.IO;
+using System.IO.Pipes;
+using System.Text;
+using System.Threading;
+using PhotoApp.Core;
+
+namespace PhotoApp.Tools
+{
+    /// <summary>
+    /// Streams telemetry through a pipe into <see cref="SerialPipeline"/>
+    /// at a fixed sample rate, with a fake UI thread on the other end. The
+    /// cube flips on/off every few samples, far faster than a person can
+    /// move it, so coalescing has something to do. Reports throughput,
+    /// drops, and how much UI work the notifications would cost. The old
+    /// receive path queued one BeginInvoke per qualifying line.
+    /// </summary>
+    internal static class PipelineBenchmark
+    {
+        private const int FlipEvery = 8;          // samples per on/off half-cycle
+        private const double UiWorkMs = 2.0;      // stand-in for StartSlideshow + paint
+
+        public static int Run(string[] args)
+        {
+            int samples = 200000;
+            int rate = 0;   // samples/s, 0 = as fast as possible
+            if (args.Length > 0 && !int.TryParse(args[0], out samples)) return 2;
+            if (args.Length > 1 && !int.TryParse(args[1], out rate)) return 2;
+
+            var server = new AnonymousPipeServerStream(PipeDirection.Out);
+            var client = new AnonymousPipeClientStream(PipeDirection.In, server.ClientSafePipeHandle);
+
+            // No smoothing or debounce: every flip is a transition
+            var pipeline = new SerialPipeline(client, new PresenceDetector(
+                PresenceDetector.DefaultStartCm, PresenceDetector.DefaultStopCm, 0, 0, 1));
+
+            var ui = new BlockingCollection<Action>();
+            long uiItems = 0;
+            var uiBusy = new Stopwatch();
+            var uiThread = new Thread(() =>
+            {
+                foreach (Action a in ui.GetConsumingEnumerable())
+                {
+                    uiBusy.Start();
+                    a();
+                    uiBusy.Stop();
+                    uiItems++;
+                }
+            }) { IsBackground = true, Name = "Fake UI" };
+            uiThread.Start();
+
+            Action onUi = () =>
+            {
+                pipeline.TakePresence();
+                SpinFor(UiWorkMs);
+            };
+            pipeline.PresenceChanged += () => ui.Add(onUi);
+            pipeline.Start();
+
+            var sw = Stopwatch.StartNew();
+            Write(server, samples, rate);
+            server.Dispose();   // end of stream
+            pipeline.WaitForCompletion(Timeout.Infinite);
+            double wall = sw.Elapsed.TotalSeconds;
+            ui.CompleteAdding();
+            uiThread.Join();
+            pipeline.Dispose();
+            client.Dispose();
+
+            Console.WriteLine("{0} samples in {1:F2} s ({2:F0} samples/s)", pipeline.Samples, wall, pipeline.Samples / wall);
+            Console.WriteLine("bytes read {0}, dropped {1}, reader stalls {2}, overflowed lines {3}",
+                pipeline.BytesRead, pipeline.BytesDropped, pipeline.Stalls, pipeline.LinesOverflowed);
+            Console.WriteLine("transitions {0}, UI notifications {1}, coalesced {2}",
+                pipeline.Transitions, pipeline.Notifications, pipeline.Coalesced);
+            Console.WriteLine("UI work items {0} ({1:F1}/s), UI busy {2:F1}%",
+                uiItems, uiItems / wall, 100.0 * uiBusy.Elapsed.TotalSeconds / wall);
+            Console.WriteLine("old path would have queued about {0} BeginInvokes", pipeline.Samples / 2);
+            return 0;
+        }
+
+        private static void Write(Stream output, int samples, int rate)
+        {
+            var sb = new StringBuilder();
+            var clock = Stopwatch.StartNew();
+            const int Batch = 32;
+            for (int i = 0; i < samples; i += Batch)
+            {
+                sb.Clear();
+                for (int j = i; j < Math.Min(samples, i + Batch); j++)
+                {
+                    double b = (j / FlipEvery) % 2 == 0 ? 2.0 : 6.0;
+                    sb.Append("A: 12.00 cm | B: ").Append(b.ToString("F2", CultureInfo.InvariantCulture)).Append(" cm\r\n");
+                }
+                byte[] bytes = Encoding.ASCII.GetBytes(sb.ToString());
+                output.Write(bytes, 0, bytes.Length);
+
+                if (rate > 0)
+                {
+                    // Pace to the requested rate
+                    double due = (double)(i + Batch) / rate;
+                    while (clock.Elapsed.TotalSeconds < due) Thread.Sleep(1);
+                }
+            }
+            output.Flush();
+        }
+
+        private static void SpinFor(double ms)
+        {
+            var t = Stopwatch.StartNew();
+            while (t.Elapsed.TotalMilliseconds < ms) { }
+        }
+    }
+}
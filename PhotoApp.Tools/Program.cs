@@ -0,0 +1,55 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+using System;
+using System.Linq;
+
+namespace PhotoApp.Tools
+{
+    internal static class Program
+    {
+        private static int Main(string[] args)
+        {
+            if (args.Length == 0) return Usage();
+
+            string[] rest = args.Skip(1).ToArray();
+            switch (args[0])
+            {
+                case "bench-framer":
+                    return FramerBenchmark.Run(rest);
+                case "bench-pipeline":
+                    return PipelineBenchmark.Run(rest);
+                case "replay":
+                    return CaptureReplay.Run(rest);
+                case "emulate":
+                    return EmulateCommand.Run(rest);
+                case "protocol":
+                    return ProtocolCheck.Run(rest);
+                case "query":
+                    return LogQuery.Run(rest);
+                case "bench-log":
+                    return LogBenchmark.Run(rest);
+                case "subscribe":
+                    return SubscribeCommand.Run(rest);
+                default:
+                    return Usage();
+            }
+        }
+
+        private static int Usage()
+        {
+            Console.Error.WriteLine("usage: photoapp-tools <command> [options]");
+            Console.Error.WriteLine();
+            Console.Error.WriteLine("  bench-framer [lines]              serial line framing + B: parsing, old vs new path");
+            Console.Error.WriteLine("  bench-pipeline [samples] [rate]   serial pipeline throughput, drops, UI notifications");
+            Console.Error.WriteLine("  replay [options] <capture|->       detector decisions and throughput over a serial capture");
+            Console.Error.WriteLine("  emulate [options]                  EchoMe stand-in on a Linux pty; --measure/--sweep stress the host");
+            Console.Error.WriteLine("  protocol [iterations] [golden.txt] generated codec round trips and decode/encode throughput");
+            Console.Error.WriteLine("  query [options] <log folder>       samples and game events from a PhotoApp device log");
+            Console.Error.WriteLine("  bench-log [days] [rate]            device log ingest rate and query times on synthetic data");
+            Console.Error.WriteLine("  subscribe [options]                events from a running echome-hostd, with read-to-here latency");
+            return 2;
+        }
+    }
+}
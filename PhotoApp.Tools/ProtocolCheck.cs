@@ -0,0 +1,322 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+using System;
+using System.Diagnostics;
+using System.Collections.Generic;
+using System.Globalization;
+using System.IO;
+using System.Text;
+using PhotoApp.Core;
+
+namespace PhotoApp.Tools
+{
+    /// <summary>
+    /// Checks the generated codec: golden lines (protocol/golden.txt,
+    /// written by tools/hostsim/protocol_check.cpp from protocol.h) must
+    /// decode and re-encode to the same bytes and golden commands must
+    /// decode as the firmware decodes them, random messages must survive
+    /// encode/decode/encode, and distance lines are timed against the
+    /// lenient <see cref="TelemetryParser"/> path.
+    /// </summary>
+    internal static class ProtocolCheck
+    {
+        private const string DefaultGolden = "protocol/golden.txt";
+
+        // Must not decode as what Classify says they start like
+        private static readonly string[] Rejected =
+        {
+            "A: 5.15 cm | B: 3.43",
+            "A: 5.15 cm | B: 3.43 cm | t=",
+            "A: 5.15 cm | B: 3.43 cm | t=4294967296",
+            "SYNC t=12x",
+            "OKAY",
+            "LAT b=2 n=26 p50<=4 p99<=16 max=52123 h=1,",
+            "~abc",
+            "CAL B base=34mm noise=1mm on=29mm off=32mm",
+            "Turn ",
+            "YOU WIN!!",
+        };
+
+        public static int Run(string[] args)
+        {
+            int iterations = 200000;
+            if (args.Length > 0 && !int.TryParse(args[0], out iterations)) return 2;
+            string path = args.Length > 1 ? args[1] : DefaultGolden;
+
+            string[] golden;
+            try
+            {
+                golden = File.ReadAllLines(path, Encoding.UTF8);
+            }
+            catch (IOException e)
+            {
+                Console.Error.WriteLine("{0}: {1}", path, e.Message);
+                return 1;
+            }
+
+            int lines;
+            int failures = CheckGolden(golden, out lines) + CheckRandom(iterations);
+            Console.WriteLine("{0} golden, {1} rejected, {2} random: {3} failures",
+                lines, Rejected.Length, iterations, failures);
+            if (failures != 0) return 1;
+
+            Console.WriteLine();
+            Benchmark(iterations);
+            return 0;
+        }
+
+        private static int CheckGolden(string[] golden, out int lines)
+        {
+            int failures = 0;
+            lines = 0;
+            var buffer = new byte[256];
+            foreach (string text in golden)
+            {
+                if (text.StartsWith("#", StringComparison.Ordinal)) continue;
+                lines++;
+                if (text.StartsWith("> ", StringComparison.Ordinal))
+                {
+                    if (!CheckCommand(text))
+                    {
+                        Console.WriteLine("command: {0}", text);
+                        failures++;
+                    }
+                    continue;
+                }
+                byte[] line = Encoding.UTF8.GetBytes(text);
+                int n = RoundTrip(line, buffer);
+                if (n != line.Length || !Same(line, buffer, n))
+                {
+                    Console.WriteLine("golden: {0}", text);
+                    failures++;
+                }
+            }
+            foreach (string text in Rejected)
+            {
+                byte[] line = Encoding.UTF8.GetBytes(text);
+                if (RoundTrip(line, buffer) >= 0)
+                {
+                    Console.WriteLine("accepted: {0}", text);
+                    failures++;
+                }
+            }
+            return failures;
+        }
+
+        // "> <text> <n>": n is what decodeCommand returned for text, 0 for
+        // none, else the command's position in the schema counting from 1
+        private static bool CheckCommand(string golden)
+        {
+            int space = golden.LastIndexOf(' ');
+            int expected;
+            if (space < 1 || !int.TryParse(golden.Substring(space + 1), NumberStyles.None, CultureInfo.InvariantCulture, out expected))
+                return false;
+            byte[] text = Encoding.ASCII.GetBytes(golden.Substring(2, space - 2));
+            Protocol.Command command;
+            if (!Protocol.TryDecodeCommand(text, 0, text.Length, out command)) return expected == 0;
+            if ((int)command + 1 != expected) return false;
+
+            // And the host sends exactly that text
+            byte[] sent = Protocol.CommandLine(command);
+            return sent.Length == text.Length + 1 && Same(text, sent, text.Length);
+        }
+
+        // Decodes by kind and re-encodes into buffer; -1 if it does not decode
+        private static int RoundTrip(byte[] line, byte[] buffer)
+        {
+            int count = line.Length;
+            switch (Protocol.Classify(line, 0, count))
+            {
+                case Protocol.MessageKind.Ready:
+                    Protocol.Ready ready;
+                    return Protocol.TryDecode(line, 0, count, out ready) ? Protocol.Encode(in ready, buffer, 0) : -1;
+                case Protocol.MessageKind.Distance:
+                    Protocol.Distance distance;
+                    return Protocol.TryDecode(line, 0, count, out distance) ? Protocol.Encode(in distance, buffer, 0) : -1;
+                case Protocol.MessageKind.SyncReply:
+                    Protocol.SyncReply sync;
+                    return Protocol.TryDecode(line, 0, count, out sync) ? Protocol.Encode(in sync, buffer, 0) : -1;
+                case Protocol.MessageKind.Ok:
+                    Protocol.Ok ok;
+                    return Protocol.TryDecode(line, 0, count, out ok) ? Protocol.Encode(in ok, buffer, 0) : -1;
+                case Protocol.MessageKind.Err:
+                    Protocol.Err err;
+                    return Protocol.TryDecode(line, 0, count, out err) ? Protocol.Encode(in err, buffer, 0) : -1;
+                case Protocol.MessageKind.Stall:
+                    Protocol.Stall stall;
+                    return Protocol.TryDecode(line, 0, count, out stall) ? Protocol.Encode(in stall, buffer, 0) : -1;
+                case Protocol.MessageKind.Latency:
+                    Protocol.Latency latency;
+                    return Protocol.TryDecode(line, 0, count, out latency) ? Protocol.Encode(in latency, buffer, 0) : -1;
+                case Protocol.MessageKind.Sound:
+                    Protocol.Sound sound;
+                    return Protocol.TryDecode(line, 0, count, out sound) ? Protocol.Encode(in sound, buffer, 0) : -1;
+                case Protocol.MessageKind.Strips:
+                    Protocol.Strips strips;
+                    return Protocol.TryDecode(line, 0, count, out strips) ? Protocol.Encode(in strips, buffer, 0) : -1;
+                case Protocol.MessageKind.Record:
+                    Protocol.Record record;
+                    return Protocol.TryDecode(line, 0, count, out record) ? Protocol.Encode(in record, buffer, 0) : -1;
+                case Protocol.MessageKind.Calibration:
+                    Protocol.Calibration cal;
+                    return Protocol.TryDecode(line, 0, count, out cal) ? Protocol.Encode(in cal, buffer, 0) : -1;
+                case Protocol.MessageKind.Turn:
+                    Protocol.Turn turn;
+                    return Protocol.TryDecode(line, 0, count, out turn) ? Protocol.Encode(in turn, buffer, 0) : -1;
+                case Protocol.MessageKind.YourTurn:
+                    Protocol.YourTurn yourTurn;
+                    return Protocol.TryDecode(line, 0, count, out yourTurn) ? Protocol.Encode(in yourTurn, buffer, 0) : -1;
+                case Protocol.MessageKind.Correct:
+                    Protocol.Correct correct;
+                    return Protocol.TryDecode(line, 0, count, out correct) ? Protocol.Encode(in correct, buffer, 0) : -1;
+                case Protocol.MessageKind.NextLevel:
+                    Protocol.NextLevel nextLevel;
+                    return Protocol.TryDecode(line, 0, count, out nextLevel) ? Protocol.Encode(in nextLevel, buffer, 0) : -1;
+                case Protocol.MessageKind.Wrong:
+                    Protocol.Wrong wrong;
+                    return Protocol.TryDecode(line, 0, count, out wrong) ? Protocol.Encode(in wrong, buffer, 0) : -1;
+                case Protocol.MessageKind.Fail:
+                    Protocol.Fail fail;
+                    return Protocol.TryDecode(line, 0, count, out fail) ? Protocol.Encode(in fail, buffer, 0) : -1;
+                case Protocol.MessageKind.Win:
+                    Protocol.Win win;
+                    return Protocol.TryDecode(line, 0, count, out win) ? Protocol.Encode(in win, buffer, 0) : -1;
+                default:
+                    return -1;
+            }
+        }
+
+        private static int CheckRandom(int iterations)
+        {
+            var rng = new Random(439);
+            var first = new byte[256];
+            var second = new byte[256];
+            int failures = 0;
+            for (int i = 0; i < iterations; i++)
+            {
+                int n = EncodeRandom(rng, i % 3, first);
+                var line = new byte[n];
+                Buffer.BlockCopy(first, 0, line, 0, n);
+                int m = RoundTrip(line, second);
+                if (m == n && Same(line, second, m)) continue;
+                if (failures++ < 10) Console.WriteLine("random: {0}", Encoding.UTF8.GetString(line));
+            }
+            return failures;
+        }
+
+        private static int EncodeRandom(Random rng, int kind, byte[] buffer)
+        {
+            switch (kind)
+            {
+                case 0:
+                    var d = new Protocol.Distance
+                    {
+                        A = rng.Next(10) == 0 ? double.NaN : rng.Next(0, 40000) / 100.0,
+                        B = rng.Next(0, 40000) / 100.0,
+                        HasT = rng.Next(4) != 0,
+                        T = (uint)rng.Next() << 1 | (uint)rng.Next(2)
+                    };
+                    return Protocol.Encode(in d, buffer, 0);
+                case 1:
+                    var s = new Protocol.Sound
+                    {
+                        Voices = (byte)rng.Next(4),
+                        Slots = 3,
+                        Max = (ushort)rng.Next(ushort.MaxValue + 1),
+                        Avg = (ushort)rng.Next(ushort.MaxValue + 1),
+                        Load = (byte)rng.Next(256),
+                        Budget = 512
+                    };
+                    return Protocol.Encode(in s, buffer, 0);
+                default:
+                    var y = new Protocol.SyncReply { T = (uint)rng.Next() << 1 | (uint)rng.Next(2) };
+                    return Protocol.Encode(in y, buffer, 0);
+            }
+        }
+
+        private static bool Same(byte[] a, byte[] b, int count)
+        {
+            for (int i = 0; i < count; i++)
+                if (a[i] != b[i]) return false;
+            return true;
+        }
+
+        // ------------------ Throughput ------------------
+        private static double _sum;
+
+        private static void Benchmark(int lines)
+        {
+            var rng = new Random(439);
+            var stream = new byte[lines][];
+            for (int i = 0; i < lines; i++)
+            {
+                var d = new Protocol.Distance { A = rng.Next(4000) / 100.0, B = rng.Next(800) / 100.0, HasT = true, T = (uint)rng.Next() };
+                var buf = new byte[Protocol.Distance.MaxLength];
+                int n = Protocol.Encode(in d, buf, 0);
+                Array.Resize(ref buf, n);
+                stream[i] = buf;
+            }
+
+            Console.WriteLine("{0,-16} {1,10} {2,12}", "path", "ns/line", "bytes/line");
+            for (int pass = 0; pass < 2; pass++)   // the first pass warms the JIT
+            {
+                bool print = pass == 1;
+                Report("parser decode", lines, print, () =>
+                {
+                    foreach (byte[] line in stream)
+                    {
+                        double cm;
+                        uint micros;
+                        if (TelemetryParser.TryParseDistanceB(line, 0, line.Length, out cm)
+                            && TelemetryParser.TryParseDeviceTime(line, 0, line.Length, out micros))
+                            _sum += cm + micros;
+                    }
+                });
+                Report("protocol decode", lines, print, () =>
+                {
+                    foreach (byte[] line in stream)
+                    {
+                        Protocol.Distance d;
+                        if (Protocol.TryDecode(line, 0, line.Length, out d)) _sum += d.B + d.T;
+                    }
+                });
+                Report("string encode", lines, print, () =>
+                {
+                    var sb = new StringBuilder(64);
+                    for (int i = 0; i < lines; i++)
+                    {
+                        sb.Clear();
+                        sb.Append("A: ").Append((i % 4000 / 100.0).ToString("F2", CultureInfo.InvariantCulture))
+                          .Append(" cm | B: ").Append((i % 800 / 100.0).ToString("F2", CultureInfo.InvariantCulture))
+                          .Append(" cm | t=").Append((uint)i);
+                        _sum += Encoding.ASCII.GetByteCount(sb.ToString());
+                    }
+                });
+                Report("protocol encode", lines, print, () =>
+                {
+                    var buf = new byte[Protocol.Distance.MaxLength];
+                    for (int i = 0; i < lines; i++)
+                    {
+                        var d = new Protocol.Distance { A = i % 4000 / 100.0, B = i % 800 / 100.0, HasT = true, T = (uint)i };
+                        _sum += Protocol.Encode(in d, buf, 0);
+                    }
+                });
+            }
+        }
+
+        private static void Report(string name, int lines, bool print, Action run)
+        {
+            GC.Collect();
+            GC.WaitForPendingFinalizers();
+            long alloc = GC.GetAllocatedBytesForCurrentThread();
+            var sw = Stopwatch.StartNew();
+            run();
+            sw.Stop();
+            alloc = GC.GetAllocatedBytesForCurrentThread() - alloc;
+            if (print)
+                Console.WriteLine("{0,-16} {1,10:F1} {2,12:F1}", name, sw.Elapsed.TotalMilliseconds * 1e6 / lines, (double)alloc / lines);
+        }
+    }
+}
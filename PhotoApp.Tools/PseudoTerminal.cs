@@ -0,0 +1,134 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+using System;
+using System.ComponentModel;
+using System.Runtime.InteropServices;
+
+namespace PhotoApp.Tools
+{
+    /// <summary>
+    /// A Linux pseudo-terminal pair in raw mode. Programs open
+    /// <see cref="SlavePath"/> like a serial port; this side reads and
+    /// writes the master end with plain read/write calls. The slave end
+    /// is held open here too, so the pty survives clients coming and going.
+    /// </summary>
+    internal sealed class PseudoTerminal : IDisposable
+    {
+        private const int O_RDWR = 0x2;
+        private const int O_NOCTTY = 0x100;
+        private const int TCSANOW = 0;
+        private const int EINTR = 4;
+        private const int EIO = 5;
+        private const short POLLIN = 0x1;
+
+        /// <summary><see cref="Read"/> found nothing within its timeout.</summary>
+        public const int Quiet = -1;
+
+        [StructLayout(LayoutKind.Sequential)]
+        private struct PollFd
+        {
+            public int Fd;
+            public short Events;
+            public short Revents;
+        }
+
+        private int _master = -1;
+        private int _slave = -1;
+
+        public PseudoTerminal()
+        {
+            if (!RuntimeInformation.IsOSPlatform(OSPlatform.Linux))
+                throw new PlatformNotSupportedException("pseudo-terminals need Linux");
+
+            _master = posix_openpt(O_RDWR | O_NOCTTY);
+            if (_master < 0) throw Error("posix_openpt");
+            if (grantpt(_master) != 0) throw Error("grantpt");
+            if (unlockpt(_master) != 0) throw Error("unlockpt");
+
+            SlavePath = Marshal.PtrToStringAnsi(ptsname(_master));
+            _slave = open(SlavePath, O_RDWR | O_NOCTTY);
+            if (_slave < 0) throw Error("open " + SlavePath);
+
+            // No echo, no line editing, no CR/LF translation: bytes pass as-is.
+            // termios is handled as an opaque buffer so its layout does not matter.
+            var tio = new byte[256];
+            if (tcgetattr(_slave, tio) != 0) throw Error("tcgetattr");
+            cfmakeraw(tio);
+            if (tcsetattr(_slave, TCSANOW, tio) != 0) throw Error("tcsetattr");
+        }
+
+        public string SlavePath { get; private set; }
+
+        /// <summary>
+        /// Reads from the master, waiting at most <paramref name="timeoutMs"/>
+        /// for a byte: <see cref="Quiet"/> if none came, 0 once closed. Closing
+        /// the fd from another thread does not wake a blocked read on Linux,
+        /// so readers wait in slices and check whether to stop between them.
+        /// </summary>
+        public int Read(byte[] buffer, int offset, int count, int timeoutMs)
+        {
+            while (true)
+            {
+                var p = new PollFd { Fd = _master, Events = POLLIN };
+                int ready = poll(ref p, 1, timeoutMs);
+                if (ready < 0)
+                {
+                    if (Marshal.GetLastWin32Error() == EINTR) continue;
+                    return 0;
+                }
+                if (ready == 0) return Quiet;
+                if ((p.Revents & POLLIN) == 0) return 0;   // hung up or closed
+
+                long n = (long)read(_master, ref buffer[offset], (IntPtr)count);
+                if (n >= 0) return (int)n;
+                int err = Marshal.GetLastWin32Error();
+                if (err == EINTR) continue;
+                if (err == EIO) return 0;   // hung up
+                throw new Win32Exception(err);
+            }
+        }
+
+        public void Write(byte[] buffer, int offset, int count)
+        {
+            while (count > 0)
+            {
+                long n = (long)write(_master, ref buffer[offset], (IntPtr)count);
+                if (n < 0)
+                {
+                    int err = Marshal.GetLastWin32Error();
+                    if (err == EINTR) continue;
+                    throw new Win32Exception(err);
+                }
+                offset += (int)n;
+                count -= (int)n;
+            }
+        }
+
+        public void Dispose()
+        {
+            if (_slave >= 0) close(_slave);
+            if (_master >= 0) close(_master);
+            _slave = _master = -1;
+        }
+
+        private static Exception Error(string what)
+        {
+            return new Win32Exception(Marshal.GetLastWin32Error(), what + " failed");
+        }
+
+        [DllImport("libc", SetLastError = true)] private static extern int posix_openpt(int flags);
+        [DllImport("libc", SetLastError = true)] private static extern int grantpt(int fd);
+        [DllImport("libc", SetLastError = true)] private static extern int unlockpt(int fd);
+        [DllImport("libc", SetLastError = true)] private static extern IntPtr ptsname(int fd);
+        [DllImport("libc", SetLastError = true)] private static extern int open([MarshalAs(UnmanagedType.LPStr)] string path, int flags);
+        [DllImport("libc", SetLastError = true)] private static extern int close(int fd);
+        [DllImport("libc", SetLastError = true)] private static extern int tcgetattr(int fd, byte[] termios);
+        [DllImport("libc", SetLastError = true)] private static extern int tcsetattr(int fd, int action, byte[] termios);
+        [DllImport("libc")] private static extern void cfmakeraw(byte[] termios);
+        [DllImport("libc", SetLastError = true)] private static extern int poll(ref PollFd fds, uint nfds, int timeout);
+        [DllImport("libc", SetLastError = true)] private static extern IntPtr read(int fd, ref byte buf, IntPtr count);
+        [DllImport("libc", SetLastError = true)] private static extern IntPtr write(int fd, ref byte buf, IntPtr count);
+    }
+}
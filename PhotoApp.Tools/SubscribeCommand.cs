@@ -0,0 +1,153 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+using System;
+using System.Collections.Generic;
+using System.Globalization;
+using System.Threading;
+using PhotoApp.Core;
+
+namespace PhotoApp.Tools
+{
+    /// <summary>
+    /// Subscribes to a running echome-hostd, prints what it publishes and,
+    /// on exit, how long frames took from the daemon's serial read to
+    /// arriving here (one host clock, so no sync involved).
+    /// </summary>
+    internal static class SubscribeCommand
+    {
+        private sealed class Options
+        {
+            public string Pipe = HostEvents.DefaultPipeName;
+            public bool Samples;
+            public bool Quiet;
+            public double Seconds;   // 0: until Ctrl+C or the daemon stops
+        }
+
+        private static readonly List<long> _readToHere = new List<long>();
+        private static readonly List<long> _publishToHere = new List<long>();
+        private static readonly Dictionary<byte, string> _names = new Dictionary<byte, string>();
+        private static bool _quiet;
+
+        public static int Run(string[] args)
+        {
+            Options o = Parse(args);
+            if (o == null)
+            {
+                Console.Error.WriteLine("usage: photoapp-tools subscribe [--pipe name] [--samples] [--quiet] [--seconds n]");
+                return 2;
+            }
+
+            HostEventClient client;
+            try
+            {
+                client = HostEventClient.Connect(o.Pipe, 2000);
+            }
+            catch (Exception ex) when (ex is TimeoutException || ex is System.IO.IOException)
+            {
+                Console.Error.WriteLine("no echome-hostd on {0}", o.Pipe);
+                return 1;
+            }
+
+            _quiet = o.Quiet;
+            var done = new ManualResetEventSlim();
+            Console.CancelKeyPress += (s, e) => { e.Cancel = true; done.Set(); };
+            using (client)
+            {
+                client.Received += OnFrame;
+                client.Closed += done.Set;
+                uint mask = HostEvents.Mask(HostFrameType.Presence) | HostEvents.Mask(HostFrameType.Event);
+                if (o.Samples) mask |= HostEvents.Mask(HostFrameType.Sample);
+                client.Start(mask);
+                if (o.Seconds > 0) done.Wait(TimeSpan.FromSeconds(o.Seconds));
+                else done.Wait();
+
+                Console.WriteLine();
+                Console.WriteLine("{0} frames, {1} dropped by the daemon", client.Frames, client.Dropped);
+            }
+            lock (_readToHere)
+            {
+                Report("serial read -> here", _readToHere);
+                Report("published -> here", _publishToHere);
+            }
+            return 0;
+        }
+
+        private static void OnFrame(in HostEvent e)
+        {
+            long now = ClockSync.HostMicrosNow();
+            if (e.Type == HostFrameType.DeviceUp)
+            {
+                lock (_names) _names[e.Device] = e.Name;
+                Console.WriteLine("{0}: up, {1}", e.Name, e.State.ToString().ToLowerInvariant());
+                return;
+            }
+
+            string name;
+            lock (_names) if (!_names.TryGetValue(e.Device, out name)) name = "#" + e.Device;
+            if (e.Type == HostFrameType.DeviceDown)
+            {
+                Console.WriteLine("{0}: down", name);
+                return;
+            }
+
+            lock (_readToHere)
+            {
+                if (e.ReadHostUs >= 0) _readToHere.Add(now - e.ReadHostUs);
+                _publishToHere.Add(now - e.PublishedHostUs);
+            }
+            if (_quiet) return;
+            switch (e.Type)
+            {
+                case HostFrameType.Presence:
+                    Console.WriteLine("{0}: {1}{2}", name, e.State.ToString().ToLowerInvariant(),
+                        e.SmoothUs >= 0 ? string.Format(CultureInfo.InvariantCulture, " (smooth {0} ms, debounce {1} ms)", e.SmoothUs / 1000, e.DebounceUs / 1000) : "");
+                    break;
+                case HostFrameType.Event:
+                    Console.WriteLine("{0}: {1}{2}", name, e.Event.ToString().ToLowerInvariant(),
+                        e.Event == LogEvent.Turn || e.Event == LogEvent.Stall || e.Event == LogEvent.Calibrated ? " " + e.Arg : "");
+                    break;
+                case HostFrameType.Sample:
+                    Console.WriteLine("{0}: A={1} B={2}", name, Cm(e.A), Cm(e.B));
+                    break;
+            }
+        }
+
+        private static string Cm(ushort centi)
+        {
+            return centi == LogRecord.NoEcho ? "-" : (centi / 100.0).ToString("F2", CultureInfo.InvariantCulture);
+        }
+
+        private static void Report(string what, List<long> us)
+        {
+            if (us.Count == 0) return;
+            us.Sort();
+            Console.WriteLine("{0,-20} n={1} p50={2} µs p99={3} µs max={4} µs",
+                what, us.Count, us[us.Count / 2], us[(int)(us.Count * 0.99)], us[us.Count - 1]);
+        }
+
+        private static Options Parse(string[] args)
+        {
+            var o = new Options();
+            for (int i = 0; i < args.Length; i++)
+            {
+                string a = args[i];
+                string v = i + 1 < args.Length ? args[i + 1] : null;
+                switch (a)
+                {
+                    case "--pipe": if (v == null) return null; o.Pipe = v; i++; break;
+                    case "--samples": o.Samples = true; break;
+                    case "--quiet": o.Quiet = true; break;
+                    case "--seconds":
+                        if (!double.TryParse(v, NumberStyles.Float, CultureInfo.InvariantCulture, out o.Seconds)) return null;
+                        i++;
+                        break;
+                    default:
+                        return null;
+                }
+            }
+            return o;
+        }
+    }
+}
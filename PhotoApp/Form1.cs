@@ -7,287 +7,447 @@
 
 using System;
 using System.Collections.Generic;
+using System.Diagnostics;
 using System.Drawing;
-using System.Globalization;
 using System.IO;
 using System.IO.Ports;
 using System.Linq;
-using System.Text.RegularExpressions;
+using System.Threading;
 using System.Windows.Forms;
+using PhotoApp.Core;
 
 namespace PhotoApp
 {
     public partial class Form1 : Form
     {
-        private SerialPort _port;
+        // One per connected EchoMe, keyed by port name
+        private sealed class Device
+        {
+            public string Name;
+            public byte HostId;             // echome-hostd's id; no Port/Session/Log then
+            public Stream Port;             // as DeviceDiscovery handed it over
+            public DeviceSession Session;   // async reads; no threads of its own
+            public TelemetryLog Log;        // samples and game events, for photoapp-tools query
+            public Slideshow Show;
+            public SlideshowWindow Window;  // null: shown in pictureBox1
+            public bool Closed;
+        }
 
-        // ----- Slideshow state -----
-        private readonly List<Image> _images = new List<Image>();
-        private int _imgIdx = 0;
-        private readonly Timer _slideTimer = new Timer();   // advances photos
-        private bool _slideshowOn = false;
+        private readonly Dictionary<string, Device> _devices = new Dictionary<string, Device>(StringComparer.OrdinalIgnoreCase);
 
-        // Hysteresis around 3 cm to avoid flicker
-        private const double StartThresh = 2.8; // ON when < 2.8 cm
-        private const double StopThresh = 3.5; // OFF when > 3.5 cm
+        // When echome-hostd is running it owns the ports (and the log) and
+        // this window is one of its subscribers; otherwise ports open here
+        private HostEventClient _host;
 
-        // Debounce
-        private readonly TimeSpan _startDebounce = TimeSpan.FromMilliseconds(250);
-        private readonly TimeSpan _stopDebounce = TimeSpan.FromMilliseconds(700);
-        private DateTime _belowStart = DateTime.MinValue;
-        private DateTime _aboveStart = DateTime.MinValue;
+        // Direct mode: every port is probed for an EchoMe at once, and a board
+        // that is unplugged is connected again when it comes back
+        private readonly DeviceDiscovery _discovery = new DeviceDiscovery(SerialPort.GetPortNames, OpenPort);
 
-        // Smoothing (moving average last N non-NaN samples)
-        private readonly Queue<double> _last = new Queue<double>();
-        private const int SmoothCount = 5;
+        // ----- Photos -----
+        // Decoded lazily in the background, at most PhotoCacheBytes in memory
+        // per album, and shared by every device showing that album
+        private const long PhotoCacheBytes = 256L * 1024 * 1024;
+        private const long ScaledCacheBytes = 1024L * 1024 * 1024;   // on disk
+        private readonly PhotoLibrary _library = new PhotoLibrary(PhotoCacheBytes, OpenScaledCache());
+        private PhotoLibrary.Lease _defaultAlbum;   // keeps the main album warm with no device connected
 
-        // Your photo folder
+        // Cube-to-photo latency over all devices: the session stamps up to the
+        // detector decision, the UI adds dispatch, image assignment and first paint
+        private readonly LatencyReport _latency = new LatencyReport();
+        private readonly ToolTip _latencyTip = new ToolTip();
+
+        // Your photo folder. A subfolder named after a port (e.g. "COM5")
+        // gives that device its own album.
         private const string PhotoFolder = @"C:\Users\clair\Desktop\Photos";
 
-        // Regex to pull Sensor B from lines like: "A: 10.23 cm | B: 2.75 cm"
-        private static readonly Regex _bRegex = new Regex(
-            @"\bB:\s*([-+]?\d+(?:\.\d+)?)\s*(?:cm)?",
-            RegexOptions.IgnoreCase | RegexOptions.Compiled);
+        // Per-device history, one folder per port
+        private static readonly string LogFolder = Path.Combine(
+            Environment.GetFolderPath(Environment.SpecialFolder.LocalApplicationData), "RemindME", "Log");
 
         public Form1()
         {
             InitializeComponent();
 
+            this.Load += Form1_Load;
             this.FormClosing += Form1_FormClosing;
 
-            // PictureBox: single frame for slideshow
+            // PictureBox: single frame for the first device's slideshow
             pictureBox1.SizeMode = PictureBoxSizeMode.Zoom;
             pictureBox1.BackColor = Color.Black;
             this.DoubleBuffered = true;
 
-            // Slide every 5 seconds
-            _slideTimer.Interval = 5000;
-            _slideTimer.Tick += (s, e) => AdvancePhoto();
+            label2.Text = _latency.Summary();
 
             // UI defaults
             button2.Enabled = false;
             button1.Text = "Connect";
             button2.Text = "Disconnect";
 
-            // Load photos once
-            TryLoadImages(PhotoFolder);
+            // Index photos (paths only; decoding happens on demand) and queue
+            // the first slides before any cube arrives
+            _defaultAlbum = _library.Open(PhotoFolder);
+            _defaultAlbum.TargetSize = pictureBox1.ClientSize;
+            _defaultAlbum.Store.Prefetch(_defaultAlbum.Store.Count - 1, 2);
 
             // Ports
             RefreshComPorts();
             comboBox1.DropDown += (s, e) => RefreshComPorts();
+            comboBox1.SelectedIndexChanged += (s, e) => UpdateConnectionUi();
         }
 
-        // ------------------ Connect / Disconnect ------------------
-        private void button1_Click(object sender, EventArgs e)
+        // Both raise events that BeginInvoke, so not before the window handle exists
+        private void Form1_Load(object sender, EventArgs e)
         {
-            if (_port != null && _port.IsOpen) return;
+            AttachToDaemon();
+            _discovery.Found += Discovery_Found;
+            if (_host == null) _discovery.Start();
+        }
 
+        // ------------------ Connect / Disconnect ------------------
+        // Connect adds the selected port, if an EchoMe answers on it; any
+        // number can be connected at once. Usually discovery got there first.
+        private async void button1_Click(object sender, EventArgs e)
+        {
             var selected = comboBox1.SelectedItem as string;
             if (string.IsNullOrWhiteSpace(selected))
             {
                 MessageBox.Show("Please select a COM port first.");
                 return;
             }
+            if (_devices.ContainsKey(selected)) return;
 
+            _discovery.Claim(selected);   // the watch keeps off it while we probe
+            button1.Enabled = false;
+            button1.Text = "Connecting...";
+            DiscoveredDevice found = await DeviceDiscovery.ProbeAsync(selected, OpenPort, DeviceDiscovery.DefaultProbeTimeout, CancellationToken.None);
+            if (IsDisposed)
+            {
+                if (found != null) found.Stream.Dispose();
+                return;
+            }
+            if (found == null)
+            {
+                _discovery.Release(selected);
+                UpdateConnectionUi();
+                MessageBox.Show("No EchoMe answered on " + selected + ".",
+                                "Error", MessageBoxButtons.OK, MessageBoxIcon.Error);
+                return;
+            }
+            AddDevice(found);
+        }
+
+        // Pool thread: the watch found a board and claimed its port for us
+        private void Discovery_Found(DiscoveredDevice found)
+        {
             try
             {
-                _port = new SerialPort(selected, 9600);
-                _port.NewLine = "\n";
-                _port.ReadTimeout = 2000;
-                _port.DataReceived += Port_DataReceived;
-                _port.Open();
-
-                button1.Enabled = false;
-                button2.Enabled = true;
-                comboBox1.Enabled = false;
-
-                button1.Text = "Connected";
-                button1.BackColor = Color.LightGreen;
-                button2.Text = "Disconnect";
-                button2.BackColor = SystemColors.Control;
-
-                this.Text = "RemindME Photos — Connected (" + selected + ")";
+                BeginInvoke((Action)(() =>
+                {
+                    if (IsDisposed || _host != null || _devices.ContainsKey(found.Port)) found.Stream.Dispose();
+                    else AddDevice(found);
+                }));
+            }
+            catch (InvalidOperationException)
+            {
+                found.Stream.Dispose();   // form is closing
+            }
+        }
+
+        private void AddDevice(DiscoveredDevice found)
+        {
+            var device = new Device { Name = found.Port, Port = found.Stream };
+            try
+            {
+                AttachShow(device);
+
+                // Smoothing, hysteresis and debounce (PresenceDetector) run
+                // wherever the read completed; the UI only hears about changes
+                device.Session = new DeviceSession(device.Name, device.Port);
+                device.Log = new TelemetryLog(Path.Combine(LogFolder, Path.GetFileName(device.Name)));
+                device.Session.Telemetry.Log = device.Log;
+                device.Session.Telemetry.PresenceChanged += () => Device_PresenceChanged(device);
+                device.Session.Completed += s => Device_Completed(device);
+                _devices.Add(device.Name, device);
+                device.Session.Start();
+                device.Session.Telemetry.Send(Protocol.Command.StreamOn);   // every sample, device-stamped (older firmware answers ERR)
+
+                if (device.Window != null) device.Window.Show(this);
+                comboBox1.SelectedItem = device.Name;
+                UpdateConnectionUi();
+                Debug.WriteLine(device.Name + ": EchoMe " + (found.Firmware ?? "(no version)") + ", answered in " + found.ProbeMs + " ms");
             }
             catch (Exception ex)
             {
-                MessageBox.Show("Failed to open " + selected + "\n\n" + ex.Message,
+                MessageBox.Show("Failed to open " + device.Name + "\n\n" + ex.Message,
                                 "Error", MessageBoxButtons.OK, MessageBoxIcon.Error);
-                SafeClosePort();
+                Disconnect(device);
+            }
+        }
+
+        // Same settings as the EchoMe; no ReadTimeout, so the session's read just stays pending
+        private static Stream OpenPort(string name)
+        {
+            var port = new SerialPort(name, 9600);
+            port.Open();
+            return port.BaseStream;   // closing it closes the port
+        }
+
+        // The first device shows in this window, later ones get their own
+        private void AttachShow(Device device)
+        {
+            PictureBox surface = pictureBox1;
+            if (_devices.Values.Any(d => d.Window == null))
+            {
+                device.Window = new SlideshowWindow(device.Name, _devices.Count);
+                device.Window.FormClosed += (s, ev) => Disconnect(device);
+                surface = device.Window.Surface;
             }
+            device.Show = new Slideshow(surface, _library.Open(AlbumFor(device.Name)));
+            device.Show.ArrivalShown += trace => OnArrivalShown(device, trace);
         }
 
+        // Disconnect removes the selected port
         private void button2_Click(object sender, EventArgs e)
         {
-            SafeClosePort();
+            Device device;
+            var selected = comboBox1.SelectedItem as string;
+            if (selected == null || !_devices.TryGetValue(selected, out device)) return;
 
-            button1.Enabled = true;
-            button2.Enabled = false;
-            comboBox1.Enabled = true;
+            Disconnect(device);
 
-            button1.Text = "Connect";
-            button1.BackColor = SystemColors.Control;
             button2.Text = "Disconnected";
             button2.BackColor = Color.LightCoral;
-
-            this.Text = "RemindME Photos";
-
-            StopSlideshow();
-            pictureBox1.Image = null; // clear only on manual disconnect
         }
 
         private void Form1_FormClosing(object sender, FormClosingEventArgs e)
         {
-            SafeClosePort();
-            foreach (var img in _images) img.Dispose();
+            _discovery.Dispose();
+            if (_host != null) _host.Dispose();
+            _host = null;
+            foreach (var device in _devices.Values.ToArray()) Disconnect(device);
+            pictureBox1.Image = null;
+            _defaultAlbum.Dispose();
+            _library.Dispose();
         }
 
         private void RefreshComPorts()
         {
             var ports = SerialPort.GetPortNames().OrderBy(p => p).ToArray();
+            var selected = comboBox1.SelectedItem as string;
             comboBox1.BeginUpdate();
             comboBox1.Items.Clear();
             comboBox1.Items.AddRange(ports);
             comboBox1.EndUpdate();
 
-            if (comboBox1.Items.Count > 0 && comboBox1.SelectedIndex < 0)
+            if (selected != null && comboBox1.Items.Contains(selected))
+                comboBox1.SelectedItem = selected;
+            else if (comboBox1.Items.Count > 0 && comboBox1.SelectedIndex < 0)
                 comboBox1.SelectedIndex = 0;
         }
 
-        private void SafeClosePort()
+        // Buttons describe the selected port; the title lists all connected ones
+        private void UpdateConnectionUi()
+        {
+            var selected = comboBox1.SelectedItem as string;
+            bool connected = selected != null && _devices.ContainsKey(selected);
+            bool direct = _host == null;   // the daemon decides which ports are open
+
+            comboBox1.Enabled = direct;
+            button1.Enabled = direct && !connected;
+            button2.Enabled = direct && connected;
+            button1.Text = connected ? "Connected" : "Connect";
+            button1.BackColor = connected ? Color.LightGreen : SystemColors.Control;
+            button2.Text = "Disconnect";
+            button2.BackColor = SystemColors.Control;
+
+            this.Text = _devices.Count == 0
+                ? (direct ? "RemindME Photos — Looking for EchoMe..." : "RemindME Photos")
+                : "RemindME Photos — Connected (" + string.Join(", ", _devices.Keys.OrderBy(k => k)) + ")"
+                  + (direct ? "" : " via echome-hostd");
+        }
+
+        private static string AlbumFor(string port)
+        {
+            string own = Path.Combine(PhotoFolder, port);
+            return Directory.Exists(own) ? own : PhotoFolder;
+        }
+
+        // A device that went away (unplugged, reset) is looked for again;
+        // one disconnected by hand stays off until Connect
+        private void Disconnect(Device device, bool rediscover = false)
         {
+            if (device.Closed) return;
+            device.Closed = true;   // late notifications from it are ignored
+            _devices.Remove(device.Name);
+
             try
             {
-                if (_port != null)
-                {
-                    _port.DataReceived -= Port_DataReceived;
-                    if (_port.IsOpen) _port.Close();
-                    _port.Dispose();
-                    _port = null;
-                }
+                if (device.Session != null) device.Session.Stop();
+                if (device.Port != null) device.Port.Dispose();   // closes the port and completes the pending read
+                if (device.Session != null) device.Session.Dispose();
+                if (device.Log != null) device.Log.Dispose();   // after the session: no more appends
             }
             catch { }
+
+            if (device.Show != null) device.Show.Dispose();   // clears the surface and releases its photos
+            if (device.Window != null && !device.Window.IsDisposed)
+            {
+                if (device.Window.Visible) device.Window.Close();
+                else device.Window.Dispose();   // failed before it was shown
+            }
+            if (rediscover && device.Port != null) _discovery.Release(device.Name);
+            if (!IsDisposed) UpdateConnectionUi();
         }
 
         // ------------------ Serial + Sensor B only ------------------
-        private void Port_DataReceived(object sender, SerialDataReceivedEventArgs e)
+        // Pool thread; at most one of these is outstanding per device
+        private void Device_PresenceChanged(Device device)
         {
             try
             {
-                var sp = (SerialPort)sender;
-                string chunk = sp.ReadExisting();
-                if (string.IsNullOrEmpty(chunk)) return;
-
-                // Split into lines and check each for a B: value
-                var lines = chunk.Split(new[] { "\r\n", "\n", "\r" }, StringSplitOptions.RemoveEmptyEntries);
-                foreach (var line in lines)
-                {
-                    double b = ParseDistanceB(line);
-                    if (double.IsNaN(b)) continue;
-
-                    // Smooth
-                    b = Smoothed(b);
-                    if (double.IsNaN(b)) continue;
-
-                    // Debounced state machine with hysteresis
-                    if (b < StartThresh)
-                    {
-                        if (_belowStart == DateTime.MinValue) _belowStart = DateTime.UtcNow;
-                        _aboveStart = DateTime.MinValue;
-
-                        if (!_slideshowOn && (DateTime.UtcNow - _belowStart) >= _startDebounce)
-                            BeginInvoke((Action)StartSlideshow);
-                    }
-                    else if (b > StopThresh)
-                    {
-                        if (_aboveStart == DateTime.MinValue) _aboveStart = DateTime.UtcNow;
-                        _belowStart = DateTime.MinValue;
-
-                        if (_slideshowOn && (DateTime.UtcNow - _aboveStart) >= _stopDebounce)
-                            BeginInvoke((Action)StopSlideshow);
-                    }
-                    else
-                    {
-                        // between thresholds — reset edge timers
-                        _belowStart = DateTime.MinValue;
-                        _aboveStart = DateTime.MinValue;
-                    }
-                }
+                BeginInvoke((Action)(() => OnPresenceChanged(device)));
             }
-            catch
+            catch (InvalidOperationException)
             {
-                // ignore transient serial glitches
+                // form is closing
             }
         }
 
-        // Extracts Sensor B from a line like: "A: 15.2 cm | B: 2.75 cm"
-        private static double ParseDistanceB(string line)
+        private void OnPresenceChanged(Device device)
         {
-            var m = _bRegex.Match(line);
-            if (!m.Success) return double.NaN;
-
-            double cm;
-            if (double.TryParse(m.Groups[1].Value, NumberStyles.Float,
-                                CultureInfo.InvariantCulture, out cm))
-                return cm;
-
-            return double.NaN;
+            if (IsDisposed || device.Closed) return;
+            var telemetry = device.Session.Telemetry;
+            PresenceState state = telemetry.TakeState();
+            ApplyPresence(device, state, state == PresenceState.Present ? telemetry.TakeArrivalTrace() : null);
         }
 
-        private double Smoothed(double cm)
+        private void ApplyPresence(Device device, PresenceState state, LatencyTrace trace)
         {
-            if (double.IsNaN(cm)) return double.NaN;
-            if (_last.Count == SmoothCount) _last.Dequeue();
-            _last.Enqueue(cm);
-
-            double sum = 0; int n = 0;
-            foreach (var v in _last) { sum += v; n++; }
-            return n > 0 ? sum / n : double.NaN;
+            switch (state)
+            {
+                case PresenceState.Present:
+                    if (trace != null) trace.DispatchedHostUs = ClockSync.HostMicrosNow();
+                    device.Show.Start(trace);
+                    break;
+                case PresenceState.Approaching:
+                    device.Show.Prewarm();   // first photo decoded before the debounce ends
+                    break;
+                default:
+                    device.Show.Stop();
+                    device.Show.CancelPrewarm();
+                    break;
+            }
         }
 
-        // ------------------ Slideshow control ------------------
-        private void StartSlideshow()
+        // Pool thread: the port was unplugged or closed
+        private void Device_Completed(Device device)
         {
-            if (_slideshowOn) return;
-            _slideshowOn = true;
+            try
+            {
+                BeginInvoke((Action)(() => { if (!IsDisposed) Disconnect(device, true); }));
+            }
+            catch (InvalidOperationException)
+            {
+                // form is closing
+            }
+        }
 
-            if (_images.Count == 0) return;
+        // ------------------ echome-hostd ------------------
+        // A daemon that is running answers at once; none costs this timeout
+        private const int DaemonConnectMs = 200;
+
+        private void AttachToDaemon()
+        {
+            try
+            {
+                _host = HostEventClient.Connect(HostEvents.DefaultPipeName, DaemonConnectMs);
+            }
+            catch (Exception ex) when (ex is TimeoutException || ex is IOException)
+            {
+                return;   // no daemon: open ports here
+            }
+            _host.Received += Host_Received;
+            _host.Closed += Host_Closed;
+            _host.Start(HostEvents.Mask(HostFrameType.Presence));
+            UpdateConnectionUi();
+        }
 
-            _imgIdx = 0;
-            pictureBox1.Image = _images[_imgIdx]; // show immediately
-            _slideTimer.Start();
+        // Reader thread; frames keep their order through BeginInvoke
+        private void Host_Received(in HostEvent e)
+        {
+            HostEvent frame = e;   // 'in' parameters cannot be captured
+            try
+            {
+                BeginInvoke((Action)(() => OnHostEvent(frame)));
+            }
+            catch (InvalidOperationException)
+            {
+                // form is closing
+            }
         }
 
-        private void StopSlideshow()
+        private void OnHostEvent(HostEvent e)
         {
-            if (!_slideshowOn) return;
-            _slideshowOn = false;
-            _slideTimer.Stop();
-            // Do NOT clear image here—keeps last frame, avoids blanks.
+            if (IsDisposed) return;
+            if (e.Type == HostFrameType.DeviceUp)
+            {
+                if (_devices.ContainsKey(e.Name)) return;
+                var added = new Device { Name = e.Name, HostId = e.Device };
+                AttachShow(added);
+                _devices.Add(added.Name, added);
+                if (added.Window != null) added.Window.Show(this);
+                ApplyPresence(added, e.State, null);
+                UpdateConnectionUi();
+                return;
+            }
+
+            Device device = _devices.Values.FirstOrDefault(d => d.Port == null && d.HostId == e.Device);
+            if (device == null) return;
+            if (e.Type == HostFrameType.DeviceDown)
+                Disconnect(device);
+            else if (e.Type == HostFrameType.Presence)
+                ApplyPresence(device, e.State, e.State == PresenceState.Present && e.SmoothUs >= 0 ? HostEvents.ToTrace(in e) : null);
         }
 
-        private void AdvancePhoto()
+        // Reader thread: the daemon stopped; its devices go and ports can be opened here again
+        private void Host_Closed()
         {
-            if (_images.Count == 0) return;
-            _imgIdx = (_imgIdx + 1) % _images.Count;
-            pictureBox1.Image = _images[_imgIdx];
+            try
+            {
+                BeginInvoke((Action)(() =>
+                {
+                    if (IsDisposed || _host == null) return;
+                    _host.Dispose();
+                    _host = null;
+                    foreach (var device in _devices.Values.Where(d => d.Port == null).ToArray()) Disconnect(device);
+                    _discovery.Start();
+                    UpdateConnectionUi();
+                }));
+            }
+            catch (InvalidOperationException)
+            {
+                // form is closing
+            }
         }
 
-        private void TryLoadImages(string folder)
+        private void OnArrivalShown(Device device, LatencyTrace trace)
         {
-            if (!Directory.Exists(folder)) return;
+            _latency.Add(trace);
+            Debug.WriteLine(device.Name + ": " + trace);
 
-            var paths = Directory.EnumerateFiles(folder)
-                                 .Where(p =>
-                                     p.EndsWith(".jpg", StringComparison.OrdinalIgnoreCase) ||
-                                     p.EndsWith(".jpeg", StringComparison.OrdinalIgnoreCase) ||
-                                     p.EndsWith(".png", StringComparison.OrdinalIgnoreCase));
+            label2.Text = _latency.Summary();
+            _latencyTip.SetToolTip(label2, _latency.Format());
+        }
 
-            foreach (var p in paths)
+        private static ScaledImageCache OpenScaledCache()
+        {
+            try
             {
-                using (var src = Image.FromFile(p))
-                {
-                    _images.Add(new Bitmap(src)); // clone to avoid file lock
-                }
+                return new ScaledImageCache(ScaledImageCache.DefaultFolder, ScaledCacheBytes);
+            }
+            catch (Exception)
+            {
+                return null; // no writable cache folder: scale in memory only
             }
         }
 
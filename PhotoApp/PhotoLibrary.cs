@@ -0,0 +1,134 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+using System;
+using System.Collections.Generic;
+using System.Drawing;
+using System.IO;
+
+namespace PhotoApp
+{
+    /// <summary>
+    /// Shares one <see cref="PhotoStore"/> per album folder between all the
+    /// slideshows showing it, so several devices on one album decode each
+    /// photo once. <see cref="Open"/> hands out a <see cref="Lease"/>; the
+    /// store is indexed and watched on the first lease and disposed with
+    /// the last. Images pinned by several viewers stay pinned until each
+    /// one releases them (PhotoStore counts pins).
+    /// The store's scale target is the largest surface among its leases;
+    /// a smaller surface gets a larger image and zooms it down when it
+    /// draws (see Slideshow).
+    /// UI thread only.
+    /// </summary>
+    internal sealed class PhotoLibrary : IDisposable
+    {
+        public sealed class Lease : IDisposable
+        {
+            private readonly PhotoLibrary _owner;
+            private readonly Album _album;
+            private Size _size;
+            private bool _disposed;
+
+            internal Lease(PhotoLibrary owner, Album album)
+            {
+                _owner = owner;
+                _album = album;
+            }
+
+            public PhotoStore Store { get { return _album.Store; } }
+
+            public string Folder { get { return _album.Folder; } }
+
+            /// <summary>This viewer's display size.</summary>
+            public Size TargetSize
+            {
+                get { return _size; }
+                set
+                {
+                    if (_disposed || value == _size) return;
+                    _size = value;
+                    _album.Fit();
+                }
+            }
+
+            public void Dispose()
+            {
+                if (_disposed) return;
+                _disposed = true;
+                _owner.Close(this, _album);
+            }
+        }
+
+        internal sealed class Album
+        {
+            public string Folder;
+            public PhotoStore Store;
+            public readonly List<Lease> Leases = new List<Lease>();
+
+            public void Fit()
+            {
+                int w = 0, h = 0;
+                foreach (var l in Leases)
+                {
+                    w = Math.Max(w, l.TargetSize.Width);
+                    h = Math.Max(h, l.TargetSize.Height);
+                }
+                Store.TargetSize = new Size(w, h);   // ignored while all are empty
+            }
+        }
+
+        private readonly Dictionary<string, Album> _albums = new Dictionary<string, Album>(StringComparer.OrdinalIgnoreCase);
+        private readonly long _budgetBytes;
+        private readonly ScaledImageCache _disk;
+
+        /// <param name="budgetBytes">In-memory cap for each album.</param>
+        /// <param name="disk">On-disk scaled copies, shared by all albums; may be null.</param>
+        public PhotoLibrary(long budgetBytes, ScaledImageCache disk)
+        {
+            _budgetBytes = budgetBytes;
+            _disk = disk;
+        }
+
+        /// <summary>Number of albums currently open (decode workers running).</summary>
+        public int AlbumCount { get { return _albums.Count; } }
+
+        public Lease Open(string folder)
+        {
+            string key = Path.GetFullPath(folder);
+            Album album;
+            if (!_albums.TryGetValue(key, out album))
+            {
+                album = new Album { Folder = key, Store = new PhotoStore(_budgetBytes, _disk) };
+                album.Store.Index(key);
+                album.Store.Watch(key);   // pick up photos families add later
+                _albums.Add(key, album);
+            }
+            var lease = new Lease(this, album);
+            album.Leases.Add(lease);
+            return lease;
+        }
+
+        private void Close(Lease lease, Album album)
+        {
+            if (!album.Leases.Remove(lease)) return;   // library already disposed
+            if (album.Leases.Count > 0)
+            {
+                album.Fit();
+                return;
+            }
+            _albums.Remove(album.Folder);
+            album.Store.Dispose();
+        }
+
+        public void Dispose()
+        {
+            foreach (var album in _albums.Values)
+            {
+                album.Leases.Clear();
+                album.Store.Dispose();
+            }
+            _albums.Clear();
+        }
+    }
+}
@@ -0,0 +1,558 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+using System;
+using System.Collections.Generic;
+using System.Drawing;
+using System.IO;
+using System.Linq;
+using System.Threading;
+
+namespace PhotoApp
+{
+    /// <summary>
+    /// Photo album with lazy, background decoding. Only file paths are
+    /// read up front. Bitmaps are decoded on a worker thread, scaled to
+    /// <see cref="TargetSize"/>, into an LRU cache capped at a byte
+    /// budget. Images handed out by <see cref="Acquire"/> are pinned and
+    /// never evicted until <see cref="Release"/> is called.
+    /// With a <see cref="ScaledImageCache"/>, scaled copies are also kept
+    /// on disk. The worker fills in missing ones for the whole album
+    /// whenever it has nothing else to do.
+    /// <see cref="Watch"/> keeps the album in sync with its folder. Bursts
+    /// of file events are coalesced, and files still being written are
+    /// retried until they can be opened.
+    /// </summary>
+    internal sealed class PhotoStore : IDisposable
+    {
+        private sealed class Entry
+        {
+            public Image Image;
+            public long Bytes;
+            public int Pins;
+            public LinkedListNode<string> Lru;
+        }
+
+        private static readonly string[] Extensions = { ".jpg", ".jpeg", ".png" };
+        private const int SettleMs = 500;        // quiet time before applying file events
+        private const int RetryMs = 1000;        // recheck for files still being written
+        private const int MaxRetries = 60;
+        private const int MaxPrefetch = 8;       // queued upcoming slides, all viewers together
+
+        private readonly object _lock = new object();
+        private readonly long _budgetBytes;
+        private readonly List<string> _paths = new List<string>();
+        private readonly Dictionary<string, Entry> _cache = new Dictionary<string, Entry>(StringComparer.OrdinalIgnoreCase);
+        private readonly LinkedList<string> _lru = new LinkedList<string>();   // front = most recent
+        private readonly LinkedList<string> _demand = new LinkedList<string>();   // wanted on screen now
+        private readonly LinkedList<string> _prefetch = new LinkedList<string>(); // upcoming slides
+        private readonly HashSet<string> _failed = new HashSet<string>(StringComparer.OrdinalIgnoreCase);
+        private readonly ScaledImageCache _disk;
+        private readonly Thread _worker;
+        private Size _target = new Size(1920, 1080);
+        private long _cachedBytes;
+        private int _warmIndex;        // next album entry for the idle disk-cache pass
+        private bool _disposed;
+
+        // Folder watching; _pendingFiles maps path -> retries so far
+        private readonly object _watchLock = new object();
+        private readonly Dictionary<string, int> _pendingFiles = new Dictionary<string, int>(StringComparer.OrdinalIgnoreCase);
+        private readonly Timer _settleTimer;
+        private FileSystemWatcher _watcher;
+        private string _folder;
+        private bool _rescan;
+
+        public PhotoStore(long budgetBytes, ScaledImageCache disk)
+        {
+            _budgetBytes = budgetBytes;
+            _disk = disk;
+            _worker = new Thread(DecodeLoop)
+            {
+                IsBackground = true,
+                Priority = ThreadPriority.BelowNormal,
+                Name = "PhotoStore decode"
+            };
+            _worker.Start();
+            _settleTimer = new Timer(_ => ApplyFileChanges(), null, Timeout.Infinite, Timeout.Infinite);
+        }
+
+        /// <summary>Raised on the worker thread when a path has been decoded.</summary>
+        public event Action<string> Decoded;
+
+        /// <summary>
+        /// Raised on the worker thread when a path could not be decoded. It
+        /// is not tried again until the file changes.
+        /// </summary>
+        public event Action<string> DecodeFailed;
+
+        /// <summary>Raised on a pool thread after watched files were added, removed or changed.</summary>
+        public event Action AlbumChanged;
+
+        public int Count
+        {
+            get { lock (_lock) return _paths.Count; }
+        }
+
+        public long CachedBytes
+        {
+            get { lock (_lock) return _cachedBytes; }
+        }
+
+        /// <summary>
+        /// Display size photos are scaled to fit. Changing it drops the
+        /// unpinned in-memory images, since they were scaled for the old size.
+        /// </summary>
+        public Size TargetSize
+        {
+            get { lock (_lock) return _target; }
+            set
+            {
+                if (value.Width <= 0 || value.Height <= 0) return;
+                lock (_lock)
+                {
+                    if (value == _target) return;
+                    _target = value;
+                    _warmIndex = 0;
+                    foreach (var path in _cache.Where(kv => kv.Value.Pins == 0).Select(kv => kv.Key).ToArray())
+                        Evict(path);
+                    Monitor.Pulse(_lock);
+                }
+            }
+        }
+
+        public static bool IsPhoto(string path)
+        {
+            return Extensions.Any(ext => path.EndsWith(ext, StringComparison.OrdinalIgnoreCase));
+        }
+
+        /// <summary>Replaces the album with the photos in <paramref name="folder"/>. No decoding.</summary>
+        public void Index(string folder)
+        {
+            string[] paths = Directory.Exists(folder)
+                ? Directory.EnumerateFiles(folder).Where(IsPhoto).OrderBy(p => p, StringComparer.OrdinalIgnoreCase).ToArray()
+                : new string[0];
+
+            lock (_lock)
+            {
+                var keep = new HashSet<string>(paths, StringComparer.OrdinalIgnoreCase);
+                foreach (var stale in _cache.Where(kv => kv.Value.Pins == 0 && !keep.Contains(kv.Key)).Select(kv => kv.Key).ToArray())
+                    Evict(stale);
+                _paths.Clear();
+                _paths.AddRange(paths);
+                _failed.Clear();
+                _warmIndex = 0;
+                Monitor.Pulse(_lock);
+            }
+        }
+
+        /// <summary>
+        /// Starts following <paramref name="folder"/> for new, deleted,
+        /// renamed and rewritten photos. All work happens off the UI thread.
+        /// </summary>
+        public void Watch(string folder)
+        {
+            if (!Directory.Exists(folder)) return;
+            lock (_watchLock)
+            {
+                if (_watcher != null) _watcher.Dispose();
+                _folder = folder;
+                _watcher = new FileSystemWatcher(folder)
+                {
+                    NotifyFilter = NotifyFilters.FileName | NotifyFilters.LastWrite | NotifyFilters.Size,
+                    IncludeSubdirectories = false,
+                    InternalBufferSize = 64 * 1024
+                };
+                _watcher.Created += (s, e) => QueueFileChange(e.FullPath);
+                _watcher.Changed += (s, e) => QueueFileChange(e.FullPath);
+                _watcher.Deleted += (s, e) => QueueFileChange(e.FullPath);
+                _watcher.Renamed += (s, e) =>
+                {
+                    QueueFileChange(e.OldFullPath);
+                    QueueFileChange(e.FullPath);
+                };
+                _watcher.Error += (s, e) => QueueRescan();   // event buffer overflowed
+                _watcher.EnableRaisingEvents = true;
+            }
+        }
+
+        /// <summary>Path of the i-th photo (wraps around), or null if the album is empty.</summary>
+        public string PathAt(int index)
+        {
+            lock (_lock)
+            {
+                if (_paths.Count == 0) return null;
+                index %= _paths.Count;
+                if (index < 0) index += _paths.Count;
+                return _paths[index];
+            }
+        }
+
+        /// <summary>
+        /// Returns the decoded image and pins it, or null if it is not
+        /// ready yet. Then it is queued ahead of prefetches and
+        /// <see cref="Decoded"/> fires once it is.
+        /// </summary>
+        public Image Acquire(string path)
+        {
+            if (path == null) return null;
+            lock (_lock)
+            {
+                Entry e;
+                if (_cache.TryGetValue(path, out e))
+                {
+                    e.Pins++;
+                    Touch(e);
+                    return e.Image;
+                }
+                Enqueue(path, urgent: true);
+                return null;
+            }
+        }
+
+        public void Release(string path)
+        {
+            if (path == null) return;
+            lock (_lock)
+            {
+                Entry e;
+                if (_cache.TryGetValue(path, out e) && e.Pins > 0)
+                {
+                    e.Pins--;
+                    EvictOverBudget();
+                }
+            }
+        }
+
+        /// <summary>
+        /// Queues the <paramref name="ahead"/> photos after
+        /// <paramref name="index"/>. Only the newest <see cref="MaxPrefetch"/>
+        /// requests are kept, so slideshows sharing the store do not cancel
+        /// each other's, and stale ones still age out.
+        /// </summary>
+        public void Prefetch(int index, int ahead)
+        {
+            lock (_lock)
+            {
+                if (_paths.Count == 0) return;
+                for (int i = 1; i <= ahead && i <= _paths.Count; i++)
+                    Enqueue(_paths[(index + i) % _paths.Count], urgent: false);
+                while (_prefetch.Count > MaxPrefetch) _prefetch.RemoveFirst();
+            }
+        }
+
+        public void Dispose()
+        {
+            lock (_watchLock)
+            {
+                if (_watcher != null) _watcher.Dispose();
+                _watcher = null;
+                _settleTimer.Dispose();
+            }
+
+            lock (_lock)
+            {
+                if (_disposed) return;
+                _disposed = true;
+                _demand.Clear();
+                _prefetch.Clear();
+                Monitor.PulseAll(_lock);
+            }
+            _worker.Join(2000);
+
+            lock (_lock)
+            {
+                foreach (var e in _cache.Values) e.Image.Dispose();
+                _cache.Clear();
+                _lru.Clear();
+                _cachedBytes = 0;
+            }
+        }
+
+        // ------------------ Folder watching ------------------
+        private void QueueFileChange(string path)
+        {
+            if (!IsPhoto(path)) return;
+            lock (_watchLock)
+            {
+                if (_watcher == null) return;
+                _pendingFiles[path] = 0;
+                _settleTimer.Change(SettleMs, Timeout.Infinite);   // restart the quiet period
+            }
+        }
+
+        private void QueueRescan()
+        {
+            lock (_watchLock)
+            {
+                if (_watcher == null) return;
+                _rescan = true;
+                _settleTimer.Change(SettleMs, Timeout.Infinite);
+            }
+        }
+
+        // Settle timer (pool thread)
+        private void ApplyFileChanges()
+        {
+            KeyValuePair<string, int>[] batch;
+            bool rescan;
+            string folder;
+            lock (_watchLock)
+            {
+                if (_watcher == null) return;
+                batch = _pendingFiles.ToArray();
+                _pendingFiles.Clear();
+                rescan = _rescan;
+                _rescan = false;
+                folder = _folder;
+            }
+
+            bool changed = false;
+            var retry = new List<KeyValuePair<string, int>>();
+            try
+            {
+                if (rescan)
+                {
+                    Index(folder);
+                    changed = true;
+                }
+
+                foreach (var kv in batch)
+                {
+                    string path = kv.Key;
+                    if (!File.Exists(path))
+                    {
+                        changed |= RemovePath(path);
+                    }
+                    else if (IsComplete(path))
+                    {
+                        changed |= AddOrUpdatePath(path);
+                    }
+                    else if (kv.Value < MaxRetries)
+                    {
+                        retry.Add(new KeyValuePair<string, int>(path, kv.Value + 1));
+                    }
+                }
+            }
+            catch (Exception)
+            {
+                // folder vanished or is unreadable; the next event or rescan fixes it up
+            }
+
+            if (retry.Count > 0)
+            {
+                lock (_watchLock)
+                {
+                    if (_watcher == null) return;
+                    foreach (var kv in retry)
+                        if (!_pendingFiles.ContainsKey(kv.Key)) _pendingFiles[kv.Key] = kv.Value;
+                    _settleTimer.Change(RetryMs, Timeout.Infinite);
+                }
+            }
+
+            var handler = AlbumChanged;
+            if (changed && handler != null) handler();
+        }
+
+        // A copy in progress is either empty or still open for writing
+        private static bool IsComplete(string path)
+        {
+            try
+            {
+                using (var fs = new FileStream(path, FileMode.Open, FileAccess.Read, FileShare.Read))
+                {
+                    return fs.Length > 0;
+                }
+            }
+            catch (IOException)
+            {
+                return false;
+            }
+            catch (UnauthorizedAccessException)
+            {
+                return false;
+            }
+        }
+
+        private bool AddOrUpdatePath(string path)
+        {
+            lock (_lock)
+            {
+                int i = _paths.BinarySearch(path, StringComparer.OrdinalIgnoreCase);
+                if (i < 0) _paths.Insert(~i, path);
+
+                // New content: drop the old decode (unless on screen) and retry failures
+                Entry e;
+                if (_cache.TryGetValue(path, out e) && e.Pins == 0) Evict(path);
+                _failed.Remove(path);
+                _warmIndex = 0;
+                Monitor.Pulse(_lock);
+                return true;
+            }
+        }
+
+        private bool RemovePath(string path)
+        {
+            lock (_lock)
+            {
+                int i = _paths.BinarySearch(path, StringComparer.OrdinalIgnoreCase);
+                if (i < 0) return false;
+                _paths.RemoveAt(i);
+                _demand.Remove(path);
+                _prefetch.Remove(path);
+                _failed.Remove(path);
+
+                Entry e;
+                if (_cache.TryGetValue(path, out e) && e.Pins == 0) Evict(path);
+                if (_warmIndex > i) _warmIndex--;
+                return true;
+            }
+        }
+
+        // ------------------ Cache internals (call under _lock) ------------------
+        private void Touch(Entry e)
+        {
+            _lru.Remove(e.Lru);
+            _lru.AddFirst(e.Lru);
+        }
+
+        private void Enqueue(string path, bool urgent)
+        {
+            if (_cache.ContainsKey(path) || _failed.Contains(path) || _demand.Contains(path)) return;
+
+            if (urgent)
+            {
+                _prefetch.Remove(path);
+                _demand.AddFirst(path);
+            }
+            else if (!_prefetch.Contains(path))
+            {
+                _prefetch.AddLast(path);
+            }
+            Monitor.Pulse(_lock);
+        }
+
+        // Drops unpinned images, oldest first. The most recent entry always
+        // stays, so one photo larger than the whole budget still shows.
+        private void EvictOverBudget()
+        {
+            var node = _lru.Last;
+            while (_cachedBytes > _budgetBytes && node != null && node != _lru.First)
+            {
+                var prev = node.Previous;
+                var e = _cache[node.Value];
+                if (e.Pins == 0) Evict(node.Value);
+                node = prev;
+            }
+        }
+
+        private void Evict(string path)
+        {
+            var e = _cache[path];
+            _lru.Remove(e.Lru);
+            _cache.Remove(path);
+            _cachedBytes -= e.Bytes;
+            e.Image.Dispose();
+        }
+
+        // ------------------ Worker ------------------
+        private void DecodeLoop()
+        {
+            while (true)
+            {
+                string path;
+                Size target;
+                bool warmOnly, urgent = false, passDone = false;
+                lock (_lock)
+                {
+                    while (_demand.Count == 0 && _prefetch.Count == 0 && !CanWarm() && !_disposed) Monitor.Wait(_lock);
+                    if (_disposed) return;
+                    target = _target;
+
+                    warmOnly = _demand.Count == 0 && _prefetch.Count == 0;
+                    if (warmOnly)
+                    {
+                        path = _paths[_warmIndex++];
+                        passDone = _warmIndex == _paths.Count;
+                    }
+                    else
+                    {
+                        urgent = _demand.Count > 0;
+                        var next = urgent ? _demand : _prefetch;
+                        path = next.First.Value;
+                        next.RemoveFirst();
+                        if (_cache.ContainsKey(path)) continue;
+                    }
+                }
+
+                if (warmOnly)
+                {
+                    // Idle: build one missing disk entry, don't keep it in memory
+                    _disk.EnsureBuilt(path, target);
+                    if (passDone) _disk.Trim();
+                    continue;
+                }
+
+                Image img = Decode(path, target);
+
+                lock (_lock)
+                {
+                    if (_disposed)
+                    {
+                        if (img != null) img.Dispose();
+                        return;
+                    }
+                    if (img == null)
+                    {
+                        _failed.Add(path);
+                    }
+                    else if (target != _target || _cache.ContainsKey(path))
+                    {
+                        img.Dispose();   // size changed meanwhile, or decoded twice
+                        // Someone is waiting on it: decode again at the new size
+                        if (urgent && !_cache.ContainsKey(path) && !_demand.Contains(path)) _demand.AddFirst(path);
+                        continue;
+                    }
+                    else
+                    {
+                        var e = new Entry
+                        {
+                            Image = img,
+                            Bytes = (long)img.Width * img.Height * 4,
+                            Lru = _lru.AddFirst(path)
+                        };
+                        _cache[path] = e;
+                        _cachedBytes += e.Bytes;
+                        EvictOverBudget();
+                    }
+                }
+
+                var handler = img != null ? Decoded : DecodeFailed;
+                if (handler != null) handler(path);
+            }
+        }
+
+        private bool CanWarm()
+        {
+            return _disk != null && _warmIndex < _paths.Count;
+        }
+
+        private Image Decode(string path, Size target)
+        {
+            try
+            {
+                if (_disk != null) return _disk.Load(path, target);
+                using (var fs = File.OpenRead(path))   // stream, so the file isn't locked
+                using (var src = Image.FromStream(fs, false, false))
+                {
+                    return ScaledImageCache.ScaleToFit(src, target);
+                }
+            }
+            catch (Exception)
+            {
+                // unreadable / not an image: skip it
+                return null;
+            }
+        }
+    }
+}
@@ -0,0 +1,210 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+using System;
+using System.Drawing;
+using System.Drawing.Drawing2D;
+using System.Drawing.Imaging;
+using System.IO;
+using System.Linq;
+using System.Security.Cryptography;
+using System.Text;
+
+namespace PhotoApp
+{
+    /// <summary>
+    /// On-disk cache of photos pre-scaled to the slideshow size. An entry
+    /// is named by a hash of the source path, its length and last-write
+    /// time, and the target size. Editing or replacing a photo therefore
+    /// misses the old entry, and stale files age out in <see cref="Trim"/>.
+    /// Safe to use from several threads.
+    /// </summary>
+    internal sealed class ScaledImageCache
+    {
+        private readonly string _dir;
+        private readonly long _maxBytes;
+
+        public ScaledImageCache(string dir, long maxBytes)
+        {
+            _dir = dir;
+            _maxBytes = maxBytes;
+            Directory.CreateDirectory(dir);
+        }
+
+        public static string DefaultFolder
+        {
+            get
+            {
+                return Path.Combine(
+                    Environment.GetFolderPath(Environment.SpecialFolder.LocalApplicationData),
+                    "RemindME", "ScaledPhotos");
+            }
+        }
+
+        /// <summary>Scaled photo from the cache, building the entry on a miss.</summary>
+        public Bitmap Load(string source, Size target)
+        {
+            string entry = EntryPath(source, target);
+            if (entry != null && File.Exists(entry))
+            {
+                try
+                {
+                    return DecodeCopy(entry);
+                }
+                catch (Exception)
+                {
+                    // torn or corrupt entry: delete it so the rebuild below replaces it
+                    try { File.Delete(entry); } catch (Exception) { }
+                }
+            }
+
+            Bitmap scaled;
+            using (var fs = File.OpenRead(source))
+            using (var src = Image.FromStream(fs, false, false))
+            {
+                scaled = ScaleToFit(src, target);
+            }
+            if (entry != null) Save(scaled, entry, source);
+            return scaled;
+        }
+
+        /// <summary>Builds the entry if it is missing, without keeping the image.</summary>
+        public void EnsureBuilt(string source, Size target)
+        {
+            string entry = EntryPath(source, target);
+            if (entry == null || File.Exists(entry)) return;
+            try
+            {
+                using (Load(source, target)) { }
+            }
+            catch (Exception)
+            {
+                // unreadable source: nothing to cache
+            }
+        }
+
+        /// <summary>Deletes the oldest entries until the folder fits the size cap.</summary>
+        public void Trim()
+        {
+            try
+            {
+                var files = new DirectoryInfo(_dir).GetFiles()
+                    .OrderByDescending(f => f.LastWriteTimeUtc)
+                    .ToArray();
+                long total = 0;
+                foreach (var f in files)
+                {
+                    total += f.Length;
+                    if (total > _maxBytes || f.Extension == ".tmp") f.Delete();
+                }
+            }
+            catch (IOException) { }
+            catch (UnauthorizedAccessException) { }
+        }
+
+        /// <summary>
+        /// Same fit as PictureBoxSizeMode.Zoom, done once here instead of on
+        /// every paint. Never upscales: a small photo is stored as it is and
+        /// the Zoom surface enlarges it. 32bppPArgb is GDI+'s fastest format to draw.
+        /// </summary>
+        public static Bitmap ScaleToFit(Image src, Size target)
+        {
+            double scale = Math.Min(1.0, Math.Min(
+                (double)target.Width / src.Width, (double)target.Height / src.Height));
+            int w = Math.Max(1, (int)Math.Round(src.Width * scale));
+            int h = Math.Max(1, (int)Math.Round(src.Height * scale));
+
+            var dst = new Bitmap(w, h, PixelFormat.Format32bppPArgb);
+            using (var g = Graphics.FromImage(dst))
+            {
+                g.InterpolationMode = InterpolationMode.HighQualityBicubic;
+                g.PixelOffsetMode = PixelOffsetMode.HighQuality;
+                g.CompositingQuality = CompositingQuality.HighQuality;
+                g.DrawImage(src, new Rectangle(0, 0, w, h));
+            }
+            return dst;
+        }
+
+        private string EntryPath(string source, Size target)
+        {
+            FileInfo info;
+            try
+            {
+                info = new FileInfo(source);
+                if (!info.Exists) return null;
+            }
+            catch (Exception)
+            {
+                return null;
+            }
+
+            string key = string.Join("|",
+                info.FullName.ToUpperInvariant(),
+                info.Length,
+                info.LastWriteTimeUtc.Ticks,
+                target.Width, target.Height);
+
+            byte[] hash;
+            using (var sha = SHA1.Create())
+            {
+                hash = sha.ComputeHash(Encoding.UTF8.GetBytes(key));
+            }
+            var sb = new StringBuilder(hash.Length * 2 + 4);
+            foreach (byte b in hash) sb.Append(b.ToString("x2"));
+            sb.Append(IsPng(source) ? ".png" : ".jpg");
+            return Path.Combine(_dir, sb.ToString());
+        }
+
+        private static bool IsPng(string path)
+        {
+            return path.EndsWith(".png", StringComparison.OrdinalIgnoreCase);
+        }
+
+        // Loads into memory and copies so the cache file is not left locked
+        private static Bitmap DecodeCopy(string file)
+        {
+            using (var ms = new MemoryStream(File.ReadAllBytes(file)))
+            using (var src = Image.FromStream(ms, false, false))
+            {
+                var bmp = new Bitmap(src.Width, src.Height, PixelFormat.Format32bppPArgb);
+                using (var g = Graphics.FromImage(bmp))
+                {
+                    g.DrawImageUnscaled(src, 0, 0);
+                }
+                return bmp;
+            }
+        }
+
+        // Write to a temp file and rename so readers never see half an entry
+        private static void Save(Bitmap bmp, string entry, string source)
+        {
+            string tmp = entry + "." + Guid.NewGuid().ToString("N") + ".tmp";
+            try
+            {
+                if (IsPng(source))
+                {
+                    bmp.Save(tmp, ImageFormat.Png);
+                }
+                else
+                {
+                    var jpeg = ImageCodecInfo.GetImageEncoders().First(c => c.FormatID == ImageFormat.Jpeg.Guid);
+                    using (var args = new EncoderParameters(1))
+                    {
+                        args.Param[0] = new EncoderParameter(System.Drawing.Imaging.Encoder.Quality, 90L);
+                        bmp.Save(tmp, jpeg, args);
+                    }
+                }
+                if (!File.Exists(entry)) File.Move(tmp, entry);
+            }
+            catch (Exception)
+            {
+                // cache is best effort; the scaled bitmap is still returned
+            }
+            finally
+            {
+                try { if (File.Exists(tmp)) File.Delete(tmp); } catch (Exception) { }
+            }
+        }
+    }
+}
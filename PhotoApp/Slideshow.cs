@@ -0,0 +1,261 @@
+/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+using System;
+using System.Drawing;
+using System.Windows.Forms;
+using PhotoApp.Core;
+
+namespace PhotoApp
+{
+    /// <summary>
+    /// One device's slideshow on one PictureBox. Photos come from a
+    /// shared album (<see cref="PhotoLibrary.Lease"/>), arrive pre-scaled
+    /// and stay pinned while on screen. A photo that is still decoding is
+    /// shown as soon as the store delivers it; until then the last frame
+    /// stays up. Also closes the arrival's <see cref="LatencyTrace"/> on
+    /// the first paint. UI thread only, apart from the store's events,
+    /// which are marshalled onto it.
+    /// <see cref="Prewarm"/> gets the first slides ready while the cube is
+    /// still on its way, so <see cref="Start"/> can show the first photo at once.
+    /// </summary>
+    internal sealed class Slideshow : IDisposable
+    {
+        private const int PrefetchAhead = 2;
+        private const int SlideMs = 5000;
+        private const int ResizeSettleMs = 300;   // a drag settles before the album rescales
+
+        private readonly PictureBox _surface;
+        private readonly PhotoLibrary.Lease _album;
+        private readonly PhotoStore _photos;
+        private readonly Timer _slideTimer = new Timer();   // advances photos
+        private readonly Timer _resizeTimer = new Timer();  // applies the size once resizing stops
+        private int _imgIdx = 0;
+        private string _shownPath;     // pinned in _photos while on screen
+        private string _pendingPath;   // wanted on screen, still decoding
+        private bool _running;
+        private bool _disposed;
+        private LatencyTrace _arrival;   // arrival waiting for its first paint
+        private string _warmPath;        // first slide, wanted ahead of an expected arrival
+        private bool _warmPinned;        // ...and decoded, held by our own pin
+
+        public Slideshow(PictureBox surface, PhotoLibrary.Lease album)
+        {
+            _surface = surface;
+            _album = album;
+            _photos = album.Store;
+
+            _surface.SizeMode = PictureBoxSizeMode.Zoom;   // fills the surface, up or down
+            _surface.BackColor = Color.Black;
+            _surface.Paint += Surface_Paint;
+            _surface.SizeChanged += Surface_SizeChanged;
+            _album.TargetSize = _surface.ClientSize;
+
+            _slideTimer.Interval = SlideMs;
+            _slideTimer.Tick += (s, e) => AdvancePhoto();
+            _resizeTimer.Interval = ResizeSettleMs;
+            _resizeTimer.Tick += (s, e) => ApplySize();
+
+            _photos.Decoded += Photos_Decoded;
+            _photos.DecodeFailed += Photos_DecodeFailed;
+            _photos.AlbumChanged += Photos_AlbumChanged;
+            _photos.Prefetch(_photos.Count - 1, PrefetchAhead); // first slides ready before the cube arrives
+        }
+
+        /// <summary>Raised after the first paint of an arrival's photo, with its completed trace.</summary>
+        public event Action<LatencyTrace> ArrivalShown;
+
+        public bool IsRunning { get { return _running; } }
+
+        /// <summary>
+        /// Starts from the first photo. <paramref name="arrival"/> (may be
+        /// null) is timed to its first paint; ignored if already running.
+        /// </summary>
+        public void Start(LatencyTrace arrival)
+        {
+            if (_running || _disposed) return;
+            _running = true;
+            _arrival = arrival;
+            _slideTimer.Start();   // keeps running on an empty album; photos may arrive later
+
+            _imgIdx = 0;
+            string first = _photos.PathAt(_imgIdx);
+            if (arrival != null) arrival.Prewarmed = _warmPinned && first == _warmPath;
+            ShowPhoto(first); // show immediately (or as soon as decoded)
+            CancelPrewarm();   // the screen holds its own pin now
+        }
+
+        /// <summary>
+        /// The cube looks like it is coming. Queues the first slides for
+        /// decoding ahead of everything else and pins the first once it is
+        /// ready. Does nothing while running.
+        /// </summary>
+        public void Prewarm()
+        {
+            if (_running || _disposed || _warmPath != null) return;
+            _warmPath = _photos.PathAt(0);
+            if (_warmPath == null) return;
+
+            _warmPinned = _photos.Acquire(_warmPath) != null;   // else pinned in OnPhotoDecoded
+            _photos.Prefetch(0, PrefetchAhead);
+            if (!_surface.IsHandleCreated) _surface.CreateControl();
+        }
+
+        /// <summary>The approach came to nothing: lets go of the first slide. Cheap.</summary>
+        public void CancelPrewarm()
+        {
+            if (_warmPinned) _photos.Release(_warmPath);
+            _warmPath = null;
+            _warmPinned = false;
+        }
+
+        public void Stop()
+        {
+            if (!_running) return;
+            _running = false;
+            _slideTimer.Stop();
+            _pendingPath = null;
+            _arrival = null;   // cube left before its photo made it to the screen
+            // Do NOT clear image here—keeps last frame, avoids blanks.
+        }
+
+        /// <summary>Blanks the surface.</summary>
+        public void Clear()
+        {
+            ShowPhoto(null);
+        }
+
+        public void Dispose()
+        {
+            if (_disposed) return;
+            Stop();
+            CancelPrewarm();
+            _disposed = true;
+            _photos.Decoded -= Photos_Decoded;
+            _photos.DecodeFailed -= Photos_DecodeFailed;
+            _photos.AlbumChanged -= Photos_AlbumChanged;
+            _surface.Paint -= Surface_Paint;
+            _surface.SizeChanged -= Surface_SizeChanged;
+            _slideTimer.Dispose();
+            _resizeTimer.Dispose();
+            SetShownPhoto(null, null);
+            _album.Dispose();
+        }
+
+        private void AdvancePhoto()
+        {
+            if (_photos.Count == 0) return;
+            _imgIdx = (_imgIdx + 1) % _photos.Count;
+            ShowPhoto(_photos.PathAt(_imgIdx));
+        }
+
+        // Puts a photo on screen if it is decoded, otherwise keeps the current
+        // frame until OnPhotoDecoded delivers it. Always queues the next slides.
+        private void ShowPhoto(string path)
+        {
+            _pendingPath = null;
+            if (path == null)
+            {
+                SetShownPhoto(null, null);
+                return;
+            }
+
+            var img = _photos.Acquire(path);
+            if (img != null) SetShownPhoto(path, img);
+            else _pendingPath = path;
+
+            _photos.Prefetch(_imgIdx, PrefetchAhead);
+        }
+
+        private void SetShownPhoto(string path, Image img)
+        {
+            if (!_surface.IsDisposed) _surface.Image = img;
+            if (img != null && _arrival != null && _arrival.ShownHostUs < 0)
+                _arrival.ShownHostUs = ClockSync.HostMicrosNow();
+            _photos.Release(_shownPath);
+            _shownPath = path;
+        }
+
+        // A new target size drops the album's scaled images and restarts its
+        // disk-cache pass, so dragging an edge only zooms what is on screen;
+        // the album follows once the size has been still for ResizeSettleMs
+        private void Surface_SizeChanged(object sender, EventArgs e)
+        {
+            _resizeTimer.Stop();
+            _resizeTimer.Start();
+        }
+
+        private void ApplySize()
+        {
+            _resizeTimer.Stop();
+            if (!_disposed) _album.TargetSize = _surface.ClientSize;
+        }
+
+        // Closes the latency trace once the first photo is actually on screen
+        private void Surface_Paint(object sender, PaintEventArgs e)
+        {
+            if (_arrival == null || _arrival.ShownHostUs < 0) return;
+            _arrival.PaintedHostUs = ClockSync.HostMicrosNow();
+            var trace = _arrival;
+            _arrival = null;
+
+            var handler = ArrivalShown;
+            if (handler != null) handler(trace);
+        }
+
+        // Decode worker thread
+        private void Photos_Decoded(string path)
+        {
+            Post(() => OnPhotoDecoded(path));
+        }
+
+        private void OnPhotoDecoded(string path)
+        {
+            if (_disposed) return;
+            if (path == _warmPath && !_warmPinned) _warmPinned = _photos.Acquire(path) != null;
+            if (path == _pendingPath) ShowPhoto(path);
+        }
+
+        // Decode worker thread
+        private void Photos_DecodeFailed(string path)
+        {
+            Post(() => OnPhotoFailed(path));
+        }
+
+        // An unreadable photo: go straight on to the next one, which gets a full slide
+        private void OnPhotoFailed(string path)
+        {
+            if (_disposed || !_running || path != _pendingPath) return;
+            _slideTimer.Stop();
+            _slideTimer.Start();
+            AdvancePhoto();
+        }
+
+        // Folder watcher (pool thread)
+        private void Photos_AlbumChanged()
+        {
+            Post(OnAlbumChanged);
+        }
+
+        // The slideshow keeps going; only fill the screen if it was waiting on an empty album
+        private void OnAlbumChanged()
+        {
+            if (_disposed || !_running) return;
+            if (_shownPath == null && _pendingPath == null && _photos.Count > 0)
+                ShowPhoto(_photos.PathAt(_imgIdx));
+        }
+
+        private void Post(Action action)
+        {
+            try
+            {
+                if (!_disposed && _surface.IsHandleCreated) _surface.BeginInvoke(action);
+            }
+            catch (InvalidOperationException)
+            {
+                // surface is closing
+            }
+        }
+    }
+}
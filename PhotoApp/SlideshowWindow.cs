@@ -0,0 +1,38 @@
+﻿/*
+ * Company:  University of Canterbury COSC439 Group5
+ */
+
+using System.Drawing;
+using System.Windows.Forms;
+
+namespace PhotoApp
+{
+    /// <summary>
+    /// Output surface for a device beyond the first, which uses the main
+    /// window's picture box. The n-th one opens on the n-th screen when
+    /// there are several, so each cube's table can face its own display.
+    /// </summary>
+    internal sealed class SlideshowWindow : Form
+    {
+        public SlideshowWindow(string deviceName, int index)
+        {
+            Text = "RemindME Photos — " + deviceName;
+            BackColor = Color.Black;
+            DoubleBuffered = true;
+            ClientSize = new Size(800, 600);
+
+            Screen[] screens = Screen.AllScreens;
+            if (screens.Length > 1)
+            {
+                Rectangle area = screens[index % screens.Length].WorkingArea;
+                StartPosition = FormStartPosition.Manual;
+                Location = new Point(area.Left + 40, area.Top + 40);
+            }
+
+            Surface = new PictureBox { Dock = DockStyle.Fill };
+            Controls.Add(Surface);
+        }
+
+        public PictureBox Surface { get; private set; }
+    }
+}
@@ -0,0 +1,211 @@
+/*
+ * File:     board.h
+ * Company:  University of Canterbury Group 5
+ */
+
+// ================================================================
+// Board description: every button/LED pair, sensor and strip as a
+// constant table. firmware.c sizes its arrays and loops from these
+// tables, so a board with more keys is a new table, not new code.
+//
+// Buttons and LEDs go through one of two interchangeable Io backends
+// (same members, picked at compile time):
+//   DirectIo    one pin per button and LED (the EchoMe board)
+//   ShiftIo     74HC165 button chain + 74HC595 LED chain on the SPI
+//               bus; all buttons are read and all LEDs written in a
+//               single burst of (keys + 7) / 8 bytes, so a 24-key
+//               board scans as fast as an 8-key one
+// Each provides begin(), readButtons() (bit i = key i pressed),
+// setLed(i, on), setLeds(mask) and EDGE_INTERRUPTS, which says whether
+// the button pins can raise pin-change interrupts (needed for LAT?).
+// tools/hostsim replays recordings through either one: through its pins
+// for DirectIo, through an SPI stand-in for ShiftIo.
+//
+// Build with -DBOARD_XL for the 16-key variant on shift registers.
+// ================================================================
+
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <Arduino.h>
+
+#ifdef BOARD_XL
+#define BOARD_SHIFT_IO
+#endif
+
+#ifdef BOARD_SHIFT_IO
+#include <SPI.h>
+#endif
+
+namespace board {
+
+struct Key {
+  uint8_t button;   // input pin, active-low (ShiftIo: unused, chain order)
+  uint8_t led;      // output pin (ShiftIo: unused, chain order)
+  uint16_t hz;      // note it plays
+};
+
+enum Effect : uint8_t {
+  EFFECT_BREATHE,   // slow colour pulse while the sensor sees something
+  EFFECT_RAINBOW    // static rainbow while the sensor sees something
+};
+
+// HC-SR04 style sensor; trig == echo for single-pin (SIG) modules.
+// The strip at index `strip` shows `effect` while the sensor reads
+// more than the threshold. Sensor 0 is "A" in the distance line.
+struct Sensor {
+  uint8_t trig;
+  uint8_t echo;
+  uint8_t strip;
+  Effect effect;
+};
+
+struct Strip {
+  uint8_t pin;
+  uint8_t count;
+};
+
+#ifndef BOARD_XL
+// --- EchoMe: six keys wired straight to the Nano ---
+constexpr Key KEYS[] = {
+  {12, 11, 262},   // C
+  {10,  9, 294},   // D
+  { 8,  5, 330},   // E
+  { 4, A0, 349},   // F
+  {A1, A2, 392},   // G
+  {A3, A4, 440},   // A
+};
+constexpr Sensor SENSORS[] = {
+  {3, 3, 0, EFFECT_BREATHE},
+  {6, 7, 1, EFFECT_RAINBOW},
+};
+constexpr Strip STRIPS[] = {
+  {13, 5},
+  { 2, 5},
+};
+#else
+// --- EchoMe XL: two octaves of C major on shift registers ---
+// SCK D13, MISO D12 (165 QH), MOSI D11 (595 SER); strip A moves off D13
+constexpr Key KEYS[] = {
+  {0, 0, 262}, {0, 0, 294}, {0, 0, 330}, {0, 0, 349},
+  {0, 0, 392}, {0, 0, 440}, {0, 0, 494}, {0, 0, 523},
+  {0, 0, 587}, {0, 0, 659}, {0, 0, 698}, {0, 0, 784},
+  {0, 0, 880}, {0, 0, 988}, {0, 0, 1047}, {0, 0, 1175},
+};
+constexpr Sensor SENSORS[] = {
+  {3, 3, 0, EFFECT_BREATHE},
+  {6, 7, 1, EFFECT_RAINBOW},
+};
+constexpr Strip STRIPS[] = {
+  {5, 8},
+  {2, 8},
+};
+const uint8_t SHIFT_LOAD_PIN = 8;    // 74HC165 SH/LD, low pulse latches the buttons
+const uint8_t SHIFT_LATCH_PIN = 10;  // 74HC595 RCLK, rising edge shows the LEDs
+#endif
+
+const uint8_t SPEAKER_PIN = A5;
+const uint8_t PRESENCE_SENSOR = 1;   // "B" in the distance line; t= is its trigger time
+
+const uint8_t NUM_KEYS = sizeof(KEYS) / sizeof(KEYS[0]);
+const uint8_t NUM_SENSORS = sizeof(SENSORS) / sizeof(SENSORS[0]);
+const uint8_t NUM_STRIPS = sizeof(STRIPS) / sizeof(STRIPS[0]);
+static_assert(NUM_KEYS <= 32, "key masks are at most 32 bits");
+static_assert(PRESENCE_SENSOR < NUM_SENSORS, "presence sensor out of range");
+
+// Smallest unsigned type with a bit per key
+template <uint8_t Bits> struct MaskFor { typedef uint32_t type; };
+template <> struct MaskFor<1> { typedef uint8_t type; };
+template <> struct MaskFor<2> { typedef uint16_t type; };
+typedef MaskFor<(NUM_KEYS + 7) / 8>::type Mask;
+const uint8_t MASK_BYTES = (NUM_KEYS + 7) / 8;
+
+inline Mask keyBit(uint8_t i) { return (Mask)1 << i; }
+
+class DirectIo {
+public:
+  static const bool EDGE_INTERRUPTS = true;
+
+  void begin() {
+    for (uint8_t i = 0; i < NUM_KEYS; i++) {
+      pinMode(KEYS[i].button, INPUT_PULLUP);
+      pinMode(KEYS[i].led, OUTPUT);
+    }
+  }
+
+  Mask readButtons() {
+    Mask m = 0;
+    for (uint8_t i = 0; i < NUM_KEYS; i++) {
+      if (digitalRead(KEYS[i].button) == LOW) m |= keyBit(i);
+    }
+    return m;
+  }
+
+  void setLed(uint8_t i, bool on) { digitalWrite(KEYS[i].led, on ? HIGH : LOW); }
+
+  void setLeds(Mask on) {
+    for (uint8_t i = 0; i < NUM_KEYS; i++) setLed(i, (on & keyBit(i)) != 0);
+  }
+};
+
+#ifdef BOARD_SHIFT_IO
+// Chip 0 (keys 0-7) sits next to the Nano in both chains. LED writes
+// only go out when something changed; each one also refreshes the
+// button latch, which costs nothing extra.
+class ShiftIo {
+public:
+  static const bool EDGE_INTERRUPTS = false;   // the chain has no per-key interrupt
+
+  void begin() {
+    pinMode(SHIFT_LOAD_PIN, OUTPUT);
+    digitalWrite(SHIFT_LOAD_PIN, HIGH);
+    pinMode(SHIFT_LATCH_PIN, OUTPUT);
+    digitalWrite(SHIFT_LATCH_PIN, LOW);
+    SPI.begin();
+    leds_ = 0;
+    transfer();
+  }
+
+  Mask readButtons() { return transfer(); }
+
+  void setLed(uint8_t i, bool on) { setLeds(on ? leds_ | keyBit(i) : leds_ & ~keyBit(i)); }
+
+  void setLeds(Mask on) {
+    if (on == leds_) return;
+    leds_ = on;
+    transfer();
+  }
+
+private:
+  // Latches the buttons, then clocks the LED bytes out while the button
+  // bytes come in. The 595 chain wants its farthest chip's byte first,
+  // the 165 chain delivers its nearest chip's byte first.
+  Mask transfer() {
+    digitalWrite(SHIFT_LOAD_PIN, LOW);
+    digitalWrite(SHIFT_LOAD_PIN, HIGH);
+    SPI.beginTransaction(SPISettings(4000000, MSBFIRST, SPI_MODE0));
+    Mask in = 0;
+    for (uint8_t k = 0; k < MASK_BYTES; k++) {
+      uint8_t out = (uint8_t)(leds_ >> (8 * (MASK_BYTES - 1 - k)));
+      uint8_t got = SPI.transfer(out);
+      in |= (Mask)(uint8_t)~got << (8 * k);   // buttons pull low
+    }
+    SPI.endTransaction();
+    digitalWrite(SHIFT_LATCH_PIN, HIGH);
+    digitalWrite(SHIFT_LATCH_PIN, LOW);
+    return in & (Mask)(((uint32_t)1 << (NUM_KEYS - 1) << 1) - 1);
+  }
+
+  Mask leds_ = 0;
+};
+#endif
+
+#ifdef BOARD_SHIFT_IO
+typedef ShiftIo Io;
+#else
+typedef DirectIo Io;
+#endif
+
+}  // namespace board
+
+#endif  // BOARD_H
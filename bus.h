@@ -0,0 +1,88 @@
+/*
+ * File:     bus.h
+ * Company:  University of Canterbury Group 5
+ */
+
+// ================================================================
+// Publish/subscribe between the sketch's subsystems, wired at compile
+// time.
+//
+// A producer publishes a small POD event into a fixed ring and carries
+// on; dispatch() later hands each queued event to every subscriber in
+// the list, in list order. The list is a template parameter pack, so
+// there is no table of function pointers and nothing is registered at
+// run time: delivery expands to one inline call per subscriber, guarded
+// by a topic mask that the compiler folds to a constant. A new reaction
+// is a new type in the list; the producer does not change.
+//
+// Event must be a POD with a `uint8_t topic` member (below 16).
+// Subscribers provide:
+//   static const uint16_t TOPICS = bus::topics(...);  // what they want
+//   static void on(const Event &e);
+//
+// Main loop only: publish() and dispatch() are not for interrupts.
+// A full ring is drained before the next event goes in, so nothing is
+// dropped; maxDepth() shows how close the ring has come to that.
+// ================================================================
+
+#ifndef BUS_H
+#define BUS_H
+
+#include <stdint.h>
+
+namespace bus {
+
+constexpr uint16_t topics() { return 0; }
+
+// bus::topics(A, B, ...) -> mask with a bit per topic
+template <class... More>
+constexpr uint16_t topics(uint8_t first, More... more) {
+  return (uint16_t)((1u << first) | topics(more...));
+}
+
+template <class Event, class... Subscribers>
+struct Deliver {
+  static void to(const Event &) {}
+};
+
+template <class Event, class First, class... Rest>
+struct Deliver<Event, First, Rest...> {
+  static void to(const Event &e) {
+    if (First::TOPICS & (1u << e.topic)) First::on(e);
+    Deliver<Event, Rest...>::to(e);
+  }
+};
+
+template <class Event, uint8_t CAPACITY, class... Subscribers>
+class Bus {
+public:
+  static_assert(CAPACITY && !(CAPACITY & (CAPACITY - 1)), "capacity must be a power of two");
+
+  void publish(const Event &e) {
+    if (count_ == CAPACITY) dispatch();
+    ring_[(uint8_t)(head_ + count_) & (CAPACITY - 1)] = e;
+    if (++count_ > maxDepth_) maxDepth_ = count_;
+  }
+
+  // Delivers everything queued, including events published on the way
+  void dispatch() {
+    while (count_) {
+      Event e = ring_[head_];
+      head_ = (head_ + 1) & (CAPACITY - 1);
+      count_--;
+      Deliver<Event, Subscribers...>::to(e);
+    }
+  }
+
+  uint8_t maxDepth() const { return maxDepth_; }
+
+private:
+  Event ring_[CAPACITY];
+  uint8_t head_ = 0;
+  uint8_t count_ = 0;
+  uint8_t maxDepth_ = 0;
+};
+
+}  // namespace bus
+
+#endif  // BUS_H
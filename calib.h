@@ -0,0 +1,197 @@
+/*
+ * File:     calib.h
+ * Company:  University of Canterbury Group 5
+ */
+
+// ================================================================
+// Per-sensor presence thresholds from the sensor's own empty reading.
+//
+// Mounting, cube size and reflections inside the enclosure move the
+// empty-state distance by centimetres between units, so one global
+// threshold left some boards triggering all the time and others never.
+// A calibration run averages SAMPLES readings with nothing on the
+// sensor: the mean is the baseline, the standard deviation the noise.
+// The cube counts as present at or below onMm and as gone above offMm:
+//
+//   onMm  = min(DEFAULT_ON_MM, baseMm - max(MIN_GAP_MM, GAP_NOISE * noise))
+//   offMm = onMm + max(MIN_HYST_MM, HYST_NOISE * noise)
+//
+// A cube on the sensor reads the same on every board, so a long mount
+// keeps DEFAULT_ON_MM and only a short one pulls onMm in. offMm has to
+// stay below baseMm - noise; where it would not, both move down so the
+// band keeps its width (only a mount too short for the band narrows it).
+//
+// Everything is whole millimetres. While the sensor is clear and reads
+// close to its baseline, an exponential average (1/2^DRIFT_SHIFT per
+// sample, one add and one shift) follows temperature and slow mounting
+// drift and moves the thresholds with it. Without a baseline (nothing
+// calibrated, or no echo when empty) the thresholds are DEFAULT_ON_MM /
+// DEFAULT_OFF_MM. Storage (EEPROM) and reporting are left to the sketch.
+// ================================================================
+
+#ifndef CALIB_H
+#define CALIB_H
+
+#include <stdint.h>
+#include <math.h>
+
+namespace calib {
+
+const uint16_t NO_ECHO = 0xFFFF;
+const uint8_t SAMPLES = 32;              // about 2.5 s at the loop() rate
+
+const uint16_t DEFAULT_ON_MM = 30;       // the old global 3.0 cm; a cube on the sensor reads less
+const uint16_t DEFAULT_OFF_MM = 35;
+const uint16_t MIN_GAP_MM = 5;
+const uint8_t GAP_NOISE = 4;
+const uint16_t MIN_HYST_MM = 5;
+const uint8_t HYST_NOISE = 2;
+const uint16_t MAX_NOISE_MM = 15;        // noisier: something moved, keep the old one
+const uint16_t DRIFT_WINDOW_MM = 10;     // only readings this close to the baseline
+const uint8_t DRIFT_SHIFT = 8;           // ~17 s time constant at 15 samples/s
+
+// Where the current baseline came from
+enum Source : uint8_t {
+  SRC_DEFAULT = 0,   // none: default thresholds
+  SRC_SAVED,         // stored by an earlier run
+  SRC_BOOT,          // measured at power-up
+  SRC_COMMAND        // measured on request (CAL)
+};
+
+inline const char *sourceName(Source src) {
+  static const char *const NAMES[] = {"default", "saved", "boot", "command"};
+  return NAMES[src];
+}
+
+// What the sketch stores; baseMm 0 = no echo when empty
+struct Baseline {
+  uint16_t baseMm;
+  uint16_t noiseMm;
+};
+
+enum Result : uint8_t {
+  RESULT_NONE = 0,
+  RESULT_CALIBRATED,   // a run finished and its baseline is in use
+  RESULT_KEPT          // a run finished but looked wrong; old baseline kept
+};
+
+inline uint16_t toMm(float cm) {
+  return isnan(cm) ? NO_ECHO : (uint16_t)(cm * 10.0f + 0.5f);
+}
+
+class Sensor {
+public:
+  Baseline cal = {0, 0};
+  Source src = SRC_DEFAULT;
+  uint16_t onMm = DEFAULT_ON_MM;
+  uint16_t offMm = DEFAULT_OFF_MM;
+  bool present = false;
+
+  // Takes over a baseline (stored or measured) and its thresholds
+  void apply(const Baseline &b, Source from) {
+    cal = b;
+    src = from;
+    driftAcc_ = (uint32_t)b.baseMm << DRIFT_SHIFT;
+    derive();
+  }
+
+  // Starts a run over the next SAMPLES readings. A forced run (CAL)
+  // always takes the result; an unforced one (boot) refuses a baseline
+  // that the current thresholds would call present, since that is the
+  // cube sitting on the sensor at power-up.
+  void calibrate(bool forced) {
+    runLeft_ = SAMPLES;
+    forced_ = forced;
+    hits_ = 0;
+    sum_ = 0;
+    sumSq_ = 0;
+  }
+
+  bool calibrating() const { return runLeft_ > 0; }
+
+  // One reading in mm (NO_ECHO for none). Updates `present` and the
+  // drift estimate, and reports the end of a calibration run.
+  Result sample(uint16_t mm) {
+    if (mm != NO_ECHO) {
+      if (!present && mm <= onMm) present = true;
+      else if (present && mm > offMm) present = false;
+    }
+    if (runLeft_ > 0) return accumulate(mm);
+    if (mm != NO_ECHO && !present && cal.baseMm > 0 && mm > offMm &&
+        (mm > cal.baseMm ? mm - cal.baseMm : cal.baseMm - mm) <= DRIFT_WINDOW_MM) {
+      driftAcc_ -= driftAcc_ >> DRIFT_SHIFT;
+      driftAcc_ += mm;
+      uint16_t base = (uint16_t)((driftAcc_ + (1UL << (DRIFT_SHIFT - 1))) >> DRIFT_SHIFT);
+      if (base != cal.baseMm) {
+        cal.baseMm = base;
+        derive();
+      }
+    }
+    return RESULT_NONE;
+  }
+
+  // The baseline has wandered at least minMm from what was stored
+  bool driftedFrom(const Baseline &stored, uint16_t minMm) const {
+    uint16_t d = cal.baseMm > stored.baseMm ? cal.baseMm - stored.baseMm : stored.baseMm - cal.baseMm;
+    return d >= minMm;
+  }
+
+private:
+  uint32_t driftAcc_ = 0;   // baseline << DRIFT_SHIFT
+  uint32_t sum_ = 0;
+  uint32_t sumSq_ = 0;      // 32 x 5145^2 still fits
+  uint8_t runLeft_ = 0;
+  uint8_t hits_ = 0;
+  bool forced_ = false;
+
+  Result accumulate(uint16_t mm) {
+    if (mm != NO_ECHO) {
+      hits_++;
+      sum_ += mm;
+      sumSq_ += (uint32_t)mm * mm;
+    }
+    if (--runLeft_ > 0) return RESULT_NONE;
+
+    Baseline b = {0, 0};
+    if (hits_ > SAMPLES / 2) {   // mostly silent: nothing in range when empty
+      // Once per run, so float is fine (and keeps the fraction of the mean)
+      float mean = (float)sum_ / hits_;
+      float var = (float)sumSq_ / hits_ - mean * mean;
+      b.baseMm = (uint16_t)(mean + 0.5f);
+      b.noiseMm = var > 0 ? (uint16_t)(sqrtf(var) + 0.5f) : 0;
+    }
+    if (b.noiseMm > MAX_NOISE_MM) return RESULT_KEPT;
+    if (!forced_ && b.baseMm > 0 && b.baseMm <= onMm) return RESULT_KEPT;
+    apply(b, forced_ ? SRC_COMMAND : SRC_BOOT);
+    return RESULT_CALIBRATED;
+  }
+
+  void derive() {
+    if (cal.baseMm == 0) {
+      onMm = DEFAULT_ON_MM;
+      offMm = DEFAULT_OFF_MM;
+      return;
+    }
+    uint16_t gap = cal.noiseMm * GAP_NOISE;
+    if (gap < MIN_GAP_MM) gap = MIN_GAP_MM;
+    if (gap > cal.baseMm / 2) gap = cal.baseMm / 2;   // very short mount: halfway
+    onMm = cal.baseMm - gap;
+    if (onMm > DEFAULT_ON_MM) onMm = DEFAULT_ON_MM;
+
+    uint16_t hyst = cal.noiseMm * HYST_NOISE;
+    if (hyst < MIN_HYST_MM) hyst = MIN_HYST_MM;
+    offMm = onMm + hyst;
+    uint16_t ceiling = cal.baseMm > cal.noiseMm ? cal.baseMm - cal.noiseMm : 0;
+    if (offMm < ceiling) return;
+    if (ceiling > hyst + 1) {   // short mount: shift the band down whole
+      offMm = ceiling - 1;
+      onMm = offMm - hyst;
+    } else {                    // too short for the band: squeeze it
+      offMm = ceiling > onMm ? ceiling - 1 : onMm;
+    }
+  }
+};
+
+}  // namespace calib
+
+#endif  // CALIB_H
@@ -9,70 +9,96 @@
 // ================================================================
 // Ultrasonic A (single-pin SIG on D3) -> NeoPixel strip A on D13
 // Ultrasonic B (TRIG=D6, ECHO=D7)    -> NeoPixel strip B on D2
-// Buttons/LEDs (momentary, active-low):
-//   D12 -> D11
-//   D10 -> D9
-//   D8  -> D5
-//   D4  -> A0
-//   A1  -> A2
-//   A3  -> A4
-//   A5  -> A6
+// Buttons/LEDs (momentary, active-low): six pairs, speaker on A5.
+// The pin map lives in board.h.
 // ================================================================
  
 #include <Adafruit_NeoPixel.h>
+#include <EEPROM.h>
+#include <avr/wdt.h>
+#ifdef __AVR__
+#include <avr/boot.h>
+#endif
 #include <math.h>
+#include <string.h>
+#include "board.h"
+#include "bus.h"
+#include "calib.h"
+#include "game_fsm.h"
+#include "protocol.h"
+#include "synth.h"
  
-// Piano notes
-#define NOTE_C 262
-#define NOTE_D 294
-#define NOTE_E 330
-#define NOTE_F 349
-#define NOTE_G 392
-#define NOTE_A 440
- 
-const int trigEchoPinA = 3;
-const int trigPinB     = 6;
-const int echoPinB     = 7;
- 
-const int LED_PIN_A   = 13;
-const int LED_PIN_B   = 2;
-const int LED_COUNT_A = 5;
-const int LED_COUNT_B = 5;
- 
-Adafruit_NeoPixel stripA(LED_COUNT_A, LED_PIN_A, NEO_GRB + NEO_KHZ800);
-Adafruit_NeoPixel stripB(LED_COUNT_B, LED_PIN_B, NEO_GRB + NEO_KHZ800);
- 
-// --- Buttons & LEDs ---
-const int buttonPin1 = 12;  const int ledPin1 = 11;
-const int buttonPin2 = 10;  const int ledPin2 = 9;
-const int buttonPin3 = 8;   const int ledPin3 = 5;
-const int buttonPin4 = 4;   const int ledPin4 = A0;
-const int buttonPin5 = A1;  const int ledPin5 = A2;
-const int buttonPin6 = A3;  const int ledPin6 = A4;
-const int SPEAKER_PIN = A5;
- 
-// Fix array order (button1 = C, button6 = A)
-const int buttonPins[] = {buttonPin1, buttonPin2, buttonPin3, buttonPin4, buttonPin5, buttonPin6};
-const int ledPins[] = {ledPin1, ledPin2, ledPin3, ledPin4, ledPin5, ledPin6};
-const int notes[] = {NOTE_C, NOTE_D, NOTE_E, NOTE_F, NOTE_G, NOTE_A};
- 
-// Game variables
-int turn = 0;
-int inputSequence[100];
-int currentStep = 0;
-bool showingSequence = false;
-bool waitingForInput = false;
-unsigned long lastActionTime = 0;
-const unsigned long STEP_DELAY = 800;
+// Reported in the READY banner so the host can tell builds apart
+#define FIRMWARE_VERSION "1.5.0"
+ 
+using board::NUM_KEYS;
+using board::Mask;
+using board::keyBit;
+ 
+// Strips are configured from board::STRIPS in setup()
+Adafruit_NeoPixel strips[board::NUM_STRIPS];
+board::Io keys;   // buttons + their LEDs
+// A key's LED is lit while it is held and while the game (or the
+// intro) lights it; handleButtons() writes the union every pass
+Mask keysHeld = 0;    // last scan
+Mask ledsOwned = 0;   // lit by the game / intro
+ 
+void ownLeds(Mask owned) {
+  ledsOwned = owned;
+  keys.setLeds(keysHeld | ledsOwned);
+}
  
 // Predefined melody (1=C, 2=D, 3=E, 4=F, 5=G, 6=A)
 int melody[] = {3, 3, 4, 5, 5, 4, 3, 2, 1, 1, 2, 3, 3, 2, 2};
 int melodyLength = sizeof(melody) / sizeof(melody[0]);
  
+// Speaker voices (synth.h); notes are keyed by button index
+synth::Synth speaker;
+ISR(TIMER2_COMPA_vect) { speaker.render(); }
+
+// Game I/O for the state machine in game_fsm.h
+struct GameIo {
+  void noteOn(uint8_t b, uint16_t ms) {
+    ownLeds(ledsOwned | keyBit(b));
+    speaker.noteOn(b, board::KEYS[b].hz, ms);
+  }
+  void noteOff(uint8_t b) {
+    ownLeds(ledsOwned & ~keyBit(b));
+    speaker.noteOff(b);
+  }
+  void toneFor(uint8_t b, uint16_t ms) { speaker.noteOn(b, board::KEYS[b].hz, ms); }
+  void allLeds(bool on) { ownLeds(on ? (Mask)~(Mask)0 : 0); }
+  void silence() { speaker.allOff(); }
+  void say(const char *msg) { Serial.println(msg); }
+  void sayTurn(int t) { Serial.print("Turn "); Serial.println(t); }
+};
+ 
+GameIo gameIo;
+game::MemoryGame<GameIo> memoryGame(gameIo, melody, melodyLength);
+ 
 // Timing / thresholds
 const unsigned long ECHO_TIMEOUT_US = 30000UL;
 const float SOUND_CM_PER_US = 0.0343f;
-const float THRESH_CM = 3.0f;
+
+// --- Sensor calibration (calib.h) ---
+// Each sensor's baseline and noise are kept in EEPROM so a board starts
+// with its own thresholds. A boot run measures them again, CAL does so
+// on request and CAL? reports them. Drift is written back at most every
+// CAL_SAVE_MS and only once it reaches CAL_SAVE_DRIFT_MM: the EEPROM is
+// good for about 100k writes per cell.
+const uint16_t CAL_MAGIC = 0xCA1B;
+const unsigned long CAL_SAVE_MS = 600000UL;
+const uint16_t CAL_SAVE_DRIFT_MM = 2;
+const int CAL_EEPROM_ADDR = 0;
+struct CalStore {
+  uint16_t magic;
+  uint8_t count;   // board::NUM_SENSORS when written
+  calib::Baseline sensors[board::NUM_SENSORS];
+  uint8_t check;   // sum of the bytes before it
+};
+calib::Sensor sensorCal[board::NUM_SENSORS];
+CalStore calStored;   // what the EEPROM holds
+unsigned long calCheckMs = 0;   // last store, or last look for drift worth storing
  
 // Breathing effect variables for Sensor A
 static float pulseSpeed = 0.5;  // Larger value gives faster pulse.
@@ -90,73 +116,459 @@ static float delta = (valueMax - valueMin) / 2.35040238;
 unsigned long lastBreathUpdate = 0;
 const unsigned long BREATH_INTERVAL = 30; // ms between updates
  
+// --- Strip output ---
+// show() sends the pixels with interrupts off, 30 us a pixel. The
+// effects only fill the pixel buffers and say whether anything changed;
+// flushStrips() sends the changed strips once both echoes are in, so no
+// distance is measured across a blackout and a strip that stays dark or
+// static costs nothing. Each show() is timed: the synth steps over the
+// samples it lost (its Timer2 matches collapse into one), and LED?
+// reports the interrupts-off total per second. Timer0 keeps a missed
+// overflow pending for up to 1 ms, so millis() loses nothing as long as
+// one show() stays under that.
+enum StripLook : uint8_t {
+  LOOK_DARK = 0,   // as setup() leaves them
+  LOOK_RAINBOW,
+  LOOK_BREATHE
+};
+struct StripStats {
+  uint16_t frames;    // show() calls
+  uint16_t skipped;   // updates that changed nothing
+  uint32_t offUs;     // interrupts off, in total
+  uint16_t maxUs;     // longest single show()
+};
+StripLook stripLook[board::NUM_STRIPS];
+bool stripDirty[board::NUM_STRIPS];
+StripStats stripNow, stripLast;   // this second so far, the last full one
+unsigned long stripSecondMs = 0;
+ 
+constexpr uint16_t longestStrip(uint8_t i = 0) {
+  return i >= board::NUM_STRIPS ? 0
+       : board::STRIPS[i].count > longestStrip(i + 1) ? board::STRIPS[i].count : longestStrip(i + 1);
+}
+static_assert(longestStrip() * 30UL < 1000, "a show() this long would lose millis() ticks");
+ 
+// Startup intro (plays the melody in the background, cancelled by any press)
+bool introActive = false;
+bool introNoteOn = false;
+int introStep = 0;
+unsigned long introStepStart = 0;
+const unsigned long INTRO_NOTE_MS = 350;
+const unsigned long INTRO_GAP_MS = 50;
+const unsigned long INTRO_TAIL_MS = 500;
+ 
+// --- Button latency (press edge -> tone/LED start) ---
+// Pin-change ISRs stamp the physical press edge, handleButtons() closes
+// the measurement when it starts the tone and LED. Bucket b counts
+// latencies below LAT_EDGES_MS[b]; the last bucket takes the rest.
+const uint8_t LAT_BUCKETS = 12;
+const uint8_t LAT_EDGES_MS[LAT_BUCKETS - 1] = {1, 2, 3, 4, 6, 8, 10, 12, 16, 32, 64};
+// Needs Io::EDGE_INTERRUPTS; shift-register boards answer LAT? with ERR
+// rather than a line of zeros per key.
+uint16_t latHist[NUM_KEYS][LAT_BUCKETS];
+unsigned long latMaxUs[NUM_KEYS];
+volatile unsigned long pressEdgeUs[NUM_KEYS];  // 0 = no edge pending
+volatile Mask buttonLevels = (Mask)~(Mask)0;   // bit i set = button i released
+volatile uint8_t *buttonInReg[NUM_KEYS];
+uint8_t buttonInMask[NUM_KEYS];
+ 
+// --- Serial protocol ---
+// Every line the host parses and every command is defined once in
+// protocol/echome.schema; protocol.h is generated from it, as is the
+// host's decoder. Game prompts (say/sayTurn) are free text.
+template <class Message>
+void send(const Message &msg) {
+  char line[Message::MAX_LEN];
+  Serial.write((const uint8_t *)line, proto::encode(msg, line, sizeof(line)));
+  Serial.println();
+}
+ 
+// --- Serial commands (one per line) ---
+char cmdBuf[16];
+uint8_t cmdLen = 0;
+ 
+// --- Telemetry ---
+// Distance lines end in " | t=<micros>", the time sensor B was triggered,
+// so the host can debounce on device time. STREAM1 prints every sample
+// instead of one every 2 s. SYNC answers "SYNC t=<micros>" straight away
+// for the host's clock offset/drift estimate.
+bool streamActive = false;
+unsigned long sampleUs = 0;
+ 
+// --- Input recording (REC1 / REC0) ---
+// Every echo measurement and button change as compact binary records,
+// sent as "~<hex>" lines so they can share the port with telemetry.
+// tools/hostsim replays them against this sketch on a PC.
+//   START   0x01 u32 micros, u8 n, n x u8 button pin, mask
+//   ECHO    0x02 varint dt_us, u8 pin, u16 duration_us (0 = timeout)
+//   BUTTONS 0x03 varint dt_us, mask (bit i = button i pressed)
+// A mask is (n + 7) / 8 bytes, one for boards with up to 8 buttons.
+// Multi-byte fields are little-endian; dt is relative to the previous record.
+const uint8_t REC_START = 0x01;
+const uint8_t REC_ECHO = 0x02;
+const uint8_t REC_BUTTONS = 0x03;
+const unsigned long REC_FLUSH_MS = 200;
+bool recActive = false;
+uint8_t recBuf[18 + NUM_KEYS];   // room for the START record
+static_assert(sizeof(recBuf) <= 48, "a ~ line carries at most 48 bytes (protocol/echome.schema)");
+uint8_t recLen = 0;
+unsigned long recLastUs = 0;
+unsigned long recFlushMs = 0;
+Mask recButtonMask = 0;
+ 
+// --- Event bus (bus.h) ---
+// Producers publish what happened and carry on; the reactions are the
+// subscriber list below, in delivery order. runTask() dispatches after
+// every task, so a task's events are handled before the next one starts
+// and in the same watchdog slot. A new reaction (logging, an effect, a
+// game mode) is a struct here and an entry in the list.
+enum Topic : uint8_t {
+  TOPIC_KEYS = 0,    // u = pressed mask, when it changes (before that scan's presses)
+  TOPIC_PRESS,       // id = key, press edge
+  TOPIC_DISTANCE,    // id = sensor, cm (NAN = no echo)
+  TOPIC_SENSED       // every sensor read this pass; u = micros() at sensor B's trigger
+};
+struct BusEvent {
+  uint8_t topic;
+  uint8_t id;
+  union {
+    uint32_t u;
+    float cm;
+  };
+};
+ 
+struct IntroReaction {   // any press ends the intro
+  static const uint16_t TOPICS = bus::topics(TOPIC_KEYS);
+  static void on(const BusEvent &e);
+};
+struct GameInput {
+  static const uint16_t TOPICS = bus::topics(TOPIC_PRESS);
+  static void on(const BusEvent &e);
+};
+struct KeyRecorder {     // REC1
+  static const uint16_t TOPICS = bus::topics(TOPIC_KEYS);
+  static void on(const BusEvent &e);
+};
+struct StripEffects {
+  static const uint16_t TOPICS = bus::topics(TOPIC_DISTANCE, TOPIC_SENSED);
+  static void on(const BusEvent &e);
+};
+struct DistanceTelemetry {
+  static const uint16_t TOPICS = bus::topics(TOPIC_DISTANCE, TOPIC_SENSED);
+  static void on(const BusEvent &e);
+};
+ 
+// A full ring is dispatched early, so 8 only bounds RAM, not events
+bus::Bus<BusEvent, 8, IntroReaction, GameInput, KeyRecorder, StripEffects, DistanceTelemetry> events;
+ 
+// --- Watchdog / stall reporting ---
+// loop() runs each hot path as a numbered task and kicks the watchdog
+// between them, so a hang inside any one task resets the board. The
+// record below lives in .noinit and survives that reset.
+enum TaskId : uint8_t {
+  TASK_BOOT = 0,
+  TASK_SENSING,
+  TASK_BUTTONS,
+  TASK_INTRO,
+  TASK_GAME,
+  TASK_IDLE,
+  TASK_SERIAL,
+  TASK_COUNT
+};
+const char *const TASK_NAMES[TASK_COUNT] = {
+  "boot", "sensing", "buttons", "intro", "game", "idle", "serial"
+};
+ 
+const uint16_t STALL_MAGIC = 0xEC40;
+struct StallRecord {
+  uint16_t magic;
+  uint8_t lastTask;          // task running when the watchdog fired
+  uint8_t stallCount;        // watchdog resets since power-up
+  unsigned long taskStartMs; // millis() when that task was entered
+};
+StallRecord stallRec __attribute__((section(".noinit")));
+ 
+// Only armed under Optiboot. The old Nano bootloader leaves the watchdog
+// running after a watchdog reset and then waits ~1 s for an upload, so
+// the board would reset inside the bootloader forever. The boot section
+// size tells them apart: Optiboot fits in 512 bytes (BOOTSZ = 11), the
+// old one takes 2 KB.
+bool watchdogSafe() {
+#ifdef __AVR__
+  return ((boot_lock_fuse_bits_get(GET_HIGH_FUSE_BITS) >> 1) & 3) == 3;
+#else
+  return true;
+#endif
+}
+ 
+// Optiboot clears MCUSR itself and hands the original value over in r2
+uint8_t bootResetFlags __attribute__((section(".noinit")));
+#ifdef __AVR__
+void saveResetFlags() __attribute__((naked, used, section(".init0")));
+void saveResetFlags() {
+  __asm__ __volatile__("sts %0, r2" : "=m"(bootResetFlags));
+}
+#endif
+ 
+// Prototypes (the Arduino IDE generates these; tools/hostsim needs them spelled out)
+void enterTask(uint8_t id);
+void runTask(uint8_t id, void (*task)());
+void reportStall(uint8_t resetFlags);
+void runUltrasonicSensing();
+void showEffect(uint8_t sensor, float cm);
+void loadCalibration();
+void saveCalibration();
+uint8_t calChecksum(const CalStore &store);
+void startCalibration(bool forced);
+void sendCalibration();
+void showBreathingEffect(uint8_t strip);
+uint32_t colorWheelBreathing(byte hue, byte sat, byte val);
+void handleButtons();
+void runMemoryGame();
+void setupButtonInterrupts();
+void onButtonEdge();
+unsigned long takeEdge(uint8_t i);
+void discardEdge(uint8_t i);
+void recordLatency(uint8_t i);
+void latencyPercentile(uint8_t i, uint32_t total, uint8_t pct, char out[4]);
+void dumpLatency();
+void clearLatency();
+void handleSerialCommands();
+void runCommand(const char *cmd);
+void sendErr(const char *cmd);
+void sendReady();
+void dumpSound();
+void recordStart();
+void recordStop();
+void recordHeader(uint8_t type, uint8_t payloadLen);
+void recordReserve(uint8_t len);
+void recordEcho(uint8_t pin, unsigned long duration);
+void recordButtons(Mask mask);
+void recordMask(Mask mask);
+void recordFlush();
+void startIntro();
+void runIntro();
+void cancelIntro();
+void publish(uint8_t topic, uint8_t id, uint32_t u);
+float readDistance(const board::Sensor &s, unsigned long timeoutUs);
+float readDistanceSinglePin(int sigPin, unsigned long timeoutUs);
+float readDistanceTrigEcho(int trigPin, int echoPin, unsigned long timeoutUs);
+void flushStrips();
+void dumpStrips();
+void clearStrip(uint8_t strip);
+void showRainbowStatic(uint8_t strip);
+uint32_t colorWheel(Adafruit_NeoPixel &s, byte pos);
+ 
 void setup() {
+  // Grab and clear the reset cause before anything else so a watchdog
+  // reset cannot loop, then report the previous stall (if any)
+  uint8_t resetFlags = MCUSR ? MCUSR : bootResetFlags;
+  MCUSR = 0;
+  wdt_disable();
+ 
   Serial.begin(9600);
+  reportStall(resetFlags);
  
   // --- Ultrasonic setup ---
-  pinMode(trigEchoPinA, OUTPUT); digitalWrite(trigEchoPinA, LOW);
-  pinMode(trigPinB, OUTPUT); digitalWrite(trigPinB, LOW);
-  pinMode(echoPinB, INPUT);
+  for (uint8_t s = 0; s < board::NUM_SENSORS; s++) {
+    const board::Sensor &sensor = board::SENSORS[s];
+    pinMode(sensor.trig, OUTPUT); digitalWrite(sensor.trig, LOW);
+    if (sensor.echo != sensor.trig) pinMode(sensor.echo, INPUT);
+  }
+ 
+  loadCalibration();
+  startCalibration(false);   // the board is normally empty at power-up
  
   // --- LED strip setup ---
-  stripA.begin(); stripB.begin();
-  stripA.setBrightness(40); stripB.setBrightness(40);
-  stripA.show(); stripB.show();
+  for (uint8_t s = 0; s < board::NUM_STRIPS; s++) {
+    strips[s].updateType(NEO_GRB + NEO_KHZ800);
+    strips[s].updateLength(board::STRIPS[s].count);
+    strips[s].setPin(board::STRIPS[s].pin);
+    strips[s].begin();
+    strips[s].setBrightness(40);
+  }
+  for (uint8_t s = 0; s < board::NUM_STRIPS; s++) strips[s].show();
  
   // --- Buttons & LEDs ---
-  for (int i = 0; i < 6; i++) {
-    pinMode(buttonPins[i], INPUT_PULLUP);
-    pinMode(ledPins[i], OUTPUT);
-  }
+  keys.begin();
+  if (board::Io::EDGE_INTERRUPTS) setupButtonInterrupts();
  
-  pinMode(SPEAKER_PIN, OUTPUT);
-  playStartupMelody();
+  speaker.begin(board::SPEAKER_PIN);
+ 
+  // Everything is live now; the intro melody runs alongside loop()
+  sendReady();
+  startIntro();
+ 
+  if (watchdogSafe()) wdt_enable(WDTO_500MS);
 }
  
 void loop() {
   // Always run ultrasonic sensors (non-blocking)
-  runUltrasonicSensing();
+  runTask(TASK_SENSING, runUltrasonicSensing);
   
   // Always handle button presses (non-blocking)
-  handleButtons();
+  runTask(TASK_BUTTONS, handleButtons);
   
-  // Run game logic (non-blocking)
-  runMemoryGame();
+  // Host commands (latency dump etc.)
+  runTask(TASK_SERIAL, handleSerialCommands);
+  
+  // Startup intro first, then the game takes over
+  if (introActive) {
+    runTask(TASK_INTRO, runIntro);
+  } else {
+    runTask(TASK_GAME, runMemoryGame);
+  }
   
+  enterTask(TASK_IDLE);
   delay(50);
+  wdt_reset();
+}
+ 
+// ================= Task Watchdog =================
+void enterTask(uint8_t id) {
+  stallRec.lastTask = id;
+  stallRec.taskStartMs = millis();
+}
+ 
+void runTask(uint8_t id, void (*task)()) {
+  enterTask(id);
+  task();
+  events.dispatch();   // the task's reactions count as part of it
+  wdt_reset();
+}
+ 
+void reportStall(uint8_t resetFlags) {
+  if (stallRec.magic != STALL_MAGIC || !(resetFlags & (_BV(WDRF) | _BV(EXTRF) | _BV(BORF)))) {
+    // Power-on (or garbage): start a fresh record
+    stallRec.magic = STALL_MAGIC;
+    stallRec.stallCount = 0;
+  } else if (resetFlags & _BV(WDRF)) {
+    if (stallRec.stallCount < 255) stallRec.stallCount++;
+    uint8_t id = stallRec.lastTask < TASK_COUNT ? stallRec.lastTask : (uint8_t)TASK_BOOT;
+    proto::Stall stall;
+    stall.task = TASK_NAMES[id];
+    stall.at = stallRec.taskStartMs;
+    stall.count = stallRec.stallCount;
+    send(stall);
+  }
+  enterTask(TASK_BOOT);
 }
  
 void runUltrasonicSensing() {
-  // Ultrasonic sensor A
-  float dA = readDistanceSinglePin(trigEchoPinA, ECHO_TIMEOUT_US);
-  
-  if (!isnan(dA) && dA > THRESH_CM) {
-    // Sensor A activated - show breathing effect
-    showBreathingEffect(stripA, LED_COUNT_A);
-  } else {
-    // Sensor A not active - clear strip
-    clearStrip(stripA, LED_COUNT_A);
+  // Each sensor in turn; strips and telemetry react to the events
+  bool runEnded = false, calibrated = false;
+  for (uint8_t s = 0; s < board::NUM_SENSORS; s++) {
+    if (s == board::PRESENCE_SENSOR) sampleUs = micros();
+    float cm = readDistance(board::SENSORS[s], ECHO_TIMEOUT_US);
+    calib::Result r = sensorCal[s].sample(calib::toMm(cm));
+    runEnded |= r != calib::RESULT_NONE;
+    calibrated |= r == calib::RESULT_CALIBRATED;
+    BusEvent e;
+    e.topic = TOPIC_DISTANCE;
+    e.id = s;
+    e.cm = cm;
+    events.publish(e);
   }
+  publish(TOPIC_SENSED, 0, sampleUs);
  
-  // Ultrasonic sensor B (normal rainbow)
-  float dB = readDistanceTrigEcho(trigPinB, echoPinB, ECHO_TIMEOUT_US);
-  if (!isnan(dB) && dB > THRESH_CM) {
-    showRainbowStatic(stripB, LED_COUNT_B);
-  } else {
-    clearStrip(stripB, LED_COUNT_B);
+  // Store a new calibration straight away, drift only now and then
+  if (calibrated) {
+    saveCalibration();
+  } else if (millis() - calCheckMs >= CAL_SAVE_MS) {
+    bool drifted = false;
+    for (uint8_t s = 0; s < board::NUM_SENSORS; s++)
+      drifted |= sensorCal[s].src != calib::SRC_DEFAULT &&
+                 sensorCal[s].driftedFrom(calStored.sensors[s], CAL_SAVE_DRIFT_MM);
+    if (drifted) saveCalibration();
+    else calCheckMs = millis();
   }
+  if (runEnded) sendCalibration();
+}
  
-  // Display distances occasionally
+void StripEffects::on(const BusEvent &e) {
+  if (e.topic == TOPIC_DISTANCE) showEffect(e.id, e.cm);
+  else flushStrips();   // both echoes are in: safe to turn interrupts off
+}
+ 
+// Display distances occasionally (every sample when streaming)
+void DistanceTelemetry::on(const BusEvent &e) {
+  static float cm[board::NUM_SENSORS];
   static unsigned long lastPrint = 0;
-  if (millis() - lastPrint > 2000) {
-    Serial.print("A: "); printDistance(dA);
-    Serial.print(" | B: "); printDistance(dB);
-    Serial.println();
+  if (e.topic == TOPIC_DISTANCE) {
+    cm[e.id] = e.cm;
+    return;
+  }
+  if (streamActive || millis() - lastPrint > 2000) {
+    proto::Distance line;
+    line.a = cm[0];
+    line.b = cm[board::PRESENCE_SENSOR];
+    line.hasT = true;
+    line.t = e.u;
+    send(line);
     lastPrint = millis();
   }
 }
  
-void showBreathingEffect(Adafruit_NeoPixel &strip, int numLeds) {
+// Strip effect while the sensor sees something, dark once the cube is on it
+void showEffect(uint8_t sensor, float cm) {
+  const board::Sensor &s = board::SENSORS[sensor];
+  if (isnan(cm) || sensorCal[sensor].present) {
+    clearStrip(s.strip);
+  } else if (s.effect == board::EFFECT_BREATHE) {
+    showBreathingEffect(s.strip);
+  } else {
+    showRainbowStatic(s.strip);
+  }
+}
+ 
+// ================= Sensor Calibration =================
+void loadCalibration() {
+  EEPROM.get(CAL_EEPROM_ADDR, calStored);
+  if (calStored.magic != CAL_MAGIC || calStored.count != board::NUM_SENSORS ||
+      calStored.check != calChecksum(calStored)) {
+    memset(&calStored, 0, sizeof(calStored));   // blank or another layout: defaults
+    return;
+  }
+  for (uint8_t s = 0; s < board::NUM_SENSORS; s++)
+    sensorCal[s].apply(calStored.sensors[s], calib::SRC_SAVED);
+}
+ 
+void saveCalibration() {
+  calStored.magic = CAL_MAGIC;
+  calStored.count = board::NUM_SENSORS;
+  for (uint8_t s = 0; s < board::NUM_SENSORS; s++) calStored.sensors[s] = sensorCal[s].cal;
+  calStored.check = calChecksum(calStored);
+  EEPROM.put(CAL_EEPROM_ADDR, calStored);   // only rewrites bytes that changed
+  calCheckMs = millis();
+}
+ 
+uint8_t calChecksum(const CalStore &store) {
+  const uint8_t *p = (const uint8_t *)&store;
+  uint8_t sum = 0;
+  for (uint8_t i = 0; i < offsetof(CalStore, check); i++) sum += p[i];
+  return sum;
+}
+ 
+void startCalibration(bool forced) {
+  for (uint8_t s = 0; s < board::NUM_SENSORS; s++) sensorCal[s].calibrate(forced);
+}
+ 
+// One CAL line per sensor, named as in the distance line
+void sendCalibration() {
+  proto::Calibration line;
+  for (uint8_t s = 0; s < board::NUM_SENSORS; s++) {
+    const calib::Sensor &c = sensorCal[s];
+    line.sensor = s == board::PRESENCE_SENSOR ? "B" : "A";
+    line.base = c.cal.baseMm;
+    line.noise = c.cal.noiseMm;
+    line.on = c.onMm;
+    line.off = c.offMm;
+    line.src = calib::sourceName(c.src);
+    send(line);
+  }
+}
+ 
+void showBreathingEffect(uint8_t strip) {
   if (millis() - lastBreathUpdate > BREATH_INTERVAL) {
     // Calculate breathing pulse
     float dV = ((exp(sin(pulseSpeed * millis()/2000.0*PI)) -0.36787944) * delta);
@@ -168,17 +580,19 @@ void showBreathingEffect(Adafruit_NeoPixel &strip, int numLeds) {
     uint32_t color = colorWheelBreathing(hue, sat, val);
     
     // Apply to all LEDs in the strip
-    for (int i = 0; i < numLeds; i++) {
-      strip.setPixelColor(i, color);
+    for (int i = 0; i < board::STRIPS[strip].count; i++) {
+      strips[strip].setPixelColor(i, color);
     }
-    strip.show();
+    stripLook[strip] = LOOK_BREATHE;
+    stripDirty[strip] = true;
     
     lastBreathUpdate = millis();
   }
 }
  
 uint32_t colorWheelBreathing(byte hue, byte sat, byte val) {
-  // Convert HSV to RGB (simplified version)
+  // Convert HSV to RGB (simplified version; full saturation only)
+  (void)sat;
   hue = 255 - hue;
   if (hue < 85) {
     return Adafruit_NeoPixel::Color(
@@ -203,142 +617,387 @@ uint32_t colorWheelBreathing(byte hue, byte sat, byte val) {
   }
 }
  
+// Each key's own LED and tone straight away; everything else reacts to
+// the KEYS / PRESS events
 void handleButtons() {
-  for (int i = 0; i < 6; i++) {
-    bool pressed = digitalRead(buttonPins[i]) == LOW;
-    digitalWrite(ledPins[i], pressed);
-    if (pressed) {
-      tone(SPEAKER_PIN, notes[i], 200);
-      if (waitingForInput) {
-        checkGameInput(i + 1);
+  Mask wasPressed = keysHeld;
+  Mask mask = keys.readButtons();   // one scan for all buttons
+  if (mask != wasPressed) {
+    // Handled before the keys' own feedback: ending the intro starts a
+    // game, which clears the LEDs and the speaker
+    publish(TOPIC_KEYS, 0, mask);
+    events.dispatch();
+  }
+  keysHeld = mask;
+  keys.setLeds(mask | ledsOwned);
+  for (uint8_t i = 0; i < NUM_KEYS; i++) {
+    Mask bit = keyBit(i);
+    if (mask & bit) {
+      speaker.noteOn(i, board::KEYS[i].hz, 200);  // held buttons sound together
+      // Only the press edge counts as input, not a held button
+      if (!(wasPressed & bit)) {
+        recordLatency(i);  // tone + LED are now on for this press
+        publish(TOPIC_PRESS, i, 0);
       }
+    } else {
+      discardEdge(i);  // press too short to be seen by polling
     }
   }
 }
  
+void publish(uint8_t topic, uint8_t id, uint32_t u) {
+  BusEvent e;
+  e.topic = topic;
+  e.id = id;
+  e.u = u;
+  events.publish(e);
+}
+ 
+void IntroReaction::on(const BusEvent &e) {
+  if (introActive && e.u) cancelIntro();
+}
+ 
+void GameInput::on(const BusEvent &e) {
+  memoryGame.press(e.id, millis());
+}
+ 
+void KeyRecorder::on(const BusEvent &e) {
+  if (recActive && (Mask)e.u != recButtonMask) recordButtons((Mask)e.u);
+}
+ 
 void runMemoryGame() {
-  if (turn >= melodyLength) {
-    winSequence();
-    turn = 0;
-    currentStep = 0;
-    showingSequence = false;
-    waitingForInput = false;
-    return;
+  memoryGame.tick(millis());
+}
+ 
+// ================= Button Latency =================
+void setupButtonInterrupts() {
+  for (uint8_t i = 0; i < NUM_KEYS; i++) {
+    uint8_t pin = board::KEYS[i].button;
+    buttonInReg[i] = portInputRegister(digitalPinToPort(pin));
+    buttonInMask[i] = digitalPinToBitMask(pin);
+    *digitalPinToPCMSK(pin) |= _BV(digitalPinToPCMSKbit(pin));
+    *digitalPinToPCICR(pin) |= _BV(digitalPinToPCICRbit(pin));
   }
-  
-  if (!showingSequence && !waitingForInput) {
-    showingSequence = true;
-    currentStep = 0;
-    Serial.print("Turn "); Serial.println(turn + 1);
+}
+ 
+// Shared by all three pin-change vectors; stamps high->low edges only
+void onButtonEdge() {
+  unsigned long now = micros();
+  Mask levels = 0;
+  for (uint8_t i = 0; i < NUM_KEYS; i++) {
+    bool high = (*buttonInReg[i] & buttonInMask[i]) != 0;
+    if (high) levels |= keyBit(i);
+    else if ((buttonLevels & keyBit(i)) && pressEdgeUs[i] == 0) pressEdgeUs[i] = now ? now : 1;
   }
-  
-  if (showingSequence && millis() - lastActionTime > STEP_DELAY) {
-    if (currentStep <= turn) {
-      playNote(melody[currentStep]);
-      currentStep++;
-      lastActionTime = millis();
-    } else {
-      showingSequence = false;
-      waitingForInput = true;
-      currentStep = 0;
-      Serial.println("Your turn!");
+  buttonLevels = levels;
+}
+ 
+ISR(PCINT0_vect) { onButtonEdge(); }
+ISR(PCINT1_vect) { onButtonEdge(); }
+ISR(PCINT2_vect) { onButtonEdge(); }
+ 
+unsigned long takeEdge(uint8_t i) {
+  uint8_t sreg = SREG;
+  cli();
+  unsigned long edge = pressEdgeUs[i];
+  pressEdgeUs[i] = 0;
+  SREG = sreg;
+  return edge;
+}
+ 
+void discardEdge(uint8_t i) {
+  if (pressEdgeUs[i] != 0) takeEdge(i);
+}
+ 
+void recordLatency(uint8_t i) {
+  unsigned long edge = takeEdge(i);
+  if (edge == 0) return;
+  unsigned long us = micros() - edge;
+  unsigned long ms = us / 1000;
+  uint8_t b = 0;
+  while (b < LAT_BUCKETS - 1 && ms >= LAT_EDGES_MS[b]) b++;
+  if (latHist[i][b] < 0xFFFF) latHist[i][b]++;
+  if (us > latMaxUs[i]) latMaxUs[i] = us;
+}
+ 
+// Upper bound (ms) of the bucket holding the given percentile, as text
+// ("64+" for the last bucket, "-" with no samples)
+void latencyPercentile(uint8_t i, uint32_t total, uint8_t pct, char out[4]) {
+  uint32_t need = (total * pct + 99) / 100;
+  uint32_t seen = 0;
+  for (uint8_t b = 0; b < LAT_BUCKETS; b++) {
+    seen += latHist[i][b];
+    if (seen >= need) {
+      uint8_t ms = LAT_EDGES_MS[b < LAT_BUCKETS - 1 ? b : LAT_BUCKETS - 2];
+      uint8_t n = 0;
+      if (ms >= 10) out[n++] = '0' + ms / 10;
+      out[n++] = '0' + ms % 10;
+      if (b == LAT_BUCKETS - 1) out[n++] = '+';
+      out[n] = 0;
+      return;
     }
   }
+  strcpy(out, "-");
 }
  
-void checkGameInput(int buttonPressed) {
-  if (!waitingForInput) return;
-  
-  int expectedNote = melody[currentStep];
-  
-  if (buttonPressed == expectedNote) {
-    Serial.println("Correct!");
-    currentStep++;
-    
-    if (currentStep > turn) {
-      turn++;
-      waitingForInput = false;
-      Serial.println("Good! Next level...");
-      delay(1000);
-    }
-  } else {
-    Serial.println("Wrong! Try again.");
-    failSequence();
+// One LAT line per button. At 9600 baud each line blocks for ~60 ms
+// once the TX buffer is full, so the watchdog is kicked per line.
+void dumpLatency() {
+  char p50[4], p99[4];
+  proto::Latency line;
+  line.p50 = p50;
+  line.p99 = p99;
+  line.hCount = LAT_BUCKETS;
+  for (uint8_t i = 0; i < NUM_KEYS; i++) {
+    uint32_t total = 0;
+    for (uint8_t b = 0; b < LAT_BUCKETS; b++) total += latHist[i][b];
+    latencyPercentile(i, total, 50, p50);
+    latencyPercentile(i, total, 99, p99);
+    line.b = i + 1;
+    line.n = total;
+    line.max = latMaxUs[i];
+    line.h = latHist[i];
+    send(line);
+    wdt_reset();
   }
 }
  
-void playNote(int noteIndex) {
-  int arrayIndex = noteIndex - 1;
-  if (arrayIndex >= 0 && arrayIndex < 6) {
-    digitalWrite(ledPins[arrayIndex], HIGH);
-    tone(SPEAKER_PIN, notes[arrayIndex], 300);
-    delay(300);
-    digitalWrite(ledPins[arrayIndex], LOW);
-    noTone(SPEAKER_PIN);
+void clearLatency() {
+  memset(latHist, 0, sizeof(latHist));
+  memset(latMaxUs, 0, sizeof(latMaxUs));
+}
+ 
+// ================= Serial Commands =================
+void handleSerialCommands() {
+  while (Serial.available() > 0) {
+    char c = Serial.read();
+    if (c == '\r' || c == '\n') {
+      if (cmdLen > 0) {
+        cmdBuf[cmdLen] = '\0';
+        runCommand(cmdBuf);
+      }
+      cmdLen = 0;
+    } else if (cmdLen < sizeof(cmdBuf) - 1) {
+      cmdBuf[cmdLen++] = c;
+    }
   }
+ 
+  if (recLen > 0 && millis() - recFlushMs >= REC_FLUSH_MS) recordFlush();
 }
  
-void failSequence() {
-  Serial.println("FAIL! Restarting...");
-  
-  for (int i = 0; i < 3; i++) {
-    for (int j = 0; j < 6; j++) digitalWrite(ledPins[j], HIGH);
-    tone(SPEAKER_PIN, NOTE_C, 300);
-    delay(400);
-    for (int j = 0; j < 6; j++) digitalWrite(ledPins[j], LOW);
-    tone(SPEAKER_PIN, NOTE_G, 300);
-    delay(400);
+void runCommand(const char *cmd) {
+  proto::Command command = proto::decodeCommand(cmd);
+  switch (command) {
+    case proto::CMD_SYNC: {
+      proto::SyncReply reply;
+      reply.t = micros();
+      send(reply);
+      break;
+    }
+    case proto::CMD_IDENTIFY:
+      sendReady();   // the host may have opened the port without resetting us
+      break;
+    case proto::CMD_LAT_DUMP:
+      if (board::Io::EDGE_INTERRUPTS) dumpLatency();
+      else sendErr(cmd);
+      break;
+    case proto::CMD_LAT_CLEAR:
+      clearLatency();
+      send(proto::Ok());
+      break;
+    case proto::CMD_REC_START:
+      recordStart();
+      break;
+    case proto::CMD_REC_STOP:
+      recordStop();
+      break;
+    case proto::CMD_CALIBRATE:
+      startCalibration(true);   // CAL lines follow once it has its samples
+      send(proto::Ok());
+      break;
+    case proto::CMD_CAL_DUMP:
+      sendCalibration();
+      break;
+    case proto::CMD_STRIP_DUMP:
+      dumpStrips();
+      break;
+    case proto::CMD_SOUND_DUMP:
+      dumpSound();
+      break;
+    case proto::CMD_SOUND_CLEAR:
+      speaker.clearStats();
+      send(proto::Ok());
+      break;
+    case proto::CMD_STREAM_ON:
+    case proto::CMD_STREAM_OFF:
+      streamActive = command == proto::CMD_STREAM_ON;
+      send(proto::Ok());
+      break;
+    default:
+      sendErr(cmd);
+      break;
   }
-  noTone(SPEAKER_PIN);
-  
-  turn = 0;
-  currentStep = 0;
-  showingSequence = false;
-  waitingForInput = false;
-  delay(1000);
 }
  
-void winSequence() {
-  Serial.println("YOU WIN!");
-  
-  for (int i = 0; i < 6; i++) digitalWrite(ledPins[i], HIGH);
-  
-  tone(SPEAKER_PIN, NOTE_E, 400);
-  delay(500);
-  tone(SPEAKER_PIN, NOTE_G, 400);
-  delay(500);
-  tone(SPEAKER_PIN, NOTE_E, 400);
-  delay(500);
-  tone(SPEAKER_PIN, NOTE_C, 600);
-  delay(700);
-  noTone(SPEAKER_PIN);
-  
-  for (int i = 0; i < 6; i++) digitalWrite(ledPins[i], LOW);
-  delay(2000);
-}
- 
-void playStartupMelody() {
-  for (int i = 0; i < 15; i++) {
-    int noteIndex = melody[i] - 1;
-    if (noteIndex >= 0 && noteIndex < 6) {
-      digitalWrite(ledPins[noteIndex], HIGH);
-      tone(SPEAKER_PIN, notes[noteIndex], 300);
-      delay(350);
-      digitalWrite(ledPins[noteIndex], LOW);
-      delay(50);
+void sendErr(const char *cmd) {
+  proto::Err err;
+  err.cmd = cmd;
+  send(err);
+}
+ 
+void sendReady() {
+  proto::Ready ready;
+  ready.hasFw = true;
+  ready.fw = FIRMWARE_VERSION;
+  send(ready);
+}
+ 
+void dumpSound() {
+  synth::Stats st = speaker.stats();
+  proto::Sound line;
+  line.voices = st.voices;
+  line.slots = synth::VOICES;
+  line.max = st.maxCycles;
+  line.avg = st.avgCycles;
+  line.load = st.avgCycles * 100UL / synth::CYCLES_PER_SAMPLE;
+  line.budget = synth::ISR_BUDGET_CYCLES;
+  send(line);
+}
+ 
+// ================= Input Recording =================
+void recordStart() {
+  recActive = true;
+  recLen = 0;
+  recFlushMs = millis();
+  recLastUs = micros();
+  recButtonMask = keys.readButtons();
+  recordReserve(6 + NUM_KEYS + board::MASK_BYTES);
+  recBuf[recLen++] = REC_START;
+  for (uint8_t k = 0; k < 4; k++) recBuf[recLen++] = (uint8_t)(recLastUs >> (8 * k));
+  recBuf[recLen++] = NUM_KEYS;
+  for (uint8_t i = 0; i < NUM_KEYS; i++) recBuf[recLen++] = board::KEYS[i].button;
+  recordMask(recButtonMask);
+}
+ 
+void recordStop() {
+  recordFlush();
+  recActive = false;
+  send(proto::Ok());
+}
+ 
+// Makes room for one record and writes its type + time delta
+void recordHeader(uint8_t type, uint8_t payloadLen) {
+  recordReserve(1 + 5 + payloadLen);
+  unsigned long now = micros();
+  unsigned long dt = now - recLastUs;
+  recLastUs = now;
+  recBuf[recLen++] = type;
+  do {
+    uint8_t b = dt & 0x7F;
+    dt >>= 7;
+    recBuf[recLen++] = dt ? (b | 0x80) : b;
+  } while (dt);
+}
+ 
+void recordReserve(uint8_t len) {
+  if (recLen + len > sizeof(recBuf)) recordFlush();
+}
+ 
+void recordEcho(uint8_t pin, unsigned long duration) {
+  if (!recActive) return;
+  uint16_t d = duration > 0xFFFF ? 0xFFFF : (uint16_t)duration;
+  recordHeader(REC_ECHO, 3);
+  recBuf[recLen++] = pin;
+  recBuf[recLen++] = d & 0xFF;
+  recBuf[recLen++] = d >> 8;
+}
+ 
+void recordButtons(Mask mask) {
+  recButtonMask = mask;
+  recordHeader(REC_BUTTONS, board::MASK_BYTES);
+  recordMask(mask);
+}
+ 
+void recordMask(Mask mask) {
+  for (uint8_t k = 0; k < board::MASK_BYTES; k++) recBuf[recLen++] = (uint8_t)(mask >> (8 * k));
+}
+ 
+void recordFlush() {
+  recFlushMs = millis();
+  if (recLen == 0) return;
+  proto::Record line;
+  line.data = recBuf;
+  line.dataLen = recLen;
+  send(line);
+  recLen = 0;
+}
+ 
+// ================= Startup Intro =================
+void startIntro() {
+  introActive = true;
+  introNoteOn = false;
+  introStep = 0;
+  introStepStart = millis() - INTRO_GAP_MS;  // first note on the next loop
+}
+ 
+void runIntro() {
+  unsigned long now = millis();
+ 
+  if (introNoteOn) {
+    // Note finished -> LED off, short gap before the next one
+    if (now - introStepStart < INTRO_NOTE_MS) return;
+    int noteIndex = melody[introStep] - 1;
+    if (noteIndex >= 0 && noteIndex < NUM_KEYS) ownLeds(ledsOwned & ~keyBit(noteIndex));
+    introNoteOn = false;
+    introStep++;
+    introStepStart = now;
+    return;
+  }
+ 
+  if (introStep >= melodyLength) {
+    // Hold a moment after the last note, then hand over to the game
+    if (now - introStepStart >= INTRO_TAIL_MS) {
+      introActive = false;
+      memoryGame.begin(now);
     }
+    return;
   }
-  delay(500);
+ 
+  if (now - introStepStart < INTRO_GAP_MS) return;
+  int noteIndex = melody[introStep] - 1;
+  if (noteIndex >= 0 && noteIndex < NUM_KEYS) {
+    ownLeds(ledsOwned | keyBit(noteIndex));
+    speaker.noteOn(noteIndex, board::KEYS[noteIndex].hz, 300);
+  }
+  introNoteOn = true;
+  introStepStart = now;
+}
+ 
+void cancelIntro() {
+  if (introNoteOn) {
+    int noteIndex = melody[introStep] - 1;
+    if (noteIndex >= 0 && noteIndex < NUM_KEYS) ownLeds(ledsOwned & ~keyBit(noteIndex));
+  }
+  speaker.allOff();
+  introActive = false;
+  introNoteOn = false;
+  memoryGame.begin(millis());
 }
  
 // ================= Ultrasonic Helpers =================
+float readDistance(const board::Sensor &s, unsigned long timeoutUs) {
+  if (s.trig == s.echo) return readDistanceSinglePin(s.trig, timeoutUs);
+  return readDistanceTrigEcho(s.trig, s.echo, timeoutUs);
+}
+ 
 float readDistanceSinglePin(int sigPin, unsigned long timeoutUs) {
   pinMode(sigPin, OUTPUT);
   digitalWrite(sigPin, LOW); delayMicroseconds(2);
   digitalWrite(sigPin, HIGH); delayMicroseconds(10);
   digitalWrite(sigPin, LOW);
   pinMode(sigPin, INPUT);
-  unsigned long duration = pulseIn(sigPin, HIGH, timeoutUs);
+  unsigned long duration = pulseInLong(sigPin, HIGH, timeoutUs);
+  recordEcho(sigPin, duration);
   if (duration == 0) return NAN;
   float cm = (duration * SOUND_CM_PER_US) / 2.0f;
   if (cm < 0.5f) cm = 0.0f;
@@ -349,29 +1008,63 @@ float readDistanceTrigEcho(int trigPin, int echoPin, unsigned long timeoutUs) {
   digitalWrite(trigPin, LOW); delayMicroseconds(2);
   digitalWrite(trigPin, HIGH); delayMicroseconds(10);
   digitalWrite(trigPin, LOW);
-  unsigned long duration = pulseIn(echoPin, HIGH, timeoutUs);
+  unsigned long duration = pulseInLong(echoPin, HIGH, timeoutUs);
+  recordEcho(echoPin, duration);
   if (duration == 0) return NAN;
   float cm = (duration * SOUND_CM_PER_US) / 2.0f;
   if (cm < 0.5f) cm = 0.0f;
   return cm;
 }
  
-void printDistance(float cm) {
-  if (isnan(cm)) Serial.print("—");
-  else { Serial.print(cm, 2); Serial.print(" cm"); }
+// ================= Strip Output =================
+void flushStrips() {
+  for (uint8_t s = 0; s < board::NUM_STRIPS; s++) {
+    if (!stripDirty[s]) {
+      stripNow.skipped++;
+      continue;
+    }
+    stripDirty[s] = false;
+    unsigned long start = micros();
+    strips[s].show();
+    unsigned long us = micros() - start;
+    speaker.skip(us);
+    stripNow.frames++;
+    stripNow.offUs += us;
+    if (us > stripNow.maxUs) stripNow.maxUs = us;
+  }
+  if (millis() - stripSecondMs >= 1000) {
+    stripLast = stripNow;
+    memset(&stripNow, 0, sizeof(stripNow));
+    stripSecondMs = millis();
+  }
+}
+ 
+void dumpStrips() {
+  proto::Strips line;
+  line.frames = stripLast.frames;
+  line.skipped = stripLast.skipped;
+  line.off = stripLast.offUs;
+  line.max = stripLast.maxUs;
+  send(line);
 }
  
-void clearStrip(Adafruit_NeoPixel &s, int n) {
-  for (int i = 0; i < n; i++) s.setPixelColor(i, 0);
-  s.show();
+void clearStrip(uint8_t strip) {
+  if (stripLook[strip] == LOOK_DARK) return;
+  for (int i = 0; i < board::STRIPS[strip].count; i++) strips[strip].setPixelColor(i, 0);
+  stripLook[strip] = LOOK_DARK;
+  stripDirty[strip] = true;
 }
  
-void showRainbowStatic(Adafruit_NeoPixel &s, int n) {
+void showRainbowStatic(uint8_t strip) {
+  if (stripLook[strip] == LOOK_RAINBOW) return;   // nothing moves
+  Adafruit_NeoPixel &s = strips[strip];
+  int n = board::STRIPS[strip].count;
   for (int i = 0; i < n; i++) {
     uint8_t pos = (uint8_t)(i * (255 / max(1, n - 1)));
     s.setPixelColor(i, colorWheel(s, pos));
   }
-  s.show();
+  stripLook[strip] = LOOK_RAINBOW;
+  stripDirty[strip] = true;
 }
  
 uint32_t colorWheel(Adafruit_NeoPixel &s, byte pos) {
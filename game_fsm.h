@@ -0,0 +1,288 @@
+/*
+ * File:     game_fsm.h
+ * Author:   Claire Kim
+ *           Joan Teves
+ * Company:  University of Canterbury Group 5
+ * Date:     01/10/2025
+ */
+
+// ================================================================
+// Memory game as a table-driven state machine.
+//
+// Raw inputs (button presses, timer expiry) are classified into an
+// Event, then TABLE[state][event] gives the next state and the action
+// to run. Lookup is O(1), the table lives in flash and nothing is
+// allocated. All I/O goes through the Io template parameter so the
+// same code runs on the Nano and on a host with a fake Io.
+//
+// Io must provide:
+//   void noteOn(uint8_t button, uint16_t ms);   // LED on + tone
+//   void noteOff(uint8_t button);               // LED off + silence
+//   void toneFor(uint8_t button, uint16_t ms);  // tone only
+//   void allLeds(bool on);
+//   void silence();
+//   void say(const char *msg);                  // one serial line
+//   void sayTurn(int turn);                     // "Turn n"
+// ================================================================
+
+#ifndef GAME_FSM_H
+#define GAME_FSM_H
+
+#include <stdint.h>
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#define GAME_TABLE_ATTR PROGMEM
+#define GAME_READ(p) pgm_read_byte(p)
+#else
+#define GAME_TABLE_ATTR
+#define GAME_READ(p) (*(p))
+#endif
+
+namespace game {
+
+enum State : uint8_t {
+  ST_START_TURN,   // "Turn n", short pause before the sequence
+  ST_SHOW_NOTE,    // sequence note sounding
+  ST_SHOW_GAP,     // pause between sequence notes
+  ST_AWAIT_INPUT,  // player repeats the sequence
+  ST_LEVEL_UP,     // pause after a completed turn
+  ST_FAIL,         // fail jingle
+  ST_WIN,          // win jingle
+  ST_COUNT
+};
+
+enum Event : uint8_t {
+  EV_TIMER,        // state timer expired, more to do
+  EV_SEQ_DONE,     // state timer expired, sequence/jingle finished
+  EV_CORRECT,      // right button, turn not finished
+  EV_TURN_DONE,    // right button, last note of this turn
+  EV_GAME_DONE,    // right button, last note of the whole melody
+  EV_WRONG,        // wrong button
+  EV_BUTTON,       // button press while not waiting for input
+  EV_RESET,        // start over from turn 1
+  EV_COUNT
+};
+
+enum Action : uint8_t {
+  A_NONE,
+  A_RESTART,       // silence, turn = 0, announce
+  A_NEXT_TURN,     // turn++, announce
+  A_NOTE_ON,
+  A_NOTE_OFF,
+  A_PROMPT,
+  A_ACCEPT,
+  A_LEVEL_UP,
+  A_FAIL_START,
+  A_FAIL_STEP,
+  A_WIN_START,
+  A_WIN_STEP,
+  A_COUNT
+};
+
+struct Transition {
+  State next;
+  Action action;
+};
+
+#define GT(s, a) Transition{ST_##s, A_##a}
+
+constexpr Transition TABLE[ST_COUNT][EV_COUNT] GAME_TABLE_ATTR = {
+  //              EV_TIMER               EV_SEQ_DONE             EV_CORRECT              EV_TURN_DONE             EV_GAME_DONE          EV_WRONG                EV_BUTTON               EV_RESET
+  /* START  */ { GT(SHOW_NOTE, NOTE_ON), GT(START_TURN, NONE),   GT(START_TURN, NONE),   GT(START_TURN, NONE),    GT(START_TURN, NONE), GT(START_TURN, NONE),   GT(START_TURN, NONE),   GT(START_TURN, RESTART) },
+  /* NOTE   */ { GT(SHOW_GAP, NOTE_OFF), GT(SHOW_NOTE, NONE),    GT(SHOW_NOTE, NONE),    GT(SHOW_NOTE, NONE),     GT(SHOW_NOTE, NONE),  GT(SHOW_NOTE, NONE),    GT(SHOW_NOTE, NONE),    GT(START_TURN, RESTART) },
+  /* GAP    */ { GT(SHOW_NOTE, NOTE_ON), GT(AWAIT_INPUT, PROMPT), GT(SHOW_GAP, NONE),    GT(SHOW_GAP, NONE),      GT(SHOW_GAP, NONE),   GT(SHOW_GAP, NONE),     GT(SHOW_GAP, NONE),     GT(START_TURN, RESTART) },
+  /* AWAIT  */ { GT(AWAIT_INPUT, NONE),  GT(AWAIT_INPUT, NONE),  GT(AWAIT_INPUT, ACCEPT), GT(LEVEL_UP, LEVEL_UP), GT(WIN, WIN_START),   GT(FAIL, FAIL_START),   GT(AWAIT_INPUT, NONE),  GT(START_TURN, RESTART) },
+  /* LEVEL  */ { GT(START_TURN, NEXT_TURN), GT(LEVEL_UP, NONE),  GT(LEVEL_UP, NONE),     GT(LEVEL_UP, NONE),      GT(LEVEL_UP, NONE),   GT(LEVEL_UP, NONE),     GT(LEVEL_UP, NONE),     GT(START_TURN, RESTART) },
+  /* FAIL   */ { GT(FAIL, FAIL_STEP),    GT(START_TURN, RESTART), GT(FAIL, NONE),        GT(FAIL, NONE),          GT(FAIL, NONE),       GT(FAIL, NONE),         GT(FAIL, NONE),         GT(START_TURN, RESTART) },
+  /* WIN    */ { GT(WIN, WIN_STEP),      GT(START_TURN, RESTART), GT(WIN, NONE),         GT(WIN, NONE),           GT(WIN, NONE),        GT(WIN, NONE),          GT(WIN, NONE),          GT(START_TURN, RESTART) },
+};
+
+#undef GT
+
+// Compile-time checks: every cell points at a real state/action and
+// EV_RESET always lands in ST_START_TURN
+constexpr bool rowValid(unsigned s, unsigned e) {
+  return e == EV_COUNT ||
+         (TABLE[s][e].next < ST_COUNT && TABLE[s][e].action < A_COUNT &&
+          (e != EV_RESET || TABLE[s][e].next == ST_START_TURN) &&
+          rowValid(s, e + 1));
+}
+constexpr bool tableValid(unsigned s) {
+  return s == ST_COUNT || (rowValid(s, 0) && tableValid(s + 1));
+}
+static_assert(tableValid(0), "game::TABLE has an invalid transition");
+static_assert(sizeof(TABLE) == ST_COUNT * EV_COUNT * sizeof(Transition),
+              "game::TABLE must cover every state/event pair");
+
+// Timing (ms)
+const uint16_t STEP_DELAY = 800;   // before each sequence note
+const uint16_t NOTE_MS = 300;
+const uint16_t LEVEL_PAUSE = 1000;
+const uint16_t FAIL_FLASH_MS = 400;
+const uint16_t FAIL_TONE_MS = 300;
+const uint16_t FAIL_HOLD_MS = 1000;
+const uint8_t FAIL_FLASHES = 3;
+const uint8_t FAIL_PHASES = FAIL_FLASHES * 2 + 1;  // on/off pairs + hold
+
+// Win jingle as button indices (E G E C), then a 2 s hold
+const uint8_t WIN_NOTES[] = {2, 4, 2, 0};
+const uint16_t WIN_TONE_MS[] = {400, 400, 400, 600};
+const uint16_t WIN_STEP_MS[] = {500, 500, 500, 700};
+const uint16_t WIN_HOLD_MS = 2000;
+const uint8_t WIN_PHASES = sizeof(WIN_NOTES) + 1;
+
+template <class Io>
+class MemoryGame {
+public:
+  // melody holds 1-based button numbers
+  MemoryGame(Io &io, const int *melody, int length)
+    : io_(io), melody_(melody), length_(length) {}
+
+  void begin(unsigned long now) {
+    now_ = now;
+    dispatch(EV_RESET);
+  }
+
+  void tick(unsigned long now) {
+    now_ = now;
+    if (!armed_ || (long)(now - deadline_) < 0) return;
+    armed_ = false;
+    dispatch(sequenceDone() ? EV_SEQ_DONE : EV_TIMER);
+  }
+
+  // button is 0-based
+  void press(uint8_t button, unsigned long now) {
+    now_ = now;
+    dispatch(classifyPress(button));
+  }
+
+  void dispatch(Event ev) {
+    const Transition *t = &TABLE[state_][ev];
+    state_ = (State)GAME_READ(&t->next);
+    perform((Action)GAME_READ(&t->action));
+  }
+
+  State state() const { return state_; }
+  int turn() const { return turn_; }
+  int step() const { return step_; }
+
+private:
+  Event classifyPress(uint8_t button) const {
+    if (state_ != ST_AWAIT_INPUT) return EV_BUTTON;
+    if (button != melody_[step_] - 1) return EV_WRONG;
+    if (step_ < turn_) return EV_CORRECT;
+    return turn_ + 1 >= length_ ? EV_GAME_DONE : EV_TURN_DONE;
+  }
+
+  bool sequenceDone() const {
+    switch (state_) {
+      case ST_SHOW_GAP: return step_ > turn_;
+      case ST_FAIL:     return phase_ >= FAIL_PHASES;
+      case ST_WIN:      return phase_ >= WIN_PHASES;
+      default:          return false;
+    }
+  }
+
+  void arm(uint16_t ms) {
+    deadline_ = now_ + ms;
+    armed_ = true;
+  }
+
+  void announce() {
+    step_ = 0;
+    io_.sayTurn(turn_ + 1);
+    arm(STEP_DELAY);
+  }
+
+  void perform(Action a) {
+    switch (a) {
+      case A_NONE:
+        break;
+      case A_RESTART:
+        io_.silence();
+        io_.allLeds(false);
+        turn_ = 0;
+        announce();
+        break;
+      case A_NEXT_TURN:
+        turn_++;
+        announce();
+        break;
+      case A_NOTE_ON:
+        io_.noteOn(melody_[step_] - 1, NOTE_MS);
+        arm(NOTE_MS);
+        break;
+      case A_NOTE_OFF:
+        io_.noteOff(melody_[step_] - 1);
+        step_++;
+        arm(STEP_DELAY);
+        break;
+      case A_PROMPT:
+        step_ = 0;
+        armed_ = false;
+        io_.say("Your turn!");
+        break;
+      case A_ACCEPT:
+        io_.say("Correct!");
+        step_++;
+        break;
+      case A_LEVEL_UP:
+        io_.say("Correct!");
+        io_.say("Good! Next level...");
+        arm(LEVEL_PAUSE);
+        break;
+      case A_FAIL_START:
+        io_.say("Wrong! Try again.");
+        io_.say("FAIL! Restarting...");
+        phase_ = 0;
+        // fall through
+      case A_FAIL_STEP:
+        if (phase_ < FAIL_FLASHES * 2) {
+          bool on = (phase_ & 1) == 0;
+          io_.allLeds(on);
+          io_.toneFor(on ? 0 : 4, FAIL_TONE_MS);  // C / G
+          arm(FAIL_FLASH_MS);
+        } else {
+          io_.silence();
+          arm(FAIL_HOLD_MS);
+        }
+        phase_++;
+        break;
+      case A_WIN_START:
+        io_.say("Correct!");
+        io_.say("YOU WIN!");
+        io_.allLeds(true);
+        phase_ = 0;
+        // fall through
+      case A_WIN_STEP:
+        if (phase_ < sizeof(WIN_NOTES)) {
+          io_.toneFor(WIN_NOTES[phase_], WIN_TONE_MS[phase_]);
+          arm(WIN_STEP_MS[phase_]);
+        } else {
+          io_.silence();
+          io_.allLeds(false);
+          arm(WIN_HOLD_MS);
+        }
+        phase_++;
+        break;
+      default:
+        break;
+    }
+  }
+
+  Io &io_;
+  const int *melody_;
+  int length_;
+  State state_ = ST_START_TURN;
+  int turn_ = 0;
+  int step_ = 0;
+  uint8_t phase_ = 0;
+  bool armed_ = false;
+  unsigned long deadline_ = 0;
+  unsigned long now_ = 0;
+};
+
+}  // namespace game
+
+#endif  // GAME_FSM_H
@@ -0,0 +1,415 @@
+// Generated by tools/protogen/protogen.py from protocol/echome.schema.
+// Do not edit; change the schema and regenerate.
+
+// ================================================================
+// EchoMe serial protocol, firmware side.
+//
+// encode() writes one device line (without the line ending) into a
+// caller-owned buffer of at least <Message>::MAX_LEN bytes and returns
+// its length; nothing is allocated and nothing is written past cap.
+// decodeCommand() turns a received command line into a Command.
+// ================================================================
+
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+namespace proto {
+
+struct Writer {
+  char *buf;
+  uint8_t len;
+  uint8_t cap;
+
+  void ch(char c) { if (len < cap) buf[len++] = c; }
+  void lit(const char *s) { while (*s) ch(*s++); }
+
+  void u32(uint32_t v) {
+    char t[10];
+    uint8_t n = 0;
+    do { t[n++] = (char)('0' + v % 10); v /= 10; } while (v);
+    while (n) ch(t[--n]);
+  }
+
+  // Two decimals, rounded the way Print::print(float, 2) does
+  void cm(float v) {
+    if (isnan(v)) { lit("\xE2\x80\x94"); return; }
+    if (v < 0) { ch('-'); v = -v; }
+    v += 0.005f;
+    uint32_t whole = (uint32_t)v;
+    float rest = v - (float)whole;
+    u32(whole);
+    ch('.');
+    for (uint8_t i = 0; i < 2; i++) {
+      rest *= 10.0f;
+      uint8_t d = (uint8_t)rest;
+      ch((char)('0' + d));
+      rest -= d;
+    }
+    lit(" cm");
+  }
+
+  void str(const char *s, uint8_t max) {
+    for (uint8_t i = 0; i < max && s && s[i]; i++) ch(s[i]);
+  }
+
+  void u16s(const uint16_t *v, uint8_t n) {
+    for (uint8_t i = 0; i < n; i++) {
+      if (i) ch(',');
+      u32(v[i]);
+    }
+  }
+
+  void hex(const uint8_t *d, uint8_t n) {
+    static const char DIGITS[] = "0123456789abcdef";
+    for (uint8_t i = 0; i < n; i++) {
+      ch(DIGITS[d[i] >> 4]);
+      ch(DIGITS[d[i] & 0x0F]);
+    }
+  }
+};
+
+// READY EchoMe[ fw={fw:str:12}]
+struct Ready {
+  static const uint8_t MAX_LEN = 28;
+  bool hasFw;
+  const char *fw;
+};
+
+inline uint8_t encode(const Ready &m, char *buf, uint8_t cap) {
+  Writer w = {buf, 0, cap};
+  w.lit("READY EchoMe");
+  if (m.hasFw) {
+    w.lit(" fw=");
+    w.str(m.fw, 12);
+  }
+  return w.len;
+}
+
+// A: {a:cm} | B: {b:cm}[ | t={t:u32}]
+struct Distance {
+  static const uint8_t MAX_LEN = 44;
+  float a;
+  float b;
+  bool hasT;
+  uint32_t t;
+};
+
+inline uint8_t encode(const Distance &m, char *buf, uint8_t cap) {
+  Writer w = {buf, 0, cap};
+  w.lit("A: ");
+  w.cm(m.a);
+  w.lit(" | B: ");
+  w.cm(m.b);
+  if (m.hasT) {
+    w.lit(" | t=");
+    w.u32(m.t);
+  }
+  return w.len;
+}
+
+// SYNC t={t:u32}
+struct SyncReply {
+  static const uint8_t MAX_LEN = 17;
+  uint32_t t;
+};
+
+inline uint8_t encode(const SyncReply &m, char *buf, uint8_t cap) {
+  Writer w = {buf, 0, cap};
+  w.lit("SYNC t=");
+  w.u32(m.t);
+  return w.len;
+}
+
+// OK
+struct Ok {
+  static const uint8_t MAX_LEN = 2;
+};
+
+inline uint8_t encode(const Ok &m, char *buf, uint8_t cap) {
+  Writer w = {buf, 0, cap};
+  (void)m;
+  w.lit("OK");
+  return w.len;
+}
+
+// ERR {cmd:str:15}
+struct Err {
+  static const uint8_t MAX_LEN = 19;
+  const char *cmd;
+};
+
+inline uint8_t encode(const Err &m, char *buf, uint8_t cap) {
+  Writer w = {buf, 0, cap};
+  w.lit("ERR ");
+  w.str(m.cmd, 15);
+  return w.len;
+}
+
+// STALL task={task:str:8} at={at:u32}ms count={count:u8}
+struct Stall {
+  static const uint8_t MAX_LEN = 45;
+  const char *task;
+  uint32_t at;
+  uint8_t count;
+};
+
+inline uint8_t encode(const Stall &m, char *buf, uint8_t cap) {
+  Writer w = {buf, 0, cap};
+  w.lit("STALL task=");
+  w.str(m.task, 8);
+  w.lit(" at=");
+  w.u32(m.at);
+  w.lit("ms count=");
+  w.u32(m.count);
+  return w.len;
+}
+
+// LAT b={b:u8} n={n:u32} p50<={p50:str:3} p99<={p99:str:3} max={max:u32} h={h:u16s:12}
+struct Latency {
+  static const uint8_t MAX_LEN = 129;
+  uint8_t b;
+  uint32_t n;
+  const char *p50;
+  const char *p99;
+  uint32_t max;
+  const uint16_t *h;
+  uint8_t hCount;   // at most 12
+};
+
+inline uint8_t encode(const Latency &m, char *buf, uint8_t cap) {
+  Writer w = {buf, 0, cap};
+  w.lit("LAT b=");
+  w.u32(m.b);
+  w.lit(" n=");
+  w.u32(m.n);
+  w.lit(" p50<=");
+  w.str(m.p50, 3);
+  w.lit(" p99<=");
+  w.str(m.p99, 3);
+  w.lit(" max=");
+  w.u32(m.max);
+  w.lit(" h=");
+  w.u16s(m.h, m.hCount > 12 ? 12 : m.hCount);
+  return w.len;
+}
+
+// SND voices={voices:u8}/{slots:u8} max={max:u16}cy avg={avg:u16}cy load={load:u8}% budget={budget:u16}cy
+struct Sound {
+  static const uint8_t MAX_LEN = 67;
+  uint8_t voices;
+  uint8_t slots;
+  uint16_t max;
+  uint16_t avg;
+  uint8_t load;
+  uint16_t budget;
+};
+
+inline uint8_t encode(const Sound &m, char *buf, uint8_t cap) {
+  Writer w = {buf, 0, cap};
+  w.lit("SND voices=");
+  w.u32(m.voices);
+  w.lit("/");
+  w.u32(m.slots);
+  w.lit(" max=");
+  w.u32(m.max);
+  w.lit("cy avg=");
+  w.u32(m.avg);
+  w.lit("cy load=");
+  w.u32(m.load);
+  w.lit("% budget=");
+  w.u32(m.budget);
+  w.lit("cy");
+  return w.len;
+}
+
+// LED frames={frames:u16}/s skipped={skipped:u16}/s off={off:u32}us/s max={max:u16}us
+struct Strips {
+  static const uint8_t MAX_LEN = 65;
+  uint16_t frames;
+  uint16_t skipped;
+  uint32_t off;
+  uint16_t max;
+};
+
+inline uint8_t encode(const Strips &m, char *buf, uint8_t cap) {
+  Writer w = {buf, 0, cap};
+  w.lit("LED frames=");
+  w.u32(m.frames);
+  w.lit("/s skipped=");
+  w.u32(m.skipped);
+  w.lit("/s off=");
+  w.u32(m.off);
+  w.lit("us/s max=");
+  w.u32(m.max);
+  w.lit("us");
+  return w.len;
+}
+
+// ~{data:hex:48}
+struct Record {
+  static const uint8_t MAX_LEN = 97;
+  const uint8_t *data;
+  uint8_t dataLen;   // at most 48
+};
+
+inline uint8_t encode(const Record &m, char *buf, uint8_t cap) {
+  Writer w = {buf, 0, cap};
+  w.lit("~");
+  w.hex(m.data, m.dataLen > 48 ? 48 : m.dataLen);
+  return w.len;
+}
+
+// CAL {sensor:str:1} base={base:u16}mm noise={noise:u16}mm on={on:u16}mm off={off:u16}mm src={src:str:7}
+struct Calibration {
+  static const uint8_t MAX_LEN = 67;
+  const char *sensor;
+  uint16_t base;
+  uint16_t noise;
+  uint16_t on;
+  uint16_t off;
+  const char *src;
+};
+
+inline uint8_t encode(const Calibration &m, char *buf, uint8_t cap) {
+  Writer w = {buf, 0, cap};
+  w.lit("CAL ");
+  w.str(m.sensor, 1);
+  w.lit(" base=");
+  w.u32(m.base);
+  w.lit("mm noise=");
+  w.u32(m.noise);
+  w.lit("mm on=");
+  w.u32(m.on);
+  w.lit("mm off=");
+  w.u32(m.off);
+  w.lit("mm src=");
+  w.str(m.src, 7);
+  return w.len;
+}
+
+// Turn {n:u8}
+struct Turn {
+  static const uint8_t MAX_LEN = 8;
+  uint8_t n;
+};
+
+inline uint8_t encode(const Turn &m, char *buf, uint8_t cap) {
+  Writer w = {buf, 0, cap};
+  w.lit("Turn ");
+  w.u32(m.n);
+  return w.len;
+}
+
+// Your turn!
+struct YourTurn {
+  static const uint8_t MAX_LEN = 10;
+};
+
+inline uint8_t encode(const YourTurn &m, char *buf, uint8_t cap) {
+  Writer w = {buf, 0, cap};
+  (void)m;
+  w.lit("Your turn!");
+  return w.len;
+}
+
+// Correct!
+struct Correct {
+  static const uint8_t MAX_LEN = 8;
+};
+
+inline uint8_t encode(const Correct &m, char *buf, uint8_t cap) {
+  Writer w = {buf, 0, cap};
+  (void)m;
+  w.lit("Correct!");
+  return w.len;
+}
+
+// Good! Next level...
+struct NextLevel {
+  static const uint8_t MAX_LEN = 19;
+};
+
+inline uint8_t encode(const NextLevel &m, char *buf, uint8_t cap) {
+  Writer w = {buf, 0, cap};
+  (void)m;
+  w.lit("Good! Next level...");
+  return w.len;
+}
+
+// Wrong! Try again.
+struct Wrong {
+  static const uint8_t MAX_LEN = 17;
+};
+
+inline uint8_t encode(const Wrong &m, char *buf, uint8_t cap) {
+  Writer w = {buf, 0, cap};
+  (void)m;
+  w.lit("Wrong! Try again.");
+  return w.len;
+}
+
+// FAIL! Restarting...
+struct Fail {
+  static const uint8_t MAX_LEN = 19;
+};
+
+inline uint8_t encode(const Fail &m, char *buf, uint8_t cap) {
+  Writer w = {buf, 0, cap};
+  (void)m;
+  w.lit("FAIL! Restarting...");
+  return w.len;
+}
+
+// YOU WIN!
+struct Win {
+  static const uint8_t MAX_LEN = 8;
+};
+
+inline uint8_t encode(const Win &m, char *buf, uint8_t cap) {
+  Writer w = {buf, 0, cap};
+  (void)m;
+  w.lit("YOU WIN!");
+  return w.len;
+}
+
+enum Command : uint8_t {
+  CMD_UNKNOWN,
+  CMD_LAT_DUMP,   // LAT?
+  CMD_LAT_CLEAR,   // LAT0
+  CMD_REC_START,   // REC1
+  CMD_REC_STOP,   // REC0
+  CMD_STREAM_ON,   // STREAM1
+  CMD_STREAM_OFF,   // STREAM0
+  CMD_SYNC,   // SYNC
+  CMD_IDENTIFY,   // ID?
+  CMD_CALIBRATE,   // CAL
+  CMD_CAL_DUMP,   // CAL?
+  CMD_STRIP_DUMP,   // LED?
+  CMD_SOUND_DUMP,   // SND?
+  CMD_SOUND_CLEAR,   // SND0
+};
+
+inline Command decodeCommand(const char *line) {
+  if (strcmp(line, "LAT?") == 0) return CMD_LAT_DUMP;
+  if (strcmp(line, "LAT0") == 0) return CMD_LAT_CLEAR;
+  if (strcmp(line, "REC1") == 0) return CMD_REC_START;
+  if (strcmp(line, "REC0") == 0) return CMD_REC_STOP;
+  if (strcmp(line, "STREAM1") == 0) return CMD_STREAM_ON;
+  if (strcmp(line, "STREAM0") == 0) return CMD_STREAM_OFF;
+  if (strcmp(line, "SYNC") == 0) return CMD_SYNC;
+  if (strcmp(line, "ID?") == 0) return CMD_IDENTIFY;
+  if (strcmp(line, "CAL") == 0) return CMD_CALIBRATE;
+  if (strcmp(line, "CAL?") == 0) return CMD_CAL_DUMP;
+  if (strcmp(line, "LED?") == 0) return CMD_STRIP_DUMP;
+  if (strcmp(line, "SND?") == 0) return CMD_SOUND_DUMP;
+  if (strcmp(line, "SND0") == 0) return CMD_SOUND_CLEAR;
+  return CMD_UNKNOWN;
+}
+
+}  // namespace proto
+
+#endif  // PROTOCOL_H
@@ -0,0 +1,334 @@
+/*
+ * File:     synth.h
+ * Company:  University of Canterbury Group 5
+ */
+
+// ================================================================
+// Polyphonic wavetable synthesizer on Timer2, replacing tone().
+//
+// A compare-match interrupt at SAMPLE_HZ steps up to VOICES phase
+// accumulators through a flash wavetable, scales each by its envelope
+// and mixes them. The speaker pin (A5) has no hardware PWM and every
+// PWM pin is taken, so the mix leaves as first-order pulse-density
+// modulation: the pin's duty cycle follows the waveform. The carrier is
+// not above hearing: at mid-level the pin toggles every sample, a
+// 15.6 kHz square that younger listeners can hear under a note.
+// Envelopes and note lengths step inside the same ISR every CONTROL_DIV
+// samples, so a note costs nothing in loop() after noteOn(). The
+// interrupt only runs while a voice sounds, so there is no carrier
+// between notes.
+//
+// Cycle budget: one sample is CYCLES_PER_SAMPLE CPU cycles. The ISR
+// body reads TCNT2 first and last (so the register pushes before it and
+// the pops and reti after it are not included, nor a late start after a
+// strip update) and keeps the worst case and the average; "SND?" reports
+// them next to ISR_BUDGET_CYCLES. TCNT2 restarts at every compare match,
+// so OCF2A, set again by a match during the body, tells a wrap apart: a
+// body that crossed one match adds a sample's ticks, and one that ran a
+// whole sample pins the worst case at OVERRUN_TICKS (2040cy). Past two
+// samples the count is lost again, but by then the sound is broken.
+// The budget is a target, not a measured figure: check it on a board
+// with SND? while a chord plays, or count __vector_7 in avr-objdump -d
+// of the build; hostsim's TCNT2 always reads 0. Echo timing uses
+// pulseInLong(), which is not thrown off by interrupts the way
+// pulseIn()'s counting loop is.
+//
+// Strip updates turn interrupts off for a few hundred microseconds, and
+// the compare matches in that time collapse into one. skip() is told
+// how long the gap was and moves the phases and the control clock on by
+// the samples that were lost, so pitch and note lengths do not drift
+// with the animation's frame rate.
+// ================================================================
+
+#ifndef SYNTH_H
+#define SYNTH_H
+
+#include <Arduino.h>
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#define SYNTH_TABLE_ATTR PROGMEM
+#define SYNTH_READ(p) ((int8_t)pgm_read_byte(p))
+#else
+#define SYNTH_TABLE_ATTR
+#define SYNTH_READ(p) (*(p))
+// hostsim reports notes in its trace
+void hostsimNote(uint8_t key, unsigned int hz, unsigned long ms);
+#endif
+
+namespace synth {
+
+const uint8_t VOICES = 3;
+const uint8_t KEY_NONE = 0xFF;
+
+// Timer2 in CTC mode, clk/8: 16 MHz / 8 / (TIMER_TOP + 1) = 31250 Hz
+const uint8_t TIMER_TOP = 63;
+const uint16_t SAMPLE_HZ = 31250;
+const uint16_t CYCLES_PER_SAMPLE = 512;
+const uint8_t US_PER_SAMPLE = 32;
+const uint8_t CYCLES_PER_TICK = 8;       // TCNT2 counts at clk/8
+const uint16_t ISR_BUDGET_CYCLES = 160;  // allowed worst case (target, unmeasured)
+const uint8_t OVERRUN_TICKS = 0xFF;      // worst case once a body ran a whole sample or more
+
+// Envelopes and note lengths advance every CONTROL_DIV samples (2.048 ms)
+const uint8_t CONTROL_DIV = 64;
+const uint8_t ATTACK_STEP = 64;     // 0 -> 255 in 4 ticks
+const uint8_t DECAY_STEP = 1;       // then sag towards SUSTAIN_LEVEL
+const uint8_t SUSTAIN_LEVEL = 170;
+const uint8_t RELEASE_STEP = 12;    // 255 -> 0 in about 45 ms
+
+// One cycle of a soft organ tone: fundamental plus 2nd and 3rd harmonics
+const int8_t WAVE[64] SYNTH_TABLE_ATTR = {
+    18,   38,   58,   75,   90,  101,  110,  115,  117,  116,  113,  108,  101,   93,   86,   78,
+    71,   66,   61,   58,   55,   54,   54,   53,   53,   52,   50,   48,   44,   39,   33,   26,
+    18,    9,   -1,  -10,  -19,  -28,  -37,  -45,  -53,  -60,  -67,  -74,  -80,  -87,  -93, -100,
+  -106, -112, -118, -122, -126, -127, -126, -123, -117, -108,  -96,  -82,  -65,  -46,  -25,   -4,
+};
+
+enum Stage : uint8_t {
+  STAGE_OFF,
+  STAGE_ATTACK,
+  STAGE_DECAY,     // held: sags to the sustain level until ticksLeft runs out
+  STAGE_RELEASE
+};
+
+struct Voice {
+  uint16_t phase;
+  uint16_t step;        // phase increment per sample: hz * 65536 / SAMPLE_HZ
+  uint16_t ticksLeft;   // control ticks until release
+  uint8_t level;        // envelope, 0..255
+  uint8_t stage;
+  uint8_t key;          // caller's id for the note (button index)
+  uint8_t started;      // start order, for stealing the oldest voice
+};
+
+struct Stats {
+  uint8_t voices;       // sounding now
+  uint16_t maxCycles;   // worst ISR, compare match to exit
+  uint16_t avgCycles;
+};
+
+class Synth {
+public:
+  void begin(uint8_t pin) {
+    pinMode(pin, OUTPUT);
+    digitalWrite(pin, LOW);
+    out_ = portOutputRegister(digitalPinToPort(pin));
+    mask_ = digitalPinToBitMask(pin);
+    for (uint8_t i = 0; i < VOICES; i++) {
+      voices_[i].stage = STAGE_OFF;
+      voices_[i].key = KEY_NONE;
+    }
+    TIMSK2 = 0;
+    TCCR2A = _BV(WGM21);   // CTC, no compare outputs: D3/D11 stay plain pins
+    TCCR2B = _BV(CS21);    // clk/8
+    OCR2A = TIMER_TOP;
+  }
+
+  // Starts (or extends) the note for key. A key that is already
+  // sounding keeps its voice, so repeated calls while a button is held
+  // just lengthen it. With no free voice the oldest is taken over.
+  void noteOn(uint8_t key, uint16_t hz, uint16_t ms) {
+    uint16_t step = (uint16_t)(((uint32_t)hz << 16) / SAMPLE_HZ);
+    uint16_t ticks = (uint16_t)(((uint32_t)ms * 125) >> 8);   // ms / 2.048
+    if (ticks == 0) ticks = 1;
+
+    uint8_t sreg = SREG;
+    cli();
+    Voice *v = find(key);
+    if (v == 0) {
+      v = take();
+      v->key = key;
+      v->started = ++starts_;
+      v->stage = STAGE_ATTACK;   // from its current level: no click
+    } else if (v->stage == STAGE_RELEASE) {
+      v->stage = STAGE_ATTACK;
+    }
+    v->step = step;
+    v->ticksLeft = ticks;
+    if (!(TIMSK2 & _BV(OCIE2A))) {
+      TCNT2 = 0;
+      ctrl_ = CONTROL_DIV;
+      TIMSK2 |= _BV(OCIE2A);
+    }
+    SREG = sreg;
+#ifndef __AVR__
+    hostsimNote(key, hz, ms);
+#endif
+  }
+
+  void noteOff(uint8_t key) {
+    uint8_t sreg = SREG;
+    cli();
+    Voice *v = find(key);
+    if (v != 0) v->stage = STAGE_RELEASE;
+    SREG = sreg;
+#ifndef __AVR__
+    if (v != 0) hostsimNote(key, 0, 0);
+#endif
+  }
+
+  // Fades everything out (a quick release, not a cut, so no click)
+  void allOff() {
+    uint8_t sreg = SREG;
+    cli();
+    for (uint8_t i = 0; i < VOICES; i++) {
+      if (voices_[i].stage != STAGE_OFF) voices_[i].stage = STAGE_RELEASE;
+    }
+    SREG = sreg;
+  }
+
+  uint8_t activeVoices() const {
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < VOICES; i++) {
+      if (voices_[i].stage != STAGE_OFF) n++;
+    }
+    return n;
+  }
+
+  // Interrupts were off for `us`; the one pending match has already run
+  void skip(unsigned long us) {
+    if (us < 2 * US_PER_SAMPLE) return;
+    uint16_t lost = (uint16_t)(us / US_PER_SAMPLE) - 1;
+    uint8_t sreg = SREG;
+    cli();
+    if (TIMSK2 & _BV(OCIE2A)) {
+      for (uint8_t i = 0; i < VOICES; i++) voices_[i].phase += voices_[i].step * lost;
+      while (lost >= ctrl_ && (TIMSK2 & _BV(OCIE2A))) {
+        lost -= ctrl_;
+        ctrl_ = CONTROL_DIV;
+        control();
+      }
+      if (lost < ctrl_) ctrl_ -= lost;
+    }
+    SREG = sreg;
+  }
+
+  // Timer2 compare-match ISR body
+  void render() {
+    uint8_t t0 = TCNT2;
+    int16_t mix = 0;
+    Voice *v = voices_;
+    for (uint8_t i = 0; i < VOICES; i++, v++) {
+      if (v->stage == STAGE_OFF) continue;
+      v->phase += v->step;
+      int8_t s = SYNTH_READ(&WAVE[v->phase >> 10]);
+      mix += (int16_t)(s * v->level) >> 8;
+    }
+
+    // Pulse-density output: one voice at full level swings the duty
+    // between 1/4 and 3/4, chords may clip
+    int16_t x = mix + 256;
+    if (x < 0) x = 0;
+    else if (x > 511) x = 511;
+    acc_ += x;
+    if (acc_ >= 512) {
+      acc_ -= 512;
+      *out_ |= mask_;
+    } else {
+      *out_ &= ~mask_;
+    }
+
+    if (--ctrl_ == 0) {
+      ctrl_ = CONTROL_DIV;
+      control();
+    }
+
+    uint8_t t1 = TCNT2;
+    uint8_t t = t1 - t0;   // ticks this body took
+    if (TIFR2 & _BV(OCF2A)) {   // read after TCNT2, so a wrap in between still shows
+      t = t1 < t0 ? (uint8_t)(t1 + TIMER_TOP + 1 - t0) : OVERRUN_TICKS;
+    }
+    if (t > isrMaxTicks_) isrMaxTicks_ = t;
+    isrTicks_ += t;
+    isrCount_++;
+  }
+
+  // ISR cost since the last clearStats(); the load while sound plays
+  // is avgCycles / CYCLES_PER_SAMPLE
+  Stats stats() const {
+    uint8_t sreg = SREG;
+    cli();
+    uint8_t maxTicks = isrMaxTicks_;
+    uint32_t ticks = isrTicks_, count = isrCount_;
+    SREG = sreg;
+
+    Stats st;
+    st.voices = activeVoices();
+    st.maxCycles = (uint16_t)maxTicks * CYCLES_PER_TICK;
+    st.avgCycles = count ? (uint16_t)(ticks * CYCLES_PER_TICK / count) : 0;
+    return st;
+  }
+
+  void clearStats() {
+    uint8_t sreg = SREG;
+    cli();
+    isrMaxTicks_ = 0;
+    isrTicks_ = 0;
+    isrCount_ = 0;
+    SREG = sreg;
+  }
+
+private:
+  Voice *find(uint8_t key) {
+    for (uint8_t i = 0; i < VOICES; i++) {
+      if (voices_[i].key == key && voices_[i].stage != STAGE_OFF) return &voices_[i];
+    }
+    return 0;
+  }
+
+  // A free voice, else the one that started longest ago
+  Voice *take() {
+    Voice *oldest = &voices_[0];
+    for (uint8_t i = 0; i < VOICES; i++) {
+      if (voices_[i].stage == STAGE_OFF) return &voices_[i];
+      if ((uint8_t)(starts_ - voices_[i].started) > (uint8_t)(starts_ - oldest->started)) oldest = &voices_[i];
+    }
+    return oldest;
+  }
+
+  // Envelopes and note lengths; stops the interrupt once all is quiet
+  void control() {
+    bool any = false;
+    Voice *v = voices_;
+    for (uint8_t i = 0; i < VOICES; i++, v++) {
+      switch (v->stage) {
+        case STAGE_ATTACK:
+          if (v->level > 255 - ATTACK_STEP) { v->level = 255; v->stage = STAGE_DECAY; }
+          else v->level += ATTACK_STEP;
+          break;
+        case STAGE_DECAY:
+          if (v->level > SUSTAIN_LEVEL) v->level -= DECAY_STEP;
+          break;
+        case STAGE_RELEASE:
+          if (v->level > RELEASE_STEP) v->level -= RELEASE_STEP;
+          else { v->level = 0; v->stage = STAGE_OFF; v->key = KEY_NONE; }
+          break;
+        default:
+          break;
+      }
+      if ((v->stage == STAGE_ATTACK || v->stage == STAGE_DECAY) && --v->ticksLeft == 0) {
+        v->stage = STAGE_RELEASE;
+      }
+      if (v->stage != STAGE_OFF) any = true;
+    }
+    if (!any) {
+      TIMSK2 &= ~_BV(OCIE2A);
+      *out_ &= ~mask_;
+    }
+  }
+
+  Voice voices_[VOICES];
+  volatile uint8_t *out_;
+  uint8_t mask_;
+  uint16_t acc_ = 0;
+  uint8_t ctrl_ = CONTROL_DIV;
+  uint8_t starts_ = 0;
+  uint8_t isrMaxTicks_ = 0;
+  uint32_t isrTicks_ = 0;
+  uint32_t isrCount_ = 0;
+};
+
+}  // namespace synth
+
+#endif  // SYNTH_H
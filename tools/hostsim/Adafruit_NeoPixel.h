@@ -0,0 +1,50 @@
+/*
+ * File:     Adafruit_NeoPixel.h (host simulation)
+ * Company:  University of Canterbury Group 5
+ */
+
+// Records pixels in memory; show() reports the frame to hostsim and
+// holds the virtual clock with interrupts off as long as the real one
+
+#ifndef HOSTSIM_ADAFRUIT_NEOPIXEL_H
+#define HOSTSIM_ADAFRUIT_NEOPIXEL_H
+
+#include "Arduino.h"
+
+#define NEO_GRB 0x52
+#define NEO_KHZ800 0x0000
+
+class Adafruit_NeoPixel {
+public:
+  Adafruit_NeoPixel(uint16_t n, int16_t pin, uint16_t type)
+    : n_(n > MAX_PIXELS ? MAX_PIXELS : n), pin_(pin) { (void)type; }
+  Adafruit_NeoPixel() : n_(0), pin_(-1) {}
+
+  void updateLength(uint16_t n) { n_ = n > MAX_PIXELS ? MAX_PIXELS : n; }
+  void updateType(uint16_t type) { (void)type; }
+  void setPin(int16_t pin) { pin_ = pin; }
+
+  void begin() {}
+  void show();
+  void setBrightness(uint8_t b) { brightness_ = b; }
+  void setPixelColor(uint16_t i, uint32_t c) { if (i < n_) px_[i] = c; }
+  void clear() { for (uint16_t i = 0; i < n_; i++) px_[i] = 0; }
+  uint32_t getPixelColor(uint16_t i) const { return i < n_ ? px_[i] : 0; }
+  uint16_t numPixels() const { return n_; }
+  int16_t getPin() const { return pin_; }
+
+  static uint32_t Color(uint8_t r, uint8_t g, uint8_t b) {
+    return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+  }
+
+private:
+  static const uint16_t MAX_PIXELS = 64;
+  uint16_t n_;
+  int16_t pin_;
+  uint8_t brightness_ = 255;
+  uint32_t px_[MAX_PIXELS] = {0};
+  uint32_t shown_[MAX_PIXELS] = {0};
+  bool everShown_ = false;
+};
+
+#endif  // HOSTSIM_ADAFRUIT_NEOPIXEL_H
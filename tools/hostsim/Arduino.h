@@ -0,0 +1,134 @@
+/*
+ * File:     Arduino.h (host simulation)
+ * Company:  University of Canterbury Group 5
+ */
+
+// ================================================================
+// Just enough of the Arduino core for firmware.c to build and run on a
+// PC. Time is virtual (see hostsim.cpp) and pins/echoes are fed from a
+// recorded input log. Note: AVR double is 32-bit, here it is 64-bit,
+// so breathing colours can differ by a step from the real device.
+// ================================================================
+
+#ifndef HOSTSIM_ARDUINO_H
+#define HOSTSIM_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define A6 20
+#define A7 21
+#define NUM_DIGITAL_PINS 22
+
+#ifndef PI
+#define PI 3.1415926535897932384626433832795
+#endif
+#define DEC 10
+#define HEX 16
+
+#define PROGMEM
+#define F(s) (s)
+#define _BV(b) (1u << (b))
+
+// --- Timing / pins ---
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout = 1000000UL);
+unsigned long pulseInLong(uint8_t pin, uint8_t state, unsigned long timeout = 1000000UL);
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+
+template <class T, class U>
+auto max(T a, U b) -> decltype(a + b) { return a > b ? a : b; }
+template <class T, class U>
+auto min(T a, U b) -> decltype(a + b) { return a < b ? a : b; }
+
+// --- AVR registers the sketch touches ---
+extern uint8_t MCUSR;
+extern uint8_t SREG;
+#define WDRF 3
+#define BORF 2
+#define EXTRF 1
+#define PORF 0
+
+extern volatile uint8_t PCICR;
+extern volatile uint8_t PCMSK0, PCMSK1, PCMSK2;
+#define digitalPinToPCICR(p) (&PCICR)
+#define digitalPinToPCICRbit(p) ((p) < 8 ? 2 : (p) < 14 ? 0 : 1)
+#define digitalPinToPCMSK(p) ((p) < 8 ? &PCMSK2 : (p) < 14 ? &PCMSK0 : &PCMSK1)
+#define digitalPinToPCMSKbit(p) ((p) < 8 ? (p) : (p) < 14 ? (p) - 8 : (p) - 14)
+
+// One fake input register per pin, bit 0 = level
+extern volatile uint8_t hostsimPinLevel[NUM_DIGITAL_PINS];
+#define digitalPinToPort(p) (p)
+#define digitalPinToBitMask(p) (1)
+#define portInputRegister(port) (&hostsimPinLevel[(port)])
+// ...and one output register, written only by the synth ISR
+extern volatile uint8_t hostsimPortOut[NUM_DIGITAL_PINS];
+#define portOutputRegister(port) (&hostsimPortOut[(port)])
+
+// Timer2 (synth.h). TIMER2_COMPA_vect runs every 32 us of virtual time
+// while OCIE2A is set; TCNT2 and TIFR2 read 0, so the ISR cycle stats stay 0.
+extern volatile uint8_t TCCR2A, TCCR2B, OCR2A, TIMSK2, TCNT2, TIFR2;
+#define WGM21 1
+#define CS21 1
+#define OCIE2A 1
+#define OCF2A 1
+inline uint8_t pgm_read_byte(const void *p) { return *(const uint8_t *)p; }
+
+#define ISR(vector) extern "C" void vector()
+inline void cli() {}
+inline void sei() {}
+
+// --- Serial ---
+class HardwareSerial {
+public:
+  void begin(unsigned long) {}
+  int available();
+  int read();
+  size_t write(uint8_t c);
+  size_t write(const char *s);
+  size_t write(const uint8_t *buf, size_t n) { size_t k = 0; while (k < n) write(buf[k++]); return k; }
+
+  size_t print(const char *s);
+  size_t print(char c);
+  size_t print(unsigned char n, int base = DEC) { return print((unsigned long)n, base); }
+  size_t print(int n, int base = DEC) { return print((long)n, base); }
+  size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+  size_t print(long n, int base = DEC);
+  size_t print(unsigned long n, int base = DEC);
+  size_t print(double n, int digits = 2);
+
+  size_t println() { return write('\n'); }
+  template <class T>
+  size_t println(T v) { size_t n = print(v); return n + println(); }
+  template <class T>
+  size_t println(T v, int fmt) { size_t n = print(v, fmt); return n + println(); }
+  void flush() {}
+};
+
+extern HardwareSerial Serial;
+
+#endif  // HOSTSIM_ARDUINO_H
@@ -0,0 +1,52 @@
+/*
+ * File:     EEPROM.h (host simulation)
+ * Company:  University of Canterbury Group 5
+ */
+
+// ================================================================
+// The ATmega328P's 1 KB EEPROM as a RAM array, erased (0xFF) at every
+// start, so a replay always begins as a board that was never
+// calibrated. Same get/put/update calls as the Arduino library.
+// ================================================================
+
+#ifndef HOSTSIM_EEPROM_H
+#define HOSTSIM_EEPROM_H
+
+#include <stdint.h>
+#include <string.h>
+
+class EEPROMClass {
+public:
+  uint8_t read(int addr) { return cells()[addr]; }
+  void write(int addr, uint8_t v) { cells()[addr] = v; }
+  void update(int addr, uint8_t v) { if (read(addr) != v) write(addr, v); }
+  uint16_t length() { return SIZE; }
+
+  template <class T>
+  T &get(int addr, T &t) {
+    memcpy(&t, cells() + addr, sizeof(T));
+    return t;
+  }
+  template <class T>
+  const T &put(int addr, const T &t) {
+    const uint8_t *p = (const uint8_t *)&t;
+    for (size_t i = 0; i < sizeof(T); i++) update(addr + (int)i, p[i]);
+    return t;
+  }
+
+private:
+  static const uint16_t SIZE = 1024;
+  static uint8_t *cells() {
+    static uint8_t mem[SIZE];
+    static bool erased = false;
+    if (!erased) {
+      memset(mem, 0xFF, sizeof(mem));
+      erased = true;
+    }
+    return mem;
+  }
+};
+
+static EEPROMClass EEPROM;
+
+#endif  // HOSTSIM_EEPROM_H
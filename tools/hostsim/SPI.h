@@ -0,0 +1,40 @@
+/*
+ * File:     SPI.h (host simulation)
+ * Company:  University of Canterbury Group 5
+ */
+
+// ================================================================
+// The SPI bus as board.h's ShiftIo uses it (-DBOARD_XL): each
+// transaction reads the 74HC165 button chain and writes the 74HC595
+// LED chain. hostsim answers with the replayed buttons, nearest chip's
+// byte first and pressed = 0, and traces the LED bytes it is sent.
+// ================================================================
+
+#ifndef HOSTSIM_SPI_H
+#define HOSTSIM_SPI_H
+
+#include <stdint.h>
+
+#define MSBFIRST 1
+#define SPI_MODE0 0
+
+// In hostsim.cpp
+void hostsimSpiBegin();
+uint8_t hostsimSpiTransfer(uint8_t out);
+void hostsimSpiEnd();
+
+struct SPISettings {
+  SPISettings(uint32_t, uint8_t, uint8_t) {}
+};
+
+class SPIClass {
+public:
+  void begin() {}
+  void beginTransaction(SPISettings) { hostsimSpiBegin(); }
+  uint8_t transfer(uint8_t out) { return hostsimSpiTransfer(out); }
+  void endTransaction() { hostsimSpiEnd(); }
+};
+
+extern SPIClass SPI;
+
+#endif  // HOSTSIM_SPI_H
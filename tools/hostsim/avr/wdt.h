@@ -0,0 +1,18 @@
+// Host simulation: the watchdog is never armed off-target
+#ifndef HOSTSIM_AVR_WDT_H
+#define HOSTSIM_AVR_WDT_H
+
+#define WDTO_15MS 0
+#define WDTO_30MS 1
+#define WDTO_60MS 2
+#define WDTO_120MS 3
+#define WDTO_250MS 4
+#define WDTO_500MS 5
+#define WDTO_1S 6
+#define WDTO_2S 7
+
+inline void wdt_enable(int) {}
+inline void wdt_disable() {}
+inline void wdt_reset() {}
+
+#endif  // HOSTSIM_AVR_WDT_H
@@ -0,0 +1,151 @@
+/*
+ * File:     game_check.cpp
+ * Company:  University of Canterbury Group 5
+ */
+
+// ================================================================
+// Walks every (state, event) pair of the memory game in game_fsm.h.
+//
+// Build and run (from the repository root):
+//   g++ -std=gnu++11 -O2 -I. tools/hostsim/game_check.cpp -o game-check
+//   ./game-check
+//
+// For each state a fresh game is driven there through real ticks and
+// presses (two-note melody C D), then one event is dispatched. The
+// next state and the Io calls the action made are compared with the
+// EXPECT table below, which is written out by hand from the game's
+// rules rather than derived from game::TABLE. Exits 1 on a mismatch.
+// ================================================================
+
+#include <stdio.h>
+#include <string>
+
+#include "game_fsm.h"
+
+using namespace game;
+
+// Records every Io call as text, e.g. "noteOn(0,300) say(Correct!)"
+struct LogIo {
+  std::string log;
+
+  void add(const std::string &s) { log += log.empty() ? s : " " + s; }
+  void noteOn(uint8_t b, uint16_t ms) { add("noteOn(" + std::to_string(b) + "," + std::to_string(ms) + ")"); }
+  void noteOff(uint8_t b) { add("noteOff(" + std::to_string(b) + ")"); }
+  void toneFor(uint8_t b, uint16_t ms) { add("toneFor(" + std::to_string(b) + "," + std::to_string(ms) + ")"); }
+  void allLeds(bool on) { add(on ? "allLeds(1)" : "allLeds(0)"); }
+  void silence() { add("silence"); }
+  void say(const char *msg) { add(std::string("say(") + msg + ")"); }
+  void sayTurn(int t) { add("turn(" + std::to_string(t) + ")"); }
+};
+
+const int MELODY[] = {1, 2};
+const int MELODY_LENGTH = 2;
+
+typedef MemoryGame<LogIo> Game;
+
+const char *const STATE_NAMES[ST_COUNT] = {
+  "START_TURN", "SHOW_NOTE", "SHOW_GAP", "AWAIT_INPUT", "LEVEL_UP", "FAIL", "WIN"
+};
+const char *const EVENT_NAMES[EV_COUNT] = {
+  "TIMER", "SEQ_DONE", "CORRECT", "TURN_DONE", "GAME_DONE", "WRONG", "BUTTON", "RESET"
+};
+
+struct Expect {
+  State next;
+  const char *io;
+};
+
+// Io output of each action in the states reached by reach() below
+#define RESTART   "silence allLeds(0) turn(1)"
+#define WIN_START "say(Correct!) say(YOU WIN!) allLeds(1) toneFor(2,400)"
+#define FAIL_START "say(Wrong! Try again.) say(FAIL! Restarting...) allLeds(1) toneFor(0,300)"
+
+const Expect EXPECT[ST_COUNT][EV_COUNT] = {
+  /* START_TURN (turn 1, step 0) */ {
+    {ST_SHOW_NOTE, "noteOn(0,300)"}, {ST_START_TURN, ""}, {ST_START_TURN, ""}, {ST_START_TURN, ""},
+    {ST_START_TURN, ""}, {ST_START_TURN, ""}, {ST_START_TURN, ""}, {ST_START_TURN, RESTART}},
+  /* SHOW_NOTE (turn 1, step 0) */ {
+    {ST_SHOW_GAP, "noteOff(0)"}, {ST_SHOW_NOTE, ""}, {ST_SHOW_NOTE, ""}, {ST_SHOW_NOTE, ""},
+    {ST_SHOW_NOTE, ""}, {ST_SHOW_NOTE, ""}, {ST_SHOW_NOTE, ""}, {ST_START_TURN, RESTART}},
+  /* SHOW_GAP (turn 1, step 1) */ {
+    {ST_SHOW_NOTE, "noteOn(1,300)"}, {ST_AWAIT_INPUT, "say(Your turn!)"}, {ST_SHOW_GAP, ""}, {ST_SHOW_GAP, ""},
+    {ST_SHOW_GAP, ""}, {ST_SHOW_GAP, ""}, {ST_SHOW_GAP, ""}, {ST_START_TURN, RESTART}},
+  /* AWAIT_INPUT (turn 1, step 0) */ {
+    {ST_AWAIT_INPUT, ""}, {ST_AWAIT_INPUT, ""}, {ST_AWAIT_INPUT, "say(Correct!)"},
+    {ST_LEVEL_UP, "say(Correct!) say(Good! Next level...)"}, {ST_WIN, WIN_START},
+    {ST_FAIL, FAIL_START}, {ST_AWAIT_INPUT, ""}, {ST_START_TURN, RESTART}},
+  /* LEVEL_UP (after turn 1) */ {
+    {ST_START_TURN, "turn(2)"}, {ST_LEVEL_UP, ""}, {ST_LEVEL_UP, ""}, {ST_LEVEL_UP, ""},
+    {ST_LEVEL_UP, ""}, {ST_LEVEL_UP, ""}, {ST_LEVEL_UP, ""}, {ST_START_TURN, RESTART}},
+  /* FAIL (first flash on) */ {
+    {ST_FAIL, "allLeds(0) toneFor(4,300)"}, {ST_START_TURN, RESTART}, {ST_FAIL, ""}, {ST_FAIL, ""},
+    {ST_FAIL, ""}, {ST_FAIL, ""}, {ST_FAIL, ""}, {ST_START_TURN, RESTART}},
+  /* WIN (first note) */ {
+    {ST_WIN, "toneFor(4,400)"}, {ST_START_TURN, RESTART}, {ST_WIN, ""}, {ST_WIN, ""},
+    {ST_WIN, ""}, {ST_WIN, ""}, {ST_WIN, ""}, {ST_START_TURN, RESTART}},
+};
+
+int failures = 0;
+
+void check(bool ok, const char *what, const std::string &got, const std::string &want) {
+  if (ok) return;
+  failures++;
+  printf("FAIL %s: got \"%s\", want \"%s\"\n", what, got.c_str(), want.c_str());
+}
+
+// Steps the game's clock forward until the pending timer fires
+unsigned long fire(Game &g, unsigned long now) {
+  State s = g.state();
+  int step = g.step();
+  while (g.state() == s && g.step() == step && now < 100000) g.tick(++now);
+  return now;
+}
+
+// Drives a fresh game into `target` the way play would
+unsigned long reach(Game &g, State target) {
+  unsigned long now = 0;
+  g.begin(now);                                    // START_TURN, turn 1
+  if (target == ST_START_TURN) return now;
+  now = fire(g, now);                              // SHOW_NOTE, note 0
+  if (target == ST_SHOW_NOTE) return now;
+  now = fire(g, now);                              // SHOW_GAP, step 1
+  if (target == ST_SHOW_GAP) return now;
+  now = fire(g, now);                              // AWAIT_INPUT
+  if (target == ST_AWAIT_INPUT) return now;
+  if (target == ST_FAIL) {
+    g.press(1, now);                               // wrong: melody starts with C
+    return now;
+  }
+  g.press(0, now);                                 // LEVEL_UP
+  if (target == ST_LEVEL_UP) return now;
+  now = fire(g, now);                              // START_TURN, turn 2
+  while (g.state() != ST_AWAIT_INPUT) now = fire(g, now);
+  g.press(0, now);                                 // CORRECT
+  g.press(1, now);                                 // GAME_DONE -> WIN
+  return now;
+}
+
+int main() {
+  LogIo io;
+  int pairs = 0;
+  for (int s = 0; s < ST_COUNT; s++) {
+    for (int e = 0; e < EV_COUNT; e++) {
+      Game g(io, MELODY, MELODY_LENGTH);
+      reach(g, (State)s);
+      char what[64];
+      snprintf(what, sizeof(what), "reach %s", STATE_NAMES[s]);
+      check(g.state() == s, what, STATE_NAMES[g.state()], STATE_NAMES[s]);
+
+      io.log.clear();
+      g.dispatch((Event)e);
+      const Expect &want = EXPECT[s][e];
+      snprintf(what, sizeof(what), "%s + %s next", STATE_NAMES[s], EVENT_NAMES[e]);
+      check(g.state() == want.next, what, STATE_NAMES[g.state()], STATE_NAMES[want.next]);
+      snprintf(what, sizeof(what), "%s + %s io", STATE_NAMES[s], EVENT_NAMES[e]);
+      check(io.log == want.io, what, io.log, want.io);
+      pairs++;
+    }
+  }
+  printf("game-check: %d state/event pairs, %d failures\n", pairs, failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,321 @@
+/*
+ * File:     hostsim.cpp
+ * Company:  University of Canterbury Group 5
+ */
+
+#include "hostsim.h"
+
+#include <stdio.h>
+#include <string>
+
+#include "Arduino.h"
+#include "Adafruit_NeoPixel.h"
+#include "SPI.h"
+
+// Pin-change vectors defined by the sketch; called when a replayed
+// button level changes so the latency histogram sees the edge
+extern "C" void PCINT0_vect();
+extern "C" void PCINT1_vect();
+extern "C" void PCINT2_vect();
+// Synth sample interrupt, run while the sketch has it enabled
+extern "C" void TIMER2_COMPA_vect();
+
+HardwareSerial Serial;
+SPIClass SPI;
+uint8_t MCUSR = _BV(PORF);
+uint8_t SREG = 0;
+volatile uint8_t PCICR = 0;
+volatile uint8_t PCMSK0 = 0, PCMSK1 = 0, PCMSK2 = 0;
+volatile uint8_t hostsimPinLevel[NUM_DIGITAL_PINS];
+volatile uint8_t hostsimPortOut[NUM_DIGITAL_PINS];
+volatile uint8_t TCCR2A = 0, TCCR2B = 0, OCR2A = 0, TIMSK2 = 0, TCNT2 = 0, TIFR2 = 0;
+
+namespace hostsim {
+namespace {
+
+std::vector<Record> recs;
+size_t cursor = 0;
+bool done = false;
+uint64_t clockUs = 0;
+std::vector<uint8_t> buttons;   // button index -> pin
+uint32_t buttonMask = 0;
+uint8_t pinOut[NUM_DIGITAL_PINS];
+bool timestamps = false;
+bool trace = false;
+std::string lineBuf;
+Stats st;
+uint64_t timer2NextUs = 0;   // next compare match, 0 = interrupt off
+uint8_t spiByte = 0;         // position in the current SPI transaction
+uint32_t spiLeds = 0;        // LED chain bytes clocked out so far
+uint32_t spiShownLeds = 0xFFFFFFFF;
+
+const uint64_t TIMER2_PERIOD_US = 32;   // 16 MHz / 8 / (63 + 1)
+
+// Moves virtual time forward, running the Timer2 interrupt for every
+// compare match on the way
+void advanceTo(uint64_t t) {
+  while (TIMSK2 & _BV(OCIE2A)) {
+    if (timer2NextUs == 0) timer2NextUs = clockUs + TIMER2_PERIOD_US;
+    if (timer2NextUs > t) break;
+    clockUs = timer2NextUs;
+    timer2NextUs += TIMER2_PERIOD_US;
+    TIMER2_COMPA_vect();
+  }
+  if (!(TIMSK2 & _BV(OCIE2A))) timer2NextUs = 0;
+  if (t > clockUs) clockUs = t;
+}
+
+// Interrupts off for us (NeoPixel show()): Timer2 matches in that time
+// collapse into one pending interrupt, taken as soon as it ends
+void blackout(uint64_t us) {
+  uint64_t end = clockUs + us;
+  bool armed = TIMSK2 & _BV(OCIE2A);
+  if (armed && timer2NextUs == 0) timer2NextUs = clockUs + TIMER2_PERIOD_US;
+  clockUs = end;
+  if (!armed || timer2NextUs > end) return;
+  while (timer2NextUs <= end) timer2NextUs += TIMER2_PERIOD_US;   // the timer keeps counting
+  TIMER2_COMPA_vect();
+}
+
+void prefix() {
+  if (timestamps) printf("[%10.3f] ", clockUs / 1e6);
+}
+
+void applyButtons(const Record &r) {
+  advanceTo(r.tUs);
+  uint32_t changed = buttonMask ^ r.value;
+  buttonMask = r.value;
+  for (size_t i = 0; i < buttons.size(); i++) {
+    if (buttons[i] < NUM_DIGITAL_PINS)
+      hostsimPinLevel[buttons[i]] = (buttonMask & (1ul << i)) ? LOW : HIGH;
+  }
+  if (changed) {
+    st.buttonChanges++;
+    if (PCICR & _BV(0)) PCINT0_vect();
+    if (PCICR & _BV(1)) PCINT1_vect();
+    if (PCICR & _BV(2)) PCINT2_vect();
+  }
+}
+
+// Applies BUTTONS records sitting at the cursor
+void drainButtons() {
+  while (cursor < recs.size() && recs[cursor].type == REC_BUTTONS) applyButtons(recs[cursor++]);
+}
+
+bool isButtonPin(uint8_t pin) {
+  for (uint8_t p : buttons) if (p == pin) return true;
+  return false;
+}
+
+}  // namespace
+
+bool decode(const std::vector<uint8_t> &b, std::vector<Record> &out,
+            std::vector<uint8_t> &buttonPins) {
+  size_t i = 0;
+  uint64_t t = 0;
+  size_t maskBytes = 1;   // from START: (buttons + 7) / 8
+  while (i < b.size()) {
+    Record r = Record();
+    r.type = b[i++];
+    if (r.type == REC_START) {
+      if (i + 5 > b.size()) return false;
+      uint32_t us = 0;
+      for (int k = 0; k < 4; k++) us |= (uint32_t)b[i++] << (8 * k);
+      uint8_t n = b[i++];
+      if (i + n + 1 > b.size()) return false;
+      buttonPins.assign(b.begin() + i, b.begin() + i + n);
+      i += n;
+      maskBytes = (n + 7) / 8;
+      if (i + maskBytes > b.size()) return false;
+      for (size_t k = 0; k < maskBytes; k++) r.value |= (uint32_t)b[i++] << (8 * k);
+      t = us;
+      r.tUs = t;
+      out.push_back(r);
+      continue;
+    }
+    if (r.type != REC_ECHO && r.type != REC_BUTTONS) return false;
+
+    uint64_t dt = 0;
+    int shift = 0;
+    for (;;) {
+      if (i >= b.size() || shift > 35) return false;
+      uint8_t v = b[i++];
+      dt |= (uint64_t)(v & 0x7F) << shift;
+      shift += 7;
+      if (!(v & 0x80)) break;
+    }
+    t += dt;
+    r.tUs = t;
+    if (r.type == REC_ECHO) {
+      if (i + 3 > b.size()) return false;
+      r.pin = b[i];
+      r.value = (uint16_t)(b[i + 1] | (b[i + 2] << 8));
+      i += 3;
+    } else {
+      if (i + maskBytes > b.size()) return false;
+      for (size_t k = 0; k < maskBytes; k++) r.value |= (uint32_t)b[i++] << (8 * k);
+    }
+    out.push_back(r);
+  }
+  return true;
+}
+
+void load(const std::vector<Record> &records, const std::vector<uint8_t> &buttonPins) {
+  recs = records;
+  buttons = buttonPins;
+  cursor = 0;
+  done = recs.empty();
+  clockUs = recs.empty() ? 0 : recs[0].tUs;
+  for (int p = 0; p < NUM_DIGITAL_PINS; p++) {
+    hostsimPinLevel[p] = HIGH;
+    pinOut[p] = 0xFF;
+  }
+  buttonMask = 0;
+  if (!recs.empty() && recs[0].type == REC_START) applyButtons(recs[cursor++]);
+}
+
+bool exhausted() { return done; }
+uint64_t nowUs() { return clockUs; }
+const Stats &stats() { return st; }
+void setTimestamps(bool on) { timestamps = on; }
+void setTrace(bool on) { trace = on; }
+
+}  // namespace hostsim
+
+using namespace hostsim;
+
+// ================= Arduino API =================
+unsigned long millis() { return (unsigned long)(clockUs / 1000); }
+unsigned long micros() { return (unsigned long)clockUs; }
+void delay(unsigned long ms) { advanceTo(clockUs + (uint64_t)ms * 1000); }
+void delayMicroseconds(unsigned int us) { advanceTo(clockUs + us); }
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  if (pin >= NUM_DIGITAL_PINS || pinOut[pin] == val) return;
+  pinOut[pin] = val;
+  st.ledWrites++;
+  if (trace) { prefix(); printf("# pin %u=%u\n", pin, val); }
+}
+
+int digitalRead(uint8_t pin) {
+  if (pin >= NUM_DIGITAL_PINS) return HIGH;
+  if (isButtonPin(pin)) drainButtons();
+  return hostsimPinLevel[pin] ? HIGH : LOW;
+}
+
+unsigned long pulseIn(uint8_t pin, uint8_t, unsigned long) {
+  while (cursor < recs.size()) {
+    const Record &r = recs[cursor++];
+    if (r.type == REC_BUTTONS) { applyButtons(r); continue; }
+    if (r.type == REC_ECHO && r.pin == pin) {
+      advanceTo(r.tUs);
+      st.echoes++;
+      return r.value;
+    }
+    st.skipped++;
+  }
+  done = true;
+  return 0;
+}
+
+unsigned long pulseInLong(uint8_t pin, uint8_t state, unsigned long timeout) {
+  return pulseIn(pin, state, timeout);
+}
+
+// Called by synth.h for each noteOn (hz > 0) and noteOff
+void hostsimNote(uint8_t key, unsigned int hz, unsigned long ms) {
+  if (hz == 0) {
+    if (trace) { prefix(); printf("# noteoff %u\n", key); }
+    return;
+  }
+  st.tones++;
+  if (trace) { prefix(); printf("# note %u %uHz %lums\n", key, hz, ms); }
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+// ================= Serial =================
+int HardwareSerial::available() { return 0; }
+int HardwareSerial::read() { return -1; }
+
+size_t HardwareSerial::write(uint8_t c) {
+  if (c == '\r') return 1;
+  if (c == '\n') {
+    prefix();
+    printf("%s\n", lineBuf.c_str());
+    lineBuf.clear();
+    st.serialLines++;
+  } else {
+    lineBuf += (char)c;
+  }
+  return 1;
+}
+
+size_t HardwareSerial::write(const char *s) {
+  size_t n = 0;
+  while (*s) n += write((uint8_t)*s++);
+  return n;
+}
+
+size_t HardwareSerial::print(const char *s) { return write(s); }
+size_t HardwareSerial::print(char c) { return write((uint8_t)c); }
+
+size_t HardwareSerial::print(long n, int base) {
+  char buf[24];
+  snprintf(buf, sizeof(buf), base == HEX ? "%lx" : "%ld", n);
+  return write(buf);
+}
+
+size_t HardwareSerial::print(unsigned long n, int base) {
+  char buf[24];
+  snprintf(buf, sizeof(buf), base == HEX ? "%lx" : "%lu", n);
+  return write(buf);
+}
+
+size_t HardwareSerial::print(double n, int digits) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.*f", digits, n);
+  return write(buf);
+}
+
+// ================= SPI (ShiftIo) =================
+void hostsimSpiBegin() {
+  drainButtons();
+  spiByte = 0;
+  spiLeds = 0;
+}
+
+// Byte k in is button chip k; the LED bytes arrive farthest chip first
+uint8_t hostsimSpiTransfer(uint8_t out) {
+  spiLeds = spiLeds << 8 | out;
+  return (uint8_t)~(buttonMask >> (8 * spiByte++));
+}
+
+void hostsimSpiEnd() {
+  if (spiLeds == spiShownLeds) return;
+  spiShownLeds = spiLeds;
+  st.ledWrites++;
+  if (trace) { prefix(); printf("# leds %0*x\n", 2 * spiByte, (unsigned)spiLeds); }
+}
+
+// ================= NeoPixel =================
+void Adafruit_NeoPixel::show() {
+  blackout(n_ * 30);   // 24 bits at 800 kHz per pixel
+  bool changed = !everShown_;
+  for (uint16_t i = 0; i < n_; i++) {
+    if (px_[i] != shown_[i]) changed = true;
+    shown_[i] = px_[i];
+  }
+  everShown_ = true;
+  if (!changed) return;
+  st.stripFrames++;
+  if (trace) {
+    prefix();
+    printf("# strip %d", pin_);
+    for (uint16_t i = 0; i < n_; i++) printf(" %06x", (unsigned)px_[i]);
+    printf("\n");
+  }
+}
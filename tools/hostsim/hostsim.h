@@ -0,0 +1,65 @@
+/*
+ * File:     hostsim.h
+ * Company:  University of Canterbury Group 5
+ */
+
+// ================================================================
+// Virtual-clock Arduino environment driven by a recorded input log.
+//
+// Records are consumed in the order the firmware asks for them:
+// pulseIn(pin) takes the next ECHO record (applying any BUTTONS records
+// in front of it) and digitalRead() of a button pin applies pending
+// BUTTONS records. The clock jumps to each record's timestamp, delay()
+// advances it, nothing ever sleeps.
+// ================================================================
+
+#ifndef HOSTSIM_H
+#define HOSTSIM_H
+
+#include <stdint.h>
+#include <vector>
+
+namespace hostsim {
+
+// Same ids as the REC_* constants in firmware.c
+enum RecordType : uint8_t {
+  REC_START = 0x01,
+  REC_ECHO = 0x02,
+  REC_BUTTONS = 0x03
+};
+
+struct Record {
+  uint8_t type;
+  uint64_t tUs;     // absolute device micros()
+  uint8_t pin;      // ECHO only
+  uint32_t value;   // ECHO: duration us, BUTTONS/START: pressed mask
+};
+
+struct Stats {
+  unsigned long echoes = 0;
+  unsigned long buttonChanges = 0;
+  unsigned long skipped = 0;     // records the firmware never asked for
+  unsigned long serialLines = 0;
+  unsigned long ledWrites = 0;
+  unsigned long stripFrames = 0;
+  unsigned long tones = 0;
+};
+
+// Parses the payload of "~<hex>" lines (already hex-decoded and
+// concatenated). Returns false on a truncated or unknown record.
+bool decode(const std::vector<uint8_t> &bytes, std::vector<Record> &out,
+            std::vector<uint8_t> &buttonPins);
+
+void load(const std::vector<Record> &records, const std::vector<uint8_t> &buttonPins);
+bool exhausted();
+uint64_t nowUs();
+const Stats &stats();
+
+// Output options: serial lines get a "[seconds]" prefix, trace adds
+// "# ..." lines for LED pins, tones and strip frames
+void setTimestamps(bool on);
+void setTrace(bool on);
+
+}  // namespace hostsim
+
+#endif  // HOSTSIM_H
@@ -0,0 +1,252 @@
+/*
+ * File:     protocol_check.cpp
+ * Company:  University of Canterbury Group 5
+ */
+
+// ================================================================
+// Checks the firmware side of the generated codec (protocol.h) and
+// produces the golden lines the host side is checked against.
+//
+// Build and run (from the repository root):
+//   g++ -std=gnu++11 -O2 -I. tools/hostsim/protocol_check.cpp -o protocol-check
+//   ./protocol-check [-w] [golden.txt]
+//
+// Encodes one or more messages of every device kind and compares the
+// lines with golden.txt (default protocol/golden.txt); -w rewrites the
+// file instead. Each golden line is also checked against MAX_LEN, and
+// encoding into a buffer one byte short must stop at cap. decodeCommand
+// runs over every command text and some near misses; those results go
+// into golden.txt as "> <text> <n>" so the host can check that
+// its command table agrees. Exits 1 on a mismatch, then times
+// distance-line encoding against the snprintf path it replaced.
+//
+// PhotoApp.Tools (photoapp-tools protocol) decodes and re-encodes every
+// golden line, so a change on either side of the schema shows up here
+// or there.
+// ================================================================
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "protocol.h"
+
+using namespace proto;
+
+namespace {
+
+std::vector<std::string> lines;
+int failures = 0;
+
+void fail(const std::string &what) {
+  printf("FAIL %s\n", what.c_str());
+  failures++;
+}
+
+// Encodes m into a roomy buffer and adds the line; also encodes into
+// cap = length - 1 and checks nothing is written past it
+template <typename M>
+void add(const M &m) {
+  char buf[255];   // caps are uint8_t
+  memset(buf, '#', sizeof(buf));
+  uint8_t n = encode(m, buf, sizeof(buf));
+  std::string line(buf, n);
+  if (n > M::MAX_LEN) fail("over MAX_LEN: " + line);
+  lines.push_back(line);
+  if (n == 0) return;
+  memset(buf, '#', sizeof(buf));
+  uint8_t cut = encode(m, buf, n - 1);
+  if (cut != n - 1 || buf[n - 1] != '#') fail("past cap: " + line);
+}
+
+void deviceLines() {
+  Ready ready = {true, "1.2.0"};
+  add(ready);
+  ready.hasFw = false;
+  add(ready);
+  ready.hasFw = true;
+  ready.fw = "1.2.0-rc.1+sha";   // cut to 12
+  add(ready);
+
+  Distance d = {5.15f, 3.43f, true, 123456789};
+  add(d);
+  d.a = NAN;
+  d.b = 12.0f;
+  d.hasT = false;
+  add(d);
+  d.a = 0.0f;
+  d.b = 399.995f;
+  d.hasT = true;
+  d.t = 4294967295u;
+  add(d);
+
+  SyncReply sync = {4294967295u};
+  add(sync);
+  sync.t = 0;
+  add(sync);
+
+  add(Ok());
+  Err err = {"FOO?"};
+  add(err);
+
+  Stall stall = {"sensors", 61234, 3};
+  add(stall);
+
+  static const uint16_t H[] = {0, 4, 17, 3, 1, 0, 0, 0, 0, 0, 0, 1};
+  Latency lat = {2, 26, "4", "16", 52123, H, 12};
+  add(lat);
+  static const uint16_t FULL[] = {65535, 65535, 65535, 65535, 65535, 65535,
+                                  65535, 65535, 65535, 65535, 65535, 65535};
+  Latency big = {255, 4294967295u, "64+", "64+", 4294967295u, FULL, 12};
+  add(big);
+
+  Sound snd = {2, 3, 201, 143, 28, 160};
+  add(snd);
+
+  Strips strips = {20, 20, 3000, 150};
+  add(strips);
+
+  static const uint8_t REC[48] = {0x01, 0x02, 0x03, 0xab, 0xcd, 0xef};
+  Record rec = {REC, 24};
+  add(rec);
+  rec.dataLen = 48;
+  add(rec);
+
+  Calibration cal = {"B", 34, 1, 30, 35, "boot"};
+  add(cal);
+  Calibration none = {"A", 0, 0, 30, 35, "default"};
+  add(none);
+
+  Turn turn = {3};
+  add(turn);
+  turn.n = 255;
+  add(turn);
+  add(YourTurn());
+  add(Correct());
+  add(NextLevel());
+  add(Wrong());
+  add(Fail());
+  add(Win());
+}
+
+// Command texts in schema order, then lines that must not match
+const char *const COMMANDS[] = {
+  "LAT?", "LAT0", "REC1", "REC0", "STREAM1", "STREAM0", "SYNC",
+  "ID?", "CAL", "CAL?", "LED?", "SND?", "SND0",
+};
+const char *const NOT_COMMANDS[] = {
+  "", "LAT", "lat?", "LAT? ", "REC", "STREAM", "SYNC1", "CAL!", "SND",
+};
+
+void commandLines() {
+  const uint8_t count = sizeof(COMMANDS) / sizeof(COMMANDS[0]);
+  for (uint8_t i = 0; i < count; i++) {
+    Command c = decodeCommand(COMMANDS[i]);
+    if (c != (Command)(CMD_UNKNOWN + 1 + i)) fail(std::string("command: ") + COMMANDS[i]);
+    lines.push_back(std::string("> ") + COMMANDS[i] + " " + std::to_string(c));
+  }
+  for (const char *text : NOT_COMMANDS) {
+    Command c = decodeCommand(text);
+    if (c != CMD_UNKNOWN) fail(std::string("not a command: \"") + text + "\"");
+    lines.push_back(std::string("> ") + text + " " + std::to_string(c));
+  }
+}
+
+const char HEADER[] =
+    "# Written by tools/hostsim/protocol_check.cpp -w from protocol.h; do not edit.\n"
+    "# Device lines as the firmware encodes them; \"> <text> <n>\" is a command\n"
+    "# line and what decodeCommand makes of it (0 = unknown, else schema order).\n";
+
+bool writeGolden(const char *path) {
+  FILE *f = fopen(path, "wb");
+  if (!f) { perror(path); return false; }
+  fputs(HEADER, f);
+  for (const std::string &l : lines) fprintf(f, "%s\n", l.c_str());
+  return fclose(f) == 0;
+}
+
+bool compareGolden(const char *path) {
+  FILE *f = fopen(path, "rb");
+  if (!f) { perror(path); return false; }
+  std::vector<std::string> file;
+  std::vector<size_t> lineNo;
+  char buf[512];
+  for (size_t no = 1; fgets(buf, sizeof(buf), f); no++) {
+    size_t n = strlen(buf);
+    if (n && buf[n - 1] == '\n') buf[--n] = 0;
+    if (buf[0] == '#') continue;
+    file.push_back(buf);
+    lineNo.push_back(no);
+  }
+  fclose(f);
+  bool same = file.size() == lines.size();
+  for (size_t i = 0; i < file.size() && i < lines.size(); i++) {
+    if (file[i] == lines[i]) continue;
+    printf("%s:%zu: \"%s\", protocol.h says \"%s\"\n", path, lineNo[i], file[i].c_str(), lines[i].c_str());
+    same = false;
+  }
+  if (!same) printf("%s is stale (%zu lines, expected %zu); rewrite it with -w\n", path, file.size(), lines.size());
+  return same;
+}
+
+// ------------------ Throughput ------------------
+volatile uint32_t sink;
+
+template <typename F>
+void report(const char *name, uint32_t n, F run) {
+  auto t0 = std::chrono::steady_clock::now();
+  run();
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+  printf("%-16s %10.1f\n", name, ns / n);
+}
+
+void benchmark(uint32_t n) {
+  printf("%-16s %10s\n", "path", "ns/line");
+  for (int pass = 0; pass < 2; pass++) {   // the first pass warms the caches
+    bool print = pass == 1;
+    auto printf_path = [n]() {
+      char buf[64];
+      for (uint32_t i = 0; i < n; i++)
+        sink += snprintf(buf, sizeof(buf), "A: %.2f cm | B: %.2f cm | t=%lu",
+                         i % 4000 / 100.0, i % 800 / 100.0, (unsigned long)i);
+    };
+    auto encode_path = [n]() {
+      char buf[Distance::MAX_LEN];
+      for (uint32_t i = 0; i < n; i++) {
+        Distance d = {i % 4000 / 100.0f, i % 800 / 100.0f, true, i};
+        sink += encode(d, buf, sizeof(buf));
+      }
+    };
+    if (print) {
+      report("snprintf encode", n, printf_path);
+      report("protocol encode", n, encode_path);
+    } else {
+      printf_path();
+      encode_path();
+    }
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  bool write = false;
+  const char *path = "protocol/golden.txt";
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-w") == 0) write = true;
+    else path = argv[i];
+  }
+
+  deviceLines();
+  commandLines();
+  bool ok = write ? writeGolden(path) : compareGolden(path);
+  printf("protocol-check: %zu golden lines, %d failures\n", lines.size(), failures);
+  if (!ok || failures) return 1;
+
+  printf("\n");
+  benchmark(1000000);
+  return 0;
+}
@@ -0,0 +1,104 @@
+/*
+ * File:     replay.cpp
+ * Company:  University of Canterbury Group 5
+ */
+
+// ================================================================
+// Replays a recorded input log through firmware.c at full speed.
+//
+// Build (from the repository root):
+//   g++ -std=gnu++11 -O2 -Itools/hostsim -x c++ firmware.c
+//       tools/hostsim/hostsim.cpp tools/hostsim/replay.cpp -o echome-replay
+// (add -DBOARD_XL for the shift-register board; see SPI.h)
+//
+// Record on the device with REC1 ... REC0 and save the serial output;
+// only "~<hex>" lines are used, everything else is ignored.
+//
+// Usage: echome-replay [-t] [-x] <capture.txt | ->
+//   -t  prefix output lines with virtual time (seconds)
+//   -x  trace LED pins, tones and strip frames
+// Firmware serial output goes to stdout, a summary to stderr.
+// ================================================================
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "hostsim.h"
+
+void setup();
+void loop();
+
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+static bool readCapture(FILE *f, std::vector<uint8_t> &bytes) {
+  char line[512];
+  while (fgets(line, sizeof(line), f)) {
+    if (line[0] != '~') continue;
+    for (const char *p = line + 1; hexValue(p[0]) >= 0 && hexValue(p[1]) >= 0; p += 2)
+      bytes.push_back((uint8_t)(hexValue(p[0]) << 4 | hexValue(p[1])));
+  }
+  return !ferror(f);
+}
+
+int main(int argc, char **argv) {
+  const char *path = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-t") == 0) hostsim::setTimestamps(true);
+    else if (strcmp(argv[i], "-x") == 0) hostsim::setTrace(true);
+    else path = argv[i];
+  }
+  if (!path) {
+    fprintf(stderr, "usage: %s [-t] [-x] <capture.txt | ->\n", argv[0]);
+    return 2;
+  }
+
+  FILE *f = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+  if (!f) { perror(path); return 1; }
+  std::vector<uint8_t> bytes;
+  bool ok = readCapture(f, bytes);
+  if (f != stdin) fclose(f);
+  if (!ok) { perror(path); return 1; }
+
+  std::vector<hostsim::Record> records;
+  std::vector<uint8_t> buttonPins;
+  if (!hostsim::decode(bytes, records, buttonPins)) {
+    fprintf(stderr, "%s: corrupt record stream (decoded %zu records)\n", path, records.size());
+    return 1;
+  }
+  if (records.empty() || records[0].type != hostsim::REC_START) {
+    fprintf(stderr, "%s: no recording found (expected REC1 output)\n", path);
+    return 1;
+  }
+
+  hostsim::load(records, buttonPins);
+  uint64_t t0 = hostsim::nowUs();
+  auto wall0 = std::chrono::steady_clock::now();
+
+  setup();
+  unsigned long loops = 0;
+  while (!hostsim::exhausted()) {
+    loop();
+    loops++;
+  }
+
+  double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wall0).count();
+  double virtSec = (hostsim::nowUs() - t0) / 1e6;
+  const hostsim::Stats &st = hostsim::stats();
+  fflush(stdout);
+  fprintf(stderr,
+          "replay: %zu records, %lu loops, %lu echoes, %lu button changes, %lu skipped\n"
+          "replay: %lu serial lines, %lu LED writes, %lu strip frames, %lu tones\n"
+          "replay: %.1f s virtual in %.1f ms (%.0fx real time)\n",
+          records.size(), loops, st.echoes, st.buttonChanges, st.skipped,
+          st.serialLines, st.ledWrites, st.stripFrames, st.tones,
+          virtSec, wallMs, wallMs > 0 ? virtSec * 1000.0 / wallMs : 0.0);
+  return 0;
+}
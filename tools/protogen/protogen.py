@@ -0,0 +1,498 @@
+#!/usr/bin/env python3
+#
+# File:     protogen.py
+# Company:  University of Canterbury Group 5
+#
+# Generates the firmware and host sides of the serial protocol from
+# protocol/echome.schema (see that file for the schema format):
+#   protocol.h                            C++: fixed-buffer encoders for
+#                                         device lines, command decoder
+#   PhotoApp.Core/Protocol.Generated.cs   C#: decoders and encoders for
+#                                         device lines, command lines
+#
+#   python3 tools/protogen/protogen.py           regenerate
+#   python3 tools/protogen/protogen.py --check   fail if out of date
+
+import os
+import re
+import sys
+
+ROOT = os.path.normpath(os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..'))
+SCHEMA = os.path.join(ROOT, 'protocol', 'echome.schema')
+CPP_OUT = os.path.join(ROOT, 'protocol.h')
+CS_OUT = os.path.join(ROOT, 'PhotoApp.Core', 'Protocol.Generated.cs')
+
+# type -> (C++ type, C# type, max encoded bytes for a given N)
+TYPES = {
+    'u8':   ('uint8_t', 'byte', lambda n: 3),
+    'u16':  ('uint16_t', 'ushort', lambda n: 5),
+    'u32':  ('uint32_t', 'uint', lambda n: 10),
+    'cm':   ('float', 'double', lambda n: 10),          # "9999.99 cm"
+    'str':  ('const char *', 'ArraySegment<byte>', lambda n: n),
+    'u16s': ('const uint16_t *', 'ArraySegment<byte>', lambda n: n * 6 - 1),
+    'hex':  ('const uint8_t *', 'ArraySegment<byte>', lambda n: n * 2),
+}
+SIZED = ('str', 'u16s', 'hex')
+
+
+class Field:
+    def __init__(self, name, type_, size):
+        self.name, self.type, self.size = name, type_, size
+
+    @property
+    def cs(self):
+        return self.name[0].upper() + self.name[1:]
+
+    @property
+    def max_len(self):
+        return TYPES[self.type][2](self.size)
+
+
+class Message:
+    def __init__(self, kind, name, template, line):
+        self.kind, self.name, self.template = kind, name, template
+        self.segments, self.optional = parse_template(template, line)
+
+    def fields(self, segs=None):
+        return [s for s in (self.segments + self.optional if segs is None else segs) if isinstance(s, Field)]
+
+    @property
+    def lead(self):
+        return self.segments[0] if self.segments and isinstance(self.segments[0], str) else ''
+
+    @property
+    def max_len(self):
+        return sum(len(s.encode()) if isinstance(s, str) else s.max_len for s in self.segments + self.optional)
+
+
+def fail(line, msg):
+    sys.exit('%s:%d: %s' % (SCHEMA, line, msg))
+
+
+def parse_template(text, line):
+    main, opt = text, ''
+    if '[' in text:
+        if not text.endswith(']') or text.count('[') != 1:
+            fail(line, 'only one optional [...] group, at the end')
+        main, opt = text[:-1].split('[')
+        if '{' not in opt:
+            fail(line, 'optional group needs a field')
+    return parse_segments(main, line), parse_segments(opt, line)
+
+
+def parse_segments(text, line):
+    segs = []
+    for lit, spec in re.findall(r'([^{]*)(?:\{([^}]*)\})?', text):
+        if lit:
+            segs.append(lit)
+        if not spec:
+            continue
+        parts = spec.split(':')
+        if len(parts) < 2 or parts[1] not in TYPES:
+            fail(line, 'bad field {%s}' % spec)
+        size = 0
+        if parts[1] in SIZED:
+            if len(parts) != 3 or not parts[2].isdigit():
+                fail(line, '{%s} needs a size' % spec)
+            size = int(parts[2])
+        if segs and isinstance(segs[-1], Field):
+            fail(line, 'fields need a literal between them')
+        segs.append(Field(parts[0], parts[1], size))
+    return segs
+
+
+def load():
+    messages = []
+    with open(SCHEMA, encoding='utf-8') as f:
+        for n, raw in enumerate(f, 1):
+            line = raw.strip()
+            if not line or line.startswith('#'):
+                continue
+            m = re.match(r'(device|command)\s+(\w+)\s+"(.*)"$', line)
+            if not m:
+                fail(n, 'expected: device|command <Name> "<template>"')
+            msg = Message(m.group(1), m.group(2), m.group(3), n)
+            if msg.kind == 'command' and msg.fields():
+                fail(n, 'commands take no fields')
+            if msg.max_len > 250:
+                fail(n, 'line can exceed 250 bytes')
+            messages.append(msg)
+    return [m for m in messages if m.kind == 'device'], [m for m in messages if m.kind == 'command']
+
+
+def c_string(s):
+    out = ''
+    for b in s.encode():
+        if b == 0x22 or b == 0x5C:
+            out += '\\' + chr(b)
+        elif 0x20 <= b < 0x7F:
+            out += chr(b)
+        else:
+            out += '\\x%02X""' % b
+    return '"%s"' % out
+
+
+def upper_snake(name):
+    return re.sub(r'(?<!^)([A-Z])', r'_\1', name).upper()
+
+
+def next_stop(segs, i, after):
+    # First byte of the literal following segs[i], 0 = line end
+    rest = segs[i + 1:] + after
+    return rest[0].encode()[0] if rest and isinstance(rest[0], str) else 0
+
+
+# ------------------------------------------------------------------ C++
+
+CPP_PRELUDE = r'''// Generated by tools/protogen/protogen.py from protocol/echome.schema.
+// Do not edit; change the schema and regenerate.
+
+// ================================================================
+// EchoMe serial protocol, firmware side.
+//
+// encode() writes one device line (without the line ending) into a
+// caller-owned buffer of at least <Message>::MAX_LEN bytes and returns
+// its length; nothing is allocated and nothing is written past cap.
+// decodeCommand() turns a received command line into a Command.
+// ================================================================
+
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+namespace proto {
+
+struct Writer {
+  char *buf;
+  uint8_t len;
+  uint8_t cap;
+
+  void ch(char c) { if (len < cap) buf[len++] = c; }
+  void lit(const char *s) { while (*s) ch(*s++); }
+
+  void u32(uint32_t v) {
+    char t[10];
+    uint8_t n = 0;
+    do { t[n++] = (char)('0' + v % 10); v /= 10; } while (v);
+    while (n) ch(t[--n]);
+  }
+
+  // Two decimals, rounded the way Print::print(float, 2) does
+  void cm(float v) {
+    if (isnan(v)) { lit("\xE2\x80\x94"); return; }
+    if (v < 0) { ch('-'); v = -v; }
+    v += 0.005f;
+    uint32_t whole = (uint32_t)v;
+    float rest = v - (float)whole;
+    u32(whole);
+    ch('.');
+    for (uint8_t i = 0; i < 2; i++) {
+      rest *= 10.0f;
+      uint8_t d = (uint8_t)rest;
+      ch((char)('0' + d));
+      rest -= d;
+    }
+    lit(" cm");
+  }
+
+  void str(const char *s, uint8_t max) {
+    for (uint8_t i = 0; i < max && s && s[i]; i++) ch(s[i]);
+  }
+
+  void u16s(const uint16_t *v, uint8_t n) {
+    for (uint8_t i = 0; i < n; i++) {
+      if (i) ch(',');
+      u32(v[i]);
+    }
+  }
+
+  void hex(const uint8_t *d, uint8_t n) {
+    static const char DIGITS[] = "0123456789abcdef";
+    for (uint8_t i = 0; i < n; i++) {
+      ch(DIGITS[d[i] >> 4]);
+      ch(DIGITS[d[i] & 0x0F]);
+    }
+  }
+};
+'''
+
+
+def cpp_fields(fields):
+    out = []
+    for f in fields:
+        out.append('  %s%s%s;' % (TYPES[f.type][0], '' if TYPES[f.type][0].endswith('*') else ' ', f.name))
+        if f.type == 'u16s':
+            out.append('  uint8_t %sCount;   // at most %d' % (f.name, f.size))
+        elif f.type == 'hex':
+            out.append('  uint8_t %sLen;   // at most %d' % (f.name, f.size))
+    return out
+
+
+def cpp_write(segs, indent):
+    out = []
+    for s in segs:
+        if isinstance(s, str):
+            out.append('%sw.lit(%s);' % (indent, c_string(s)))
+        elif s.type in ('u8', 'u16', 'u32'):
+            out.append('%sw.u32(m.%s);' % (indent, s.name))
+        elif s.type == 'cm':
+            out.append('%sw.cm(m.%s);' % (indent, s.name))
+        elif s.type == 'str':
+            out.append('%sw.str(m.%s, %d);' % (indent, s.name, s.size))
+        elif s.type == 'u16s':
+            out.append('%sw.u16s(m.%s, m.%sCount > %d ? %d : m.%sCount);' % (indent, s.name, s.name, s.size, s.size, s.name))
+        else:
+            out.append('%sw.hex(m.%s, m.%sLen > %d ? %d : m.%sLen);' % (indent, s.name, s.name, s.size, s.size, s.name))
+    return out
+
+
+def gen_cpp(devices, commands):
+    out = [CPP_PRELUDE]
+    for m in devices:
+        out.append('// %s' % m.template)
+        out.append('struct %s {' % m.name)
+        out.append('  static const uint8_t MAX_LEN = %d;' % m.max_len)
+        out += cpp_fields(m.fields(m.segments))
+        if m.optional:
+            first = m.fields(m.optional)[0]
+            out.append('  bool has%s;' % first.cs)
+            out += cpp_fields(m.fields(m.optional))
+        out.append('};')
+        out.append('')
+        out.append('inline uint8_t encode(const %s &m, char *buf, uint8_t cap) {' % m.name)
+        out.append('  Writer w = {buf, 0, cap};')
+        if not m.fields(m.segments) and not m.optional:
+            out.append('  (void)m;')
+        out += cpp_write(m.segments, '  ')
+        if m.optional:
+            out.append('  if (m.has%s) {' % m.fields(m.optional)[0].cs)
+            out += cpp_write(m.optional, '    ')
+            out.append('  }')
+        out.append('  return w.len;')
+        out.append('}')
+        out.append('')
+
+    out.append('enum Command : uint8_t {')
+    out.append('  CMD_UNKNOWN,')
+    for c in commands:
+        out.append('  CMD_%s,   // %s' % (upper_snake(c.name), c.template))
+    out.append('};')
+    out.append('')
+    out.append('inline Command decodeCommand(const char *line) {')
+    for c in commands:
+        out.append('  if (strcmp(line, %s) == 0) return CMD_%s;' % (c_string(c.template), upper_snake(c.name)))
+    out.append('  return CMD_UNKNOWN;')
+    out.append('}')
+    out.append('')
+    out.append('}  // namespace proto')
+    out.append('')
+    out.append('#endif  // PROTOCOL_H')
+    return '\n'.join(out) + '\n'
+
+
+# ------------------------------------------------------------------- C#
+
+def cs_bytes(s):
+    return 'new byte[] { %s }' % ', '.join('0x%02X' % b for b in s.encode())
+
+
+def cs_comment(s):
+    return s.replace('&', '&amp;').replace('<', '&lt;').replace('>', '&gt;')
+
+
+def gen_cs(devices, commands):
+    lits = {}
+
+    def lit(s):
+        if s not in lits:
+            lits[s] = 'L%d' % len(lits)
+        return lits[s]
+
+    body = []
+    body.append('        public enum MessageKind')
+    body.append('        {')
+    body.append('            Unknown,')
+    for m in devices:
+        body.append('            %s,' % m.name)
+    body.append('        }')
+    body.append('')
+    body.append('        public enum Command')
+    body.append('        {')
+    for c in commands:
+        body.append('            /// <summary>%s</summary>' % cs_comment(c.template))
+        body.append('            %s,' % c.name)
+    body.append('        }')
+
+    for m in devices:
+        body.append('')
+        body.append('        /// <summary>%s</summary>' % cs_comment(m.template))
+        body.append('        public struct %s' % m.name)
+        body.append('        {')
+        body.append('            public const int MaxLength = %d;' % m.max_len)
+        for f in m.fields(m.segments):
+            body.append('            public %s %s;' % (TYPES[f.type][1], f.cs))
+        if m.optional:
+            body.append('            public bool Has%s;' % m.fields(m.optional)[0].cs)
+            for f in m.fields(m.optional):
+                body.append('            public %s %s;' % (TYPES[f.type][1], f.cs))
+        body.append('        }')
+
+    # Classify: longest leading literal first so "SYNC t=" beats "S"
+    body.append('')
+    body.append('        /// <summary>Which message a line is, by its leading literal. Does not validate the rest.</summary>')
+    body.append('        public static MessageKind Classify(byte[] line, int offset, int count)')
+    body.append('        {')
+    for m in sorted(devices, key=lambda m: -len(m.lead.encode())):
+        if m.fields():
+            body.append('            if (StartsWith(line, offset, count, %s)) return MessageKind.%s;' % (lit(m.lead), m.name))
+        else:
+            body.append('            if (Matches(line, offset, count, %s)) return MessageKind.%s;' % (lit(m.lead), m.name))
+    body.append('            return MessageKind.Unknown;')
+    body.append('        }')
+
+    def reads(segs, after):
+        out = []
+        for i, s in enumerate(segs):
+            if isinstance(s, str):
+                out.append('r.Lit(%s)' % lit(s))
+                continue
+            stop = next_stop(segs, i, after)
+            if s.type == 'u8':
+                out.append('r.U8(out m.%s)' % s.cs)
+            elif s.type == 'u16':
+                out.append('r.U16(out m.%s)' % s.cs)
+            elif s.type == 'u32':
+                out.append('r.U32(out m.%s)' % s.cs)
+            elif s.type == 'cm':
+                out.append('r.Cm(out m.%s)' % s.cs)
+            elif s.type == 'str':
+                out.append('r.Str(%d, %d, out m.%s)' % (stop, s.size, s.cs))
+            elif s.type == 'u16s':
+                out.append('r.U16s(%d, out m.%s)' % (s.size, s.cs))
+            else:
+                out.append('r.Hex(%d, out m.%s)' % (s.size, s.cs))
+        return out
+
+    def writes(segs):
+        out = []
+        for s in segs:
+            if isinstance(s, str):
+                out.append('w.Lit(%s);' % lit(s))
+            elif s.type in ('u8', 'u16', 'u32'):
+                out.append('w.U32(m.%s);' % s.cs)
+            elif s.type == 'cm':
+                out.append('w.Cm(m.%s);' % s.cs)
+            else:
+                out.append('w.Raw(m.%s);' % s.cs)
+        return out
+
+    for m in devices:
+        body.append('')
+        body.append('        public static bool TryDecode(byte[] line, int offset, int count, out %s m)' % m.name)
+        body.append('        {')
+        body.append('            m = default(%s);' % m.name)
+        body.append('            var r = new Reader(line, offset, count);')
+        checks = reads(m.segments, m.optional)
+        if checks:
+            body.append('            if (!(%s)) return false;' % ('\n                  && '.join(checks)))
+        if m.optional:
+            first = m.fields(m.optional)[0]
+            body.append('            if (r.AtEnd) return true;')
+            body.append('            if (!(%s)) return false;' % ('\n                  && '.join(reads(m.optional, []))))
+            body.append('            m.Has%s = true;' % first.cs)
+        body.append('            return r.AtEnd;')
+        body.append('        }')
+        body.append('')
+        body.append('        /// <summary>Writes the line without its ending; returns its length. Needs MaxLength bytes.</summary>')
+        body.append('        public static int Encode(in %s m, byte[] buffer, int offset)' % m.name)
+        body.append('        {')
+        body.append('            var w = new Writer(buffer, offset);')
+        for s in writes(m.segments):
+            body.append('            ' + s)
+        if m.optional:
+            body.append('            if (m.Has%s)' % m.fields(m.optional)[0].cs)
+            body.append('            {')
+            for s in writes(m.optional):
+                body.append('                ' + s)
+            body.append('            }')
+        body.append('            return w.Length;')
+        body.append('        }')
+
+    body.append('')
+    body.append('        private static readonly byte[][] CommandLines =')
+    body.append('        {')
+    for c in commands:
+        body.append('            %s,' % cs_bytes(c.template + '\n'))
+    body.append('        };')
+    body.append('')
+    body.append('        /// <summary>The command as sent, "\\n" included. Shared; do not modify.</summary>')
+    body.append('        public static byte[] CommandLine(Command command)')
+    body.append('        {')
+    body.append('            return CommandLines[(int)command];')
+    body.append('        }')
+    body.append('')
+    body.append('        /// <summary>Recognises a received command line (without its ending).</summary>')
+    body.append('        public static bool TryDecodeCommand(byte[] line, int offset, int count, out Command command)')
+    body.append('        {')
+    body.append('            for (int i = 0; i < CommandLines.Length; i++)')
+    body.append('            {')
+    body.append('                byte[] c = CommandLines[i];')
+    body.append('                if (count != c.Length - 1) continue;')
+    body.append('                int k = 0;')
+    body.append('                while (k < count && line[offset + k] == c[k]) k++;')
+    body.append('                if (k < count) continue;')
+    body.append('                command = (Command)i;')
+    body.append('                return true;')
+    body.append('            }')
+    body.append('            command = default(Command);')
+    body.append('            return false;')
+    body.append('        }')
+
+    head = [
+        '// <auto-generated>',
+        '// Generated by tools/protogen/protogen.py from protocol/echome.schema.',
+        '// Do not edit; change the schema and regenerate.',
+        '// </auto-generated>',
+        '',
+        'using System;',
+        '',
+        'namespace PhotoApp.Core',
+        '{',
+        '    public static partial class Protocol',
+        '    {',
+    ]
+    for s, name in sorted(lits.items(), key=lambda kv: int(kv[1][1:])):
+        head.append('        private static readonly byte[] %s = %s;   // "%s"' % (name, cs_bytes(s), s))
+    head.append('')
+    tail = ['    }', '}']
+    return '\n'.join(head + body + tail) + '\n'
+
+
+def main():
+    devices, commands = load()
+    outputs = {CPP_OUT: gen_cpp(devices, commands), CS_OUT: gen_cs(devices, commands)}
+    check = '--check' in sys.argv[1:]
+    stale = []
+    for path, text in outputs.items():
+        old = None
+        if os.path.exists(path):
+            with open(path, encoding='utf-8', newline='') as f:
+                old = f.read()
+        if old == text:
+            continue
+        stale.append(os.path.relpath(path, ROOT))
+        if not check:
+            with open(path, 'w', encoding='utf-8', newline='\n') as f:
+                f.write(text)
+    if check and stale:
+        sys.exit('out of date: ' + ', '.join(stale))
+    for p in stale:
+        print('wrote ' + p)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())